@@ -9,6 +9,7 @@
 
   # Deps
   qtbase,
+  zlib,
   wrapQtAppsHook,
 }:
 stdenv.mkDerivation {
@@ -16,7 +17,10 @@ stdenv.mkDerivation {
   version = "0.1.0";
   src = lib.cleanSource ./.;
 
-  buildInputs = [ qtbase ];
+  buildInputs = [
+    qtbase
+    zlib
+  ];
 
   nativeBuildInputs = [
     meson
@@ -13,14 +13,25 @@
 
 #include <cstddef>
 #include <functional>
+#include <optional>
+#include <qbytearray.h>
 #include <qeventloop.h>
+#include <qiodevice.h>
+#include <qlist.h>
+#include <qmetaobject.h>
 #include <qobject.h>
+#include <qpointer.h>
 #include <qstring.h>
+#include <qstringlist.h>
 #include <qtimer.h>
 #include <qvariant.h>
 #include <utility>
+#include <variant>
 
+#include "temail/client/flags.hpp"
 #include "temail/client/request.hpp"
+#include "temail/client/response.hpp"
+#include "temail/client/sequence.hpp"
 #include "temail/common.hpp"
 
 namespace temail::client {
@@ -69,6 +80,11 @@ public:
 
   using CommandCallback = std::function<void(const QVariant&)>;
   using ErrorCallback = std::function<void(ErrorType, const QString&)>;
+  using ResultCallback = std::function<void(response::Result&&)>;
+  template<typename T>
+  using Callback = std::function<void(T&&)>;
+  using FetchSink = std::function<
+    void(std::size_t id, const QString& field, const QByteArray& chunk)>;
 
   constexpr static int TIMEOUT_MSECS = 30000; /**< Default timeout. */
 
@@ -142,60 +158,251 @@ public:
    *
    * @param username Username.
    * @param password Password.
-   * @param callback Success callback.
+   * @param callback Success callback, result is queued for `read` if empty.
    */
-  virtual void login(
-    const QString& username,
-    const QString& password,
-    const CommandCallback& callback = _default_command_handler) = 0;
+  virtual void login(const QString& username,
+                     const QString& password,
+                     const ResultCallback& callback = {}) = 0;
+
+  /**
+   * @brief Login to server.
+   *
+   * @param username Username.
+   * @param password Password.
+   * @param callback Typed success callback.
+   */
+  TEMAIL_INLINE void login(const QString& username,
+                           const QString& password,
+                           const Callback<response::Login>& callback)
+  {
+    login(username, password, _typed(callback));
+  }
+
+  /**
+   * @brief Login to server.
+   *
+   * @param username Username.
+   * @param password Password.
+   * @param callback Boxed success callback.
+   */
+  TEMAIL_INLINE void login(const QString& username,
+                           const QString& password,
+                           const CommandCallback& callback)
+  {
+    login(username, password, _boxed(callback));
+  }
 
   /**
    * @brief Logout from server.
    *
-   * @param callback Success callback.
+   * @param callback Success callback, result is queued for `read` if empty.
    */
-  virtual void logout(
-    const CommandCallback& callback = _default_command_handler) = 0;
+  virtual void logout(const ResultCallback& callback = {}) = 0;
+
+  /**
+   * @brief Logout from server.
+   *
+   * @param callback Boxed success callback.
+   */
+  TEMAIL_INLINE void logout(const CommandCallback& callback)
+  {
+    logout(_boxed(callback));
+  }
 
   /**
    * @brief List folders.
    *
    * @param path Parent path.
    * @param pattern Filter pattern.
-   * @param callback Success callback.
+   * @param callback Success callback, result is queued for `read` if empty.
    */
-  virtual void list(
-    const QString& path,
-    const QString& pattern,
-    const CommandCallback& callback = _default_command_handler) = 0;
+  virtual void list(const QString& path,
+                    const QString& pattern,
+                    const ResultCallback& callback = {}) = 0;
+
+  /**
+   * @brief List folders.
+   *
+   * @param path Parent path.
+   * @param pattern Filter pattern.
+   * @param callback Typed success callback.
+   */
+  TEMAIL_INLINE void list(const QString& path,
+                          const QString& pattern,
+                          const Callback<response::List>& callback)
+  {
+    list(path, pattern, _typed(callback));
+  }
+
+  /**
+   * @brief List folders.
+   *
+   * @param path Parent path.
+   * @param pattern Filter pattern.
+   * @param callback Boxed success callback.
+   */
+  TEMAIL_INLINE void list(const QString& path,
+                          const QString& pattern,
+                          const CommandCallback& callback)
+  {
+    list(path, pattern, _boxed(callback));
+  }
 
   /**
    * @brief Select folder.
    *
    * @param path Folder path.
-   * @param callback Success callback.
+   * @param callback Success callback, result is queued for `read` if empty.
    */
-  virtual void select(
-    const QString& path,
-    const CommandCallback& callback = _default_command_handler) = 0;
+  virtual void select(const QString& path,
+                      const ResultCallback& callback = {}) = 0;
+
+  /**
+   * @brief Select folder.
+   *
+   * @param path Folder path.
+   * @param callback Typed success callback.
+   */
+  TEMAIL_INLINE void select(const QString& path,
+                            const Callback<response::Select>& callback)
+  {
+    select(path, _typed(callback));
+  }
+
+  /**
+   * @brief Select folder.
+   *
+   * @param path Folder path.
+   * @param callback Boxed success callback.
+   */
+  TEMAIL_INLINE void select(const QString& path,
+                            const CommandCallback& callback)
+  {
+    select(path, _boxed(callback));
+  }
 
   /**
    * @brief No op.
    *
-   * @param callback Success callback.
+   * @param callback Success callback, result is queued for `read` if empty.
    */
-  virtual void noop(
-    const CommandCallback& callback = _default_command_handler) = 0;
+  virtual void noop(const ResultCallback& callback = {}) = 0;
+
+  /**
+   * @brief No op.
+   *
+   * @param callback Typed success callback.
+   */
+  TEMAIL_INLINE void noop(const Callback<response::Noop>& callback)
+  {
+    noop(_typed(callback));
+  }
+
+  /**
+   * @brief No op.
+   *
+   * @param callback Boxed success callback.
+   */
+  TEMAIL_INLINE void noop(const CommandCallback& callback)
+  {
+    noop(_boxed(callback));
+  }
 
   /**
    * @brief Search mails from server.
    *
-   * @param criteria Search criteria.
-   * @param callback Success callback.
+   * @param query Search query, `Search::Criteria` converts to it.
+   * @param callback Success callback, result is queued for `read` if empty.
+   * @note A query with `literal()` strings fails with `E_BADCOMMAND` unless
+   * the server advertises LITERAL+ or LITERAL- (RFC 7888).
    */
-  virtual void search(
-    request::Search::Criteria criteria,
-    const CommandCallback& callback = _default_command_handler) = 0;
+  virtual void search(const request::SearchQuery& query,
+                      const ResultCallback& callback = {}) = 0;
+
+  /**
+   * @brief Search mails from server.
+   *
+   * @param query Search query, `Search::Criteria` converts to it.
+   * @param callback Typed success callback.
+   */
+  TEMAIL_INLINE void search(const request::SearchQuery& query,
+                            const Callback<response::Search>& callback)
+  {
+    search(query, _typed(callback));
+  }
+
+  /**
+   * @brief Search mails from server.
+   *
+   * @param query Search query, `Search::Criteria` converts to it.
+   * @param callback Boxed success callback.
+   */
+  TEMAIL_INLINE void search(const request::SearchQuery& query,
+                            const CommandCallback& callback)
+  {
+    search(query, _boxed(callback));
+  }
+
+  /**
+   * @brief Search mails, only requested result data is sent.
+   *
+   * @note Needs ESEARCH (RFC 4731), a window needs PARTIAL (RFC 9394),
+   * servers without them answer BAD. `ALL` is dropped with a window.
+   *
+   * @param query Search query, `Search::Criteria` converts to it.
+   * @param options Result options, empty for `ALL`.
+   * @param partial Result window.
+   * @param callback Success callback, result is queued for `read` if empty.
+   */
+  virtual void search(const request::SearchQuery& query,
+                      request::SearchReturn::Options options,
+                      request::SearchPartial partial = {},
+                      const ResultCallback& callback = {}) = 0;
+
+  /**
+   * @brief Search mails, only requested result data is sent.
+   *
+   * @param query Search query, `Search::Criteria` converts to it.
+   * @param options Result options, empty for `ALL`.
+   * @param partial Result window.
+   * @param callback Typed success callback.
+   */
+  TEMAIL_INLINE void search(const request::SearchQuery& query,
+                            request::SearchReturn::Options options,
+                            request::SearchPartial partial,
+                            const Callback<response::ESearch>& callback)
+  {
+    search(query, options, partial, _typed(callback));
+  }
+
+  /**
+   * @brief Search mails, only requested result data is sent.
+   *
+   * @param query Search query, `Search::Criteria` converts to it.
+   * @param options Result options, empty for `ALL`.
+   * @param partial Result window.
+   * @param callback Boxed success callback.
+   */
+  TEMAIL_INLINE void search(const request::SearchQuery& query,
+                            request::SearchReturn::Options options,
+                            request::SearchPartial partial,
+                            const CommandCallback& callback)
+  {
+    search(query, options, partial, _boxed(callback));
+  }
+
+  /**
+   * @brief Fetch mails from server.
+   *
+   * @param id Mail start id.
+   * @param field Mail field.
+   * @param range Id range, 0 or 1 for `id` only.
+   * @param callback Success callback, result is queued for `read` if empty.
+   */
+  virtual void fetch(std::size_t id,
+                     request::Fetch::FieldFlags field,
+                     std::size_t range = 1,
+                     const ResultCallback& callback = {}) = 0;
 
   /**
    * @brief Fetch mails from server.
@@ -203,20 +410,596 @@ public:
    * @param id Mail start id.
    * @param field Mail field.
    * @param range Id range.
-   * @param callback Success callback.
+   * @param callback Typed success callback.
+   */
+  TEMAIL_INLINE void fetch(std::size_t id,
+                           request::Fetch::FieldFlags field,
+                           std::size_t range,
+                           const Callback<response::Fetch>& callback)
+  {
+    fetch(id, field, range, _typed(callback));
+  }
+
+  /**
+   * @brief Fetch mails from server.
+   *
+   * @param id Mail start id.
+   * @param field Mail field.
+   * @param range Id range.
+   * @param callback Boxed success callback.
+   */
+  TEMAIL_INLINE void fetch(std::size_t id,
+                           request::Fetch::FieldFlags field,
+                           std::size_t range,
+                           const CommandCallback& callback)
+  {
+    fetch(id, field, range, _boxed(callback));
+  }
+
+  /**
+   * @brief Fetch mails of a sequence set, such as a search result.
+   *
+   * @param ids Mail ids, must not be empty.
+   * @param field Mail field.
+   * @param callback Success callback, result is queued for `read` if empty.
+   */
+  virtual void fetch(const SequenceSet& ids,
+                     request::Fetch::FieldFlags field,
+                     const ResultCallback& callback = {}) = 0;
+
+  /**
+   * @brief Fetch mails of a sequence set.
+   *
+   * @param ids Mail ids, must not be empty.
+   * @param field Mail field.
+   * @param callback Typed success callback.
+   */
+  TEMAIL_INLINE void fetch(const SequenceSet& ids,
+                           request::Fetch::FieldFlags field,
+                           const Callback<response::Fetch>& callback)
+  {
+    fetch(ids, field, _typed(callback));
+  }
+
+  /**
+   * @brief Fetch mails of a sequence set.
+   *
+   * @param ids Mail ids, must not be empty.
+   * @param field Mail field.
+   * @param callback Boxed success callback.
+   */
+  TEMAIL_INLINE void fetch(const SequenceSet& ids,
+                           request::Fetch::FieldFlags field,
+                           const CommandCallback& callback)
+  {
+    fetch(ids, field, _boxed(callback));
+  }
+
+  /**
+   * @brief Fetch mails from server, literal data is passed to `sink` chunk by
+   * chunk as soon as it arrives instead of being buffered.
+   *
+   * @note `sink` is invoked in the thread which owns the client.
+   *
+   * @param id Mail start id.
+   * @param field Mail field.
+   * @param sink Chunk sink, keyed by mail id and fetch field.
+   * @param range Id range.
+   * @param callback Success callback, result is queued for `read` if empty.
+   */
+  virtual void fetch_stream(std::size_t id,
+                            request::Fetch::FieldFlags field,
+                            const FetchSink& sink,
+                            std::size_t range = 1,
+                            const ResultCallback& callback = {}) = 0;
+
+  /**
+   * @brief Fetch mails from server, literal data is written to `device`.
+   *
+   * @param id Mail start id.
+   * @param field Mail field.
+   * @param device Output device, must outlive the command.
+   * @param range Id range.
+   * @param callback Success callback, result is queued for `read` if empty.
+   */
+  TEMAIL_INLINE void fetch_stream(std::size_t id,
+                                  request::Fetch::FieldFlags field,
+                                  QIODevice* device,
+                                  std::size_t range = 1,
+                                  const ResultCallback& callback = {})
+  {
+    fetch_stream(
+      id,
+      field,
+      [device](std::size_t /*id*/,
+               const QString& /*field*/,
+               const QByteArray& chunk) { device->write(chunk); },
+      range,
+      callback);
+  }
+
+  /**
+   * @brief Fetch mails by UID.
+   *
+   * @param uid Mail start UID.
+   * @param field Mail field.
+   * @param range UID range, 0 for all mails from `uid`.
+   * @param callback Success callback, result is queued for `read` if empty.
+   */
+  virtual void uid_fetch(std::size_t uid,
+                         request::Fetch::FieldFlags field,
+                         std::size_t range = 1,
+                         const ResultCallback& callback = {}) = 0;
+
+  /**
+   * @brief Fetch mails by UID.
+   *
+   * @param uid Mail start UID.
+   * @param field Mail field.
+   * @param range UID range, 0 for all mails from `uid`.
+   * @param callback Typed success callback.
+   */
+  TEMAIL_INLINE void uid_fetch(std::size_t uid,
+                               request::Fetch::FieldFlags field,
+                               std::size_t range,
+                               const Callback<response::UidFetch>& callback)
+  {
+    uid_fetch(uid, field, range, _typed(callback));
+  }
+
+  /**
+   * @brief Fetch mails by UID.
+   *
+   * @param uid Mail start UID.
+   * @param field Mail field.
+   * @param range UID range, 0 for all mails from `uid`.
+   * @param callback Boxed success callback.
+   */
+  TEMAIL_INLINE void uid_fetch(std::size_t uid,
+                               request::Fetch::FieldFlags field,
+                               std::size_t range,
+                               const CommandCallback& callback)
+  {
+    uid_fetch(uid, field, range, _boxed(callback));
+  }
+
+  /**
+   * @brief Fetch mails of a UID set, such as a UID search result.
+   *
+   * @param uids Mail UIDs, must not be empty.
+   * @param field Mail field.
+   * @param callback Success callback, result is queued for `read` if empty.
+   */
+  virtual void uid_fetch(const SequenceSet& uids,
+                         request::Fetch::FieldFlags field,
+                         const ResultCallback& callback = {}) = 0;
+
+  /**
+   * @brief Fetch mails of a UID set.
+   *
+   * @param uids Mail UIDs, must not be empty.
+   * @param field Mail field.
+   * @param callback Typed success callback.
+   */
+  TEMAIL_INLINE void uid_fetch(const SequenceSet& uids,
+                               request::Fetch::FieldFlags field,
+                               const Callback<response::UidFetch>& callback)
+  {
+    uid_fetch(uids, field, _typed(callback));
+  }
+
+  /**
+   * @brief Fetch mails of a UID set.
+   *
+   * @param uids Mail UIDs, must not be empty.
+   * @param field Mail field.
+   * @param callback Boxed success callback.
+   */
+  TEMAIL_INLINE void uid_fetch(const SequenceSet& uids,
+                               request::Fetch::FieldFlags field,
+                               const CommandCallback& callback)
+  {
+    uid_fetch(uids, field, _boxed(callback));
+  }
+
+  /**
+   * @brief Fetch envelope, size and flags of a UID set into columns, for
+   * bulk header syncs.
+   *
+   * @param uids Mail UIDs, must not be empty.
+   * @param callback Success callback, result is queued for `read` if empty.
+   */
+  virtual void uid_fetch_envelopes(const SequenceSet& uids,
+                                   const ResultCallback& callback = {}) = 0;
+
+  /**
+   * @brief Fetch envelope, size and flags of a UID set into columns.
+   *
+   * @param uids Mail UIDs, must not be empty.
+   * @param callback Typed success callback.
+   */
+  TEMAIL_INLINE void uid_fetch_envelopes(
+    const SequenceSet& uids,
+    const Callback<response::Envelopes>& callback)
+  {
+    uid_fetch_envelopes(uids, _typed(callback));
+  }
+
+  /**
+   * @brief Fetch envelope, size and flags of a UID set into columns.
+   *
+   * @param uids Mail UIDs, must not be empty.
+   * @param callback Boxed success callback.
+   */
+  TEMAIL_INLINE void uid_fetch_envelopes(const SequenceSet& uids,
+                                         const CommandCallback& callback)
+  {
+    uid_fetch_envelopes(uids, _boxed(callback));
+  }
+
+  /**
+   * @brief Search mails, UIDs are returned instead of sequence numbers.
+   *
+   * @param query Search query, `Search::Criteria` converts to it.
+   * @param callback Success callback, result is queued for `read` if empty.
+   */
+  virtual void uid_search(const request::SearchQuery& query,
+                          const ResultCallback& callback = {}) = 0;
+
+  /**
+   * @brief Search mails, UIDs are returned instead of sequence numbers.
+   *
+   * @param query Search query, `Search::Criteria` converts to it.
+   * @param callback Typed success callback.
+   */
+  TEMAIL_INLINE void uid_search(const request::SearchQuery& query,
+                                const Callback<response::UidSearch>& callback)
+  {
+    uid_search(query, _typed(callback));
+  }
+
+  /**
+   * @brief Search mails, UIDs are returned instead of sequence numbers.
+   *
+   * @param query Search query, `Search::Criteria` converts to it.
+   * @param callback Boxed success callback.
+   */
+  TEMAIL_INLINE void uid_search(const request::SearchQuery& query,
+                                const CommandCallback& callback)
+  {
+    uid_search(query, _boxed(callback));
+  }
+
+  /**
+   * @brief Search mails by UID, only requested result data is sent.
+   *
+   * @note Needs ESEARCH (RFC 4731), a window needs PARTIAL (RFC 9394),
+   * servers without them answer BAD. `ALL` is dropped with a window.
+   *
+   * @param query Search query, `Search::Criteria` converts to it.
+   * @param options Result options, empty for `ALL`.
+   * @param partial Result window.
+   * @param callback Success callback, result is queued for `read` if empty.
+   */
+  virtual void uid_search(const request::SearchQuery& query,
+                          request::SearchReturn::Options options,
+                          request::SearchPartial partial = {},
+                          const ResultCallback& callback = {}) = 0;
+
+  /**
+   * @brief Search mails by UID, only requested result data is sent.
+   *
+   * @param query Search query, `Search::Criteria` converts to it.
+   * @param options Result options, empty for `ALL`.
+   * @param partial Result window.
+   * @param callback Typed success callback.
+   */
+  TEMAIL_INLINE void uid_search(const request::SearchQuery& query,
+                                request::SearchReturn::Options options,
+                                request::SearchPartial partial,
+                                const Callback<response::ESearch>& callback)
+  {
+    uid_search(query, options, partial, _typed(callback));
+  }
+
+  /**
+   * @brief Search mails by UID, only requested result data is sent.
+   *
+   * @param query Search query, `Search::Criteria` converts to it.
+   * @param options Result options, empty for `ALL`.
+   * @param partial Result window.
+   * @param callback Boxed success callback.
+   */
+  TEMAIL_INLINE void uid_search(const request::SearchQuery& query,
+                                request::SearchReturn::Options options,
+                                request::SearchPartial partial,
+                                const CommandCallback& callback)
+  {
+    uid_search(query, options, partial, _boxed(callback));
+  }
+
+  /**
+   * @brief Change flags of mails by UID.
+   *
+   * @param uid Mail start UID.
+   * @param range UID range, 0 for all mails from `uid`.
+   * @param action Store action.
+   * @param flags Flags, `\Recent` is never sent.
+   * @param callback Success callback with updated flags, result is queued
+   * for `read` if empty.
+   */
+  virtual void uid_store(std::size_t uid,
+                         std::size_t range,
+                         request::Store::Action action,
+                         const FlagSet& flags,
+                         const ResultCallback& callback = {}) = 0;
+
+  /**
+   * @brief Change flags of mails by UID.
+   *
+   * @param uid Mail start UID.
+   * @param range UID range, 0 for all mails from `uid`.
+   * @param action Store action.
+   * @param flags Flags, `\Recent` is never sent.
+   * @param callback Typed success callback.
+   */
+  TEMAIL_INLINE void uid_store(std::size_t uid,
+                               std::size_t range,
+                               request::Store::Action action,
+                               const FlagSet& flags,
+                               const Callback<response::UidFetch>& callback)
+  {
+    uid_store(uid, range, action, flags, _typed(callback));
+  }
+
+  /**
+   * @brief Change flags of mails by UID.
+   *
+   * @param uid Mail start UID.
+   * @param range UID range, 0 for all mails from `uid`.
+   * @param action Store action.
+   * @param flags Flags, `\Recent` is never sent.
+   * @param callback Boxed success callback.
+   */
+  TEMAIL_INLINE void uid_store(std::size_t uid,
+                               std::size_t range,
+                               request::Store::Action action,
+                               const FlagSet& flags,
+                               const CommandCallback& callback)
+  {
+    uid_store(uid, range, action, flags, _boxed(callback));
+  }
+
+  /**
+   * @brief Change flags of mails of a UID set.
+   *
+   * @param uids Mail UIDs, must not be empty.
+   * @param action Store action.
+   * @param flags Flags, `\Recent` is never sent.
+   * @param callback Success callback with updated flags, result is queued
+   * for `read` if empty.
    */
-  virtual void fetch(
-    std::size_t id,
+  virtual void uid_store(const SequenceSet& uids,
+                         request::Store::Action action,
+                         const FlagSet& flags,
+                         const ResultCallback& callback = {}) = 0;
+
+  /**
+   * @brief Change flags of mails of a UID set.
+   *
+   * @param uids Mail UIDs, must not be empty.
+   * @param action Store action.
+   * @param flags Flags, `\Recent` is never sent.
+   * @param callback Typed success callback.
+   */
+  TEMAIL_INLINE void uid_store(const SequenceSet& uids,
+                               request::Store::Action action,
+                               const FlagSet& flags,
+                               const Callback<response::UidFetch>& callback)
+  {
+    uid_store(uids, action, flags, _typed(callback));
+  }
+
+  /**
+   * @brief Change flags of mails of a UID set.
+   *
+   * @param uids Mail UIDs, must not be empty.
+   * @param action Store action.
+   * @param flags Flags, `\Recent` is never sent.
+   * @param callback Boxed success callback.
+   */
+  TEMAIL_INLINE void uid_store(const SequenceSet& uids,
+                               request::Store::Action action,
+                               const FlagSet& flags,
+                               const CommandCallback& callback)
+  {
+    uid_store(uids, action, flags, _boxed(callback));
+  }
+
+  /**
+   * @brief Select folder and resynchronize it (RFC 7162 QRESYNC), only mails
+   * changed or expunged since `modseq` are sent by the server.
+   *
+   * @param path Folder path.
+   * @param uidvalidity Known UIDVALIDITY, nothing is resynchronized if it
+   * mismatches.
+   * @param modseq Known HIGHESTMODSEQ.
+   * @param last_uid Largest known UID, 0 if unknown.
+   * @param callback Success callback, result is queued for `read` if empty.
+   * @note If `uidvalidity` or `modseq` is 0, such as for a folder never
+   * synced, the folder is selected with CONDSTORE and the result has no
+   * vanished or changed mails.
+   */
+  virtual void select_qresync(const QString& path,
+                              std::size_t uidvalidity,
+                              std::size_t modseq,
+                              std::size_t last_uid = 0,
+                              const ResultCallback& callback = {}) = 0;
+
+  /**
+   * @brief Select folder and resynchronize it (RFC 7162 QRESYNC).
+   *
+   * @param path Folder path.
+   * @param uidvalidity Known UIDVALIDITY.
+   * @param modseq Known HIGHESTMODSEQ.
+   * @param last_uid Largest known UID, 0 if unknown.
+   * @param callback Typed success callback.
+   */
+  TEMAIL_INLINE void select_qresync(const QString& path,
+                                    std::size_t uidvalidity,
+                                    std::size_t modseq,
+                                    std::size_t last_uid,
+                                    const Callback<response::Select>& callback)
+  {
+    select_qresync(path, uidvalidity, modseq, last_uid, _typed(callback));
+  }
+
+  /**
+   * @brief Select folder and resynchronize it (RFC 7162 QRESYNC).
+   *
+   * @param path Folder path.
+   * @param uidvalidity Known UIDVALIDITY.
+   * @param modseq Known HIGHESTMODSEQ.
+   * @param last_uid Largest known UID, 0 if unknown.
+   * @param callback Boxed success callback.
+   */
+  TEMAIL_INLINE void select_qresync(const QString& path,
+                                    std::size_t uidvalidity,
+                                    std::size_t modseq,
+                                    std::size_t last_uid,
+                                    const CommandCallback& callback)
+  {
+    select_qresync(path, uidvalidity, modseq, last_uid, _boxed(callback));
+  }
+
+  /**
+   * @brief Fetch flags (and `field`) of mails changed since `modseq`, UIDs
+   * expunged since then are reported too (CHANGEDSINCE, VANISHED).
+   *
+   * @param uid Mail start UID.
+   * @param field Mail field, flags are always fetched.
+   * @param range UID range, 0 for all mails from `uid`.
+   * @param modseq Known HIGHESTMODSEQ.
+   * @param callback Success callback, result is queued for `read` if empty.
+   */
+  virtual void uid_fetch_changed(std::size_t uid,
+                                 request::Fetch::FieldFlags field,
+                                 std::size_t range,
+                                 std::size_t modseq,
+                                 const ResultCallback& callback = {}) = 0;
+
+  /**
+   * @brief Fetch mails changed since `modseq`.
+   *
+   * @param uid Mail start UID.
+   * @param field Mail field, flags are always fetched.
+   * @param range UID range, 0 for all mails from `uid`.
+   * @param modseq Known HIGHESTMODSEQ.
+   * @param callback Typed success callback.
+   */
+  TEMAIL_INLINE void uid_fetch_changed(
+    std::size_t uid,
     request::Fetch::FieldFlags field,
-    std::size_t range = 1,
-    const CommandCallback& callback = _default_command_handler) = 0;
+    std::size_t range,
+    std::size_t modseq,
+    const Callback<response::UidFetch>& callback)
+  {
+    uid_fetch_changed(uid, field, range, modseq, _typed(callback));
+  }
+
+  /**
+   * @brief Fetch mails changed since `modseq`.
+   *
+   * @param uid Mail start UID.
+   * @param field Mail field, flags are always fetched.
+   * @param range UID range, 0 for all mails from `uid`.
+   * @param modseq Known HIGHESTMODSEQ.
+   * @param callback Boxed success callback.
+   */
+  TEMAIL_INLINE void uid_fetch_changed(std::size_t uid,
+                                       request::Fetch::FieldFlags field,
+                                       std::size_t range,
+                                       std::size_t modseq,
+                                       const CommandCallback& callback)
+  {
+    uid_fetch_changed(uid, field, range, modseq, _boxed(callback));
+  }
+
+  /**
+   * @brief Upload mails into a folder, bodies are streamed from their
+   * devices.
+   *
+   * @param path Folder path.
+   * @param messages Mails to upload.
+   * @param callback Success callback, result is queued for `read` if empty.
+   * @note Without MULTIAPPEND each mail is sent as a command of its own, the
+   * result still holds the UIDs of all mails and the first failure is
+   * reported once.
+   */
+  virtual void append(const QString& path,
+                      const QList<request::AppendMessage>& messages,
+                      const ResultCallback& callback = {}) = 0;
+
+  /**
+   * @brief Upload mails into a folder.
+   *
+   * @param path Folder path.
+   * @param messages Mails to upload.
+   * @param callback Typed success callback.
+   */
+  TEMAIL_INLINE void append(const QString& path,
+                            const QList<request::AppendMessage>& messages,
+                            const Callback<response::Append>& callback)
+  {
+    append(path, messages, _typed(callback));
+  }
+
+  /**
+   * @brief Upload mails into a folder.
+   *
+   * @param path Folder path.
+   * @param messages Mails to upload.
+   * @param callback Boxed success callback.
+   */
+  TEMAIL_INLINE void append(const QString& path,
+                            const QList<request::AppendMessage>& messages,
+                            const CommandCallback& callback)
+  {
+    append(path, messages, _boxed(callback));
+  }
+
+  /**
+   * @brief Take the oldest queued response.
+   *
+   * @return response::Result Response, `std::monostate` if queue is empty.
+   */
+  virtual response::Result read_result() = 0;
+
+  /**
+   * @brief Take the oldest queued response, moved out without boxing.
+   *
+   * @note The response is consumed even if it does not hold `T`.
+   *
+   * @tparam T Response type.
+   * @return std::optional<T> Response, empty if queue is empty or type
+   * mismatches.
+   */
+  template<typename T>
+  std::optional<T> read()
+  {
+    auto result = read_result();
+    if (auto* value = std::get_if<T>(&result)) {
+      return std::move(*value);
+    }
+    return std::nullopt;
+  }
 
   /**
    * @brief Read response.
    *
    * @return QVariant Response.
    */
-  virtual QVariant read() = 0;
+  TEMAIL_INLINE QVariant read() { return response::to_variant(read_result()); }
 
   /**
    * @brief Wait for `connected` signal.
@@ -285,6 +1068,54 @@ protected:
   {
   }
 
+  /**
+   * @brief Adapt typed callback, responses of other types are reported as
+   * `E_PARSE` instead of reaching the callback.
+   *
+   * @note Callbacks of other threads run there, so the error is posted to
+   * the client thread, where waiters are woken by `error_occurred`.
+   *
+   * @tparam T Response type.
+   * @param callback Typed callback.
+   * @return ResultCallback Adapted callback.
+   */
+  template<typename T>
+  ResultCallback _typed(const Callback<T>& callback)
+  {
+    return [client = QPointer<Base>{ this },
+            callback](response::Result&& data) {
+      if (auto* value = std::get_if<T>(&data)) {
+        callback(std::move(*value));
+        return;
+      }
+
+      if (client.isNull()) {
+        return;
+      }
+      QMetaObject::invokeMethod(
+        client.data(),
+        [client] {
+          if (!client.isNull()) {
+            client->_set_error(E_PARSE, "Unexpected response type");
+          }
+        },
+        Qt::QueuedConnection);
+    };
+  }
+
+  /**
+   * @brief Adapt boxed callback.
+   *
+   * @param callback Boxed callback.
+   * @return ResultCallback Adapted callback.
+   */
+  static ResultCallback _boxed(const CommandCallback& callback)
+  {
+    return [callback](response::Result&& data) {
+      callback(response::to_variant(std::move(data)));
+    };
+  }
+
   /**
    * @brief Wait for specific signal.
    *
@@ -0,0 +1,179 @@
+/**
+ * @file body.hpp
+ * @author Dessera (dessera@qq.com)
+ * @brief Temail content-addressed mail body store.
+ * @version 0.1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2025 Dessera
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <qbytearray.h>
+#include <qfile.h>
+#include <qhash.h>
+#include <qmutex.h>
+#include <qstring.h>
+#include <qtypes.h>
+
+#include "temail/common.hpp"
+
+namespace temail::client {
+
+/**
+ * @brief Local store of mail bodies keyed by their SHA-256 digest, so a body
+ * shared by several folders or accounts is kept once.
+ *
+ * Bodies are compressed with `qCompress` and appended to pack files, an
+ * EMAILID (RFC 8474) may be attached to a body so it can be found before
+ * downloading it. The index is rebuilt from the packs when constructed.
+ *
+ * @note Thread safe, a directory must be used by one store at a time.
+ */
+class TEMAIL_PUBLIC BodyStore
+{
+public:
+  using Hash = QByteArray; /**< Raw SHA-256 digest, 32 bytes. */
+
+  constexpr static qint64 PACK_SIZE =
+    64 * 1024 * 1024; /**< A new pack is started once the last one is
+                         larger. */
+
+  /**
+   * @brief Store usage.
+   *
+   */
+  struct Stats
+  {
+    std::size_t bodies{ 0 };       /**< Distinct bodies. */
+    std::size_t emailids{ 0 };     /**< EMAILIDs attached to bodies. */
+    std::size_t raw_bytes{ 0 };    /**< Body bytes before compression. */
+    std::size_t packed_bytes{ 0 }; /**< Body bytes in packs. */
+  };
+
+private:
+  /**
+   * @brief Body position in the packs.
+   *
+   */
+  struct Location
+  {
+    uint32_t pack{ 0 };
+    qint64 offset{ 0 };     /**< Compressed bytes offset. */
+    uint32_t size{ 0 };     /**< Compressed size. */
+    uint32_t raw_size{ 0 }; /**< Body size. */
+  };
+
+  QString _directory;
+  mutable QMutex _lock;
+  QHash<Hash, Location> _bodies;
+  QHash<QString, Hash> _emailids;
+  QFile _pack; /**< Last pack, opened for appending. */
+  uint32_t _pack_index{ 0 };
+  Stats _stats;
+
+public:
+  /**
+   * @brief Construct a new store and index its packs.
+   *
+   * @param directory Directory of pack files, created if missing.
+   */
+  explicit BodyStore(QString directory);
+
+  ~BodyStore() = default;
+
+  BodyStore(const BodyStore&) = delete;
+  BodyStore& operator=(const BodyStore&) = delete;
+  BodyStore(BodyStore&&) = delete;
+  BodyStore& operator=(BodyStore&&) = delete;
+
+  /**
+   * @brief Add a body, nothing is written if it is already stored.
+   *
+   * @param body Mail body.
+   * @param emailid EMAILID to attach, empty for none.
+   * @return Hash Body digest, empty if writing failed.
+   */
+  Hash put(const QByteArray& body, const QString& emailid = {});
+
+  /**
+   * @brief Read a body.
+   *
+   * @param hash Body digest.
+   * @return std::optional<QByteArray> Body, empty if missing or corrupted.
+   */
+  [[nodiscard]] std::optional<QByteArray> get(const Hash& hash) const;
+
+  /**
+   * @brief Read a body by EMAILID.
+   *
+   * @param emailid EMAILID (RFC 8474).
+   * @return std::optional<QByteArray> Body, empty if missing or corrupted.
+   */
+  [[nodiscard]] std::optional<QByteArray> find(const QString& emailid) const;
+
+  /**
+   * @brief Check if a body is stored.
+   *
+   * @param hash Body digest.
+   */
+  [[nodiscard]] bool contains(const Hash& hash) const;
+
+  /**
+   * @brief Get store usage.
+   *
+   */
+  [[nodiscard]] Stats stats() const;
+
+  /**
+   * @brief Compute the digest a body is stored under.
+   *
+   * @param body Mail body.
+   * @return Hash Raw SHA-256 digest.
+   */
+  static Hash hash(const QByteArray& body);
+
+private:
+  /**
+   * @brief Index all packs, a truncated tail of the last one is cut off.
+   *
+   */
+  void _load();
+
+  /**
+   * @brief Index records of a pack.
+   *
+   * @param index Pack index.
+   * @return qint64 End of the last complete record, -1 if not a pack.
+   */
+  qint64 _load_pack(uint32_t index);
+
+  /**
+   * @brief Open the last pack for appending, starting a new one if full.
+   *
+   * @return true If a pack is ready.
+   */
+  bool _open_pack();
+
+  /**
+   * @brief Read a body without locking.
+   *
+   * @param hash Body digest.
+   * @return std::optional<QByteArray> Body, empty if missing or corrupted.
+   */
+  [[nodiscard]] std::optional<QByteArray> _get(const Hash& hash) const;
+
+  /**
+   * @brief Get path of a pack.
+   *
+   * @param index Pack index.
+   */
+  [[nodiscard]] QString _pack_path(uint32_t index) const;
+};
+
+}
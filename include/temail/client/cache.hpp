@@ -0,0 +1,300 @@
+/**
+ * @file cache.hpp
+ * @author Dessera (dessera@qq.com)
+ * @brief Temail IMAP4 mailbox metadata cache.
+ * @version 0.1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2025 Dessera
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <qfile.h>
+#include <qlist.h>
+#include <qmap.h>
+#include <qstring.h>
+
+#include "temail/client/base.hpp"
+#include "temail/client/flags.hpp"
+#include "temail/client/request.hpp"
+#include "temail/client/response.hpp"
+#include "temail/client/sequence.hpp"
+#include "temail/common.hpp"
+
+namespace temail::client {
+
+/**
+ * @brief On-disk cache of mail metadata (flags, envelope, size, modseq) keyed
+ * by UID, one memory-mapped file per mailbox.
+ *
+ * Records are read from the mapping on demand, updates are kept in memory
+ * until `flush`. The cache is fed by the caller with SELECT and FETCH
+ * results, a UIDVALIDITY change drops all records.
+ *
+ * @code
+ * cache.open("INBOX");
+ * client.select_qresync("INBOX", cache.uidvalidity(), cache.highestmodseq(),
+ *                       last_uid, [&](const response::Select& select) {
+ *                         cache.update(select);
+ *                         cache.set_highestmodseq(select.highestmodseq);
+ *                       });
+ * @endcode
+ *
+ * @note Not thread safe, a file must be opened by one cache at a time.
+ */
+class TEMAIL_PUBLIC IMAPCache
+{
+public:
+  /**
+   * @brief Cached mail.
+   *
+   */
+  struct Record
+  {
+    SequenceSet::Id uid{ 0 };
+    request::Fetch::FieldFlags fields; /**< Fetched SIZE, FLAGS, ENVELOPE. */
+    std::size_t size{ 0 };             /**< RFC822.SIZE, 0 if unknown. */
+    std::size_t modseq{ 0 };           /**< MODSEQ, 0 if never fetched. */
+    FlagSet flags;
+    response::FetchEnvelope envelope; /**< Empty if never fetched. */
+  };
+
+private:
+  QString _directory;
+  QString _mailbox;
+  QFile _file;
+  const uchar* _map{ nullptr };
+
+  std::size_t _uidvalidity{ 0 };
+  std::size_t _highestmodseq{ 0 };
+  bool _cleared{ false };  /**< Mapped records are dropped. */
+  bool _modified{ false }; /**< Needs flush. */
+  QMap<SequenceSet::Id, Record> _dirty; /**< Records newer than the map. */
+  SequenceSet _removed;                 /**< Mapped records removed. */
+
+public:
+  /**
+   * @brief Construct a new cache.
+   *
+   * @param directory Directory of cache files, created on first flush.
+   */
+  explicit IMAPCache(QString directory);
+
+  /**
+   * @brief Flush and close the opened mailbox.
+   *
+   */
+  ~IMAPCache();
+
+  IMAPCache(const IMAPCache&) = delete;
+  IMAPCache& operator=(const IMAPCache&) = delete;
+  IMAPCache(IMAPCache&&) = delete;
+  IMAPCache& operator=(IMAPCache&&) = delete;
+
+  /**
+   * @brief Open the cache of a mailbox, flushing the previous one.
+   *
+   * @param mailbox Mailbox path.
+   * @param uidvalidity Known UIDVALIDITY, records are dropped if it differs
+   * from the cached one, 0 to keep them.
+   * @note A missing or corrupted file opens as an empty cache.
+   */
+  void open(const QString& mailbox, std::size_t uidvalidity = 0);
+
+  /**
+   * @brief Flush and close the opened mailbox.
+   *
+   */
+  void close();
+
+  /**
+   * @brief Check if a mailbox is opened.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE bool is_open() const
+  {
+    return !_mailbox.isEmpty();
+  }
+
+  /**
+   * @brief Get opened mailbox path.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE auto& mailbox() const { return _mailbox; }
+
+  /**
+   * @brief Get cached UIDVALIDITY, 0 if unknown.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE std::size_t uidvalidity() const
+  {
+    return _uidvalidity;
+  }
+
+  /**
+   * @brief Get HIGHESTMODSEQ the cache is synced to, 0 if unknown.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE std::size_t highestmodseq() const
+  {
+    return _highestmodseq;
+  }
+
+  /**
+   * @brief Mark the cache synced to a HIGHESTMODSEQ, call it only once all
+   * changes up to `modseq` are applied.
+   *
+   * @param modseq HIGHESTMODSEQ.
+   */
+  void set_highestmodseq(std::size_t modseq);
+
+  /**
+   * @brief Find a cached mail, O(log n) without network traffic.
+   *
+   * @param uid UID.
+   * @return std::optional<Record> Record, empty if not cached.
+   */
+  [[nodiscard]] std::optional<Record> find(SequenceSet::Id uid) const;
+
+  /**
+   * @brief Find cached mails.
+   *
+   * @param uids UIDs, `*` is not expanded.
+   * @return QList<Record> Records in ascending UID order, missing ones are
+   * skipped.
+   */
+  [[nodiscard]] QList<Record> find(const SequenceSet& uids) const;
+
+  /**
+   * @brief Get all cached UIDs.
+   *
+   */
+  [[nodiscard]] SequenceSet uids() const;
+
+  /**
+   * @brief Get UIDs of `uids` which are not cached, ready for UID FETCH.
+   *
+   * @param uids Wanted UIDs, `*` is not expanded.
+   */
+  [[nodiscard]] SequenceSet missing(const SequenceSet& uids) const;
+
+  /**
+   * @brief Evaluate a query against cached mails, without network traffic.
+   *
+   * @note Keys on internal date, body, sequence numbers and `\Recent` need
+   * the server, so do mails whose fields a key needs were never fetched.
+   *
+   * @param query Search query.
+   * @return std::optional<SequenceSet> Matching UIDs, empty if the query
+   * needs the server.
+   */
+  [[nodiscard]] std::optional<SequenceSet> search(
+    const request::SearchQuery& query) const;
+
+  /**
+   * @brief UID SEARCH answered by the cache if it is synced to
+   * `highestmodseq`, by the server otherwise.
+   *
+   * @param client Client which has selected the opened mailbox.
+   * @param query Search query.
+   * @param highestmodseq Current HIGHESTMODSEQ of the mailbox, such as the
+   * one of the last SELECT.
+   * @param callback Result callback, invoked before returning if the cache
+   * answered.
+   */
+  void uid_search(Base& client,
+                  const request::SearchQuery& query,
+                  std::size_t highestmodseq,
+                  const Base::Callback<response::UidSearch>& callback) const;
+
+  /**
+   * @brief Apply a SELECT result: a new UIDVALIDITY drops all records, then
+   * QRESYNC vanished and changed mails are applied.
+   *
+   * @param select SELECT result.
+   */
+  void update(const response::Select& select);
+
+  /**
+   * @brief Apply a UID FETCH result, a new UIDVALIDITY drops all records.
+   *
+   * @param fetch UID FETCH result.
+   */
+  void update(const response::UidFetch& fetch);
+
+  /**
+   * @brief Merge fetched fields into a record, items without UID are
+   * ignored.
+   *
+   * @param item Fetched mail.
+   */
+  void update(const response::FetchItem& item);
+
+  /**
+   * @brief Remove expunged mails.
+   *
+   * @param uids UIDs.
+   */
+  void remove(const SequenceSet& uids);
+
+  /**
+   * @brief Drop all records, keeping the mailbox opened.
+   *
+   * @param uidvalidity New UIDVALIDITY.
+   */
+  void clear(std::size_t uidvalidity = 0);
+
+  /**
+   * @brief Write pending updates to disk, atomically replacing the file.
+   *
+   * @return true If the file is up to date.
+   */
+  bool flush();
+
+private:
+  /**
+   * @brief Map the file of the opened mailbox.
+   *
+   */
+  void _map_file();
+
+  /**
+   * @brief Unmap and close the file.
+   *
+   */
+  void _unmap_file();
+
+  /**
+   * @brief Get mapped record count.
+   *
+   */
+  [[nodiscard]] std::size_t _mapped_count() const;
+
+  /**
+   * @brief Read a mapped record.
+   *
+   * @param index Entry index, must be less than `_mapped_count()`.
+   */
+  [[nodiscard]] Record _mapped_record(std::size_t index) const;
+
+  /**
+   * @brief Find a mapped record, ignoring the in-memory updates.
+   *
+   * @param uid UID.
+   * @return std::optional<Record> Record, empty if not mapped.
+   */
+  [[nodiscard]] std::optional<Record> _find_mapped(SequenceSet::Id uid) const;
+
+  /**
+   * @brief Get cache file path of the opened mailbox.
+   *
+   */
+  [[nodiscard]] QString _file_path() const;
+};
+
+}
@@ -0,0 +1,170 @@
+/**
+ * @file coroutine.hpp
+ * @author Dessera (dessera@qq.com)
+ * @brief C++20 coroutine interface of mail clients.
+ * @version 0.1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2025 Dessera
+ *
+ */
+
+#pragma once
+
+#if !defined(TEMAIL_COROUTINE)
+#error "temail/client/coroutine.hpp requires the 'coroutine' build option."
+#endif
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <qstring.h>
+#include <utility>
+#include <variant>
+
+#include "temail/client/imap.hpp"
+#include "temail/client/request.hpp"
+#include "temail/client/response.hpp"
+
+namespace temail::client {
+
+/**
+ * @brief Result of an awaited command.
+ *
+ * @tparam T Response type.
+ */
+template<typename T>
+struct CommandResult
+{
+  Base::ErrorType error{ Base::E_NOERR }; /**< Error type. */
+  QString estr;                           /**< Error string. */
+  T value{};                              /**< Response, valid without error. */
+
+  /**
+   * @brief Check if the command succeeded.
+   *
+   */
+  explicit operator bool() const { return error == Base::E_NOERR; }
+};
+
+/**
+ * @brief Awaiter of a single IMAP4 command.
+ *
+ * @note The command is submitted when the coroutine suspends, and the
+ * coroutine is resumed by the tagged completion in the thread that awaited
+ * it, so the usual thread affinity of callbacks is preserved. Awaiters do not
+ * block any event loop.
+ *
+ * @tparam T Response type.
+ */
+template<typename T>
+class CommandAwaiter
+{
+private:
+  IMAP* _client;
+  IMAP::Command _type;
+  QString _cmd;
+  CommandResult<T> _result;
+
+public:
+  /**
+   * @brief Construct a new command awaiter.
+   *
+   * @param client IMAP4 client.
+   * @param type Command type.
+   * @param cmd Command string without tag.
+   */
+  CommandAwaiter(IMAP* client, IMAP::Command type, QString cmd)
+    : _client{ client }
+    , _type{ type }
+    , _cmd{ std::move(cmd) }
+  {
+  }
+
+  [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+  void await_suspend(std::coroutine_handle<> handle)
+  {
+    _client->_request(
+      _type,
+      _cmd,
+      [this, handle](response::Result&& data) {
+        if (auto* value = std::get_if<T>(&data)) {
+          _result.value = std::move(*value);
+        } else {
+          _result.error = Base::E_PARSE;
+          _result.estr = "Unexpected response type";
+        }
+        handle.resume();
+      },
+      {},
+      [this, handle](Base::ErrorType error, const QString& estr) {
+        _result.error = error;
+        _result.estr = estr;
+        handle.resume();
+      });
+  }
+
+  CommandResult<T> await_resume() { return std::move(_result); }
+};
+
+/**
+ * @brief Fire-and-forget coroutine, starts eagerly and frees itself.
+ *
+ * @code {.cpp}
+ * temail::client::Task
+ * run(temail::client::IMAP& client)
+ * {
+ *   auto login = co_await client.async_login("user", "password");
+ *   if (!login) {
+ *     co_return;
+ *   }
+ *   auto search = co_await client.async_search(Search::ALL);
+ * }
+ * @endcode
+ */
+struct Task
+{
+  struct promise_type
+  {
+    Task get_return_object() noexcept { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { std::terminate(); }
+  };
+};
+
+inline CommandAwaiter<response::Login>
+IMAP::async_login(const QString& username, const QString& password)
+{
+  return { this, Command::LOGIN, _login_command(username, password) };
+}
+
+inline CommandAwaiter<response::List>
+IMAP::async_list(const QString& path, const QString& pattern)
+{
+  return { this, Command::LIST, _list_command(path, pattern) };
+}
+
+inline CommandAwaiter<response::Select>
+IMAP::async_select(const QString& path)
+{
+  return { this, Command::SELECT, _select_command(path) };
+}
+
+inline CommandAwaiter<response::Search>
+IMAP::async_search(const request::SearchQuery& query)
+{
+  return { this, Command::SEARCH, _search_command(query) };
+}
+
+inline CommandAwaiter<response::Fetch>
+IMAP::async_fetch(std::size_t id,
+                  request::Fetch::FieldFlags field,
+                  std::size_t range)
+{
+  return { this, Command::FETCH, _fetch_command(_id_set(id, range), field) };
+}
+
+}
@@ -0,0 +1,256 @@
+/**
+ * @file flags.hpp
+ * @author Dessera (dessera@qq.com)
+ * @brief Temail IMAP4 flag set.
+ * @version 0.1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2025 Dessera
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <qdebug.h>
+#include <qflags.h>
+#include <qlist.h>
+#include <qmetatype.h>
+#include <qstring.h>
+#include <qstringlist.h>
+#include <qstringview.h>
+
+#include "temail/common.hpp"
+
+namespace temail::client {
+
+/**
+ * @brief Set of mail flags or mailbox attributes, such as FLAGS,
+ * PERMANENTFLAGS or LIST attributes.
+ *
+ * Flags and attributes defined by the RFCs are bits, keywords such as
+ * `$Forwarded` are atoms interned once per process, so comparing and
+ * filtering sets never compares strings.
+ *
+ * @note Keywords are case-insensitive, as in IMAP4.
+ */
+class TEMAIL_PUBLIC FlagSet
+{
+public:
+  using Atom = uint32_t; /**< Interned keyword. */
+
+  /**
+   * @brief Flags and attributes with a bit.
+   *
+   */
+  enum Flag : uint32_t
+  {
+    SEEN = 1U << 0,             /**< `\Seen`. */
+    ANSWERED = 1U << 1,         /**< `\Answered`. */
+    FLAGGED = 1U << 2,          /**< `\Flagged`, also special-use. */
+    DELETED = 1U << 3,          /**< `\Deleted`. */
+    DRAFT = 1U << 4,            /**< `\Draft`. */
+    RECENT = 1U << 5,           /**< `\Recent`. */
+    ANY_KEYWORD = 1U << 6,      /**< `\*` of PERMANENTFLAGS. */
+    NOINFERIORS = 1U << 8,      /**< `\Noinferiors`. */
+    NOSELECT = 1U << 9,         /**< `\Noselect`. */
+    MARKED = 1U << 10,          /**< `\Marked`. */
+    UNMARKED = 1U << 11,        /**< `\Unmarked`. */
+    HAS_CHILDREN = 1U << 12,    /**< `\HasChildren` (RFC 3348). */
+    HAS_NO_CHILDREN = 1U << 13, /**< `\HasNoChildren` (RFC 3348). */
+    NONEXISTENT = 1U << 14,     /**< `\NonExistent` (RFC 5258). */
+    SUBSCRIBED = 1U << 15,      /**< `\Subscribed` (RFC 5258). */
+    REMOTE = 1U << 16,          /**< `\Remote` (RFC 5258). */
+    ALL = 1U << 17,             /**< `\All` (RFC 6154). */
+    ARCHIVE = 1U << 18,         /**< `\Archive` (RFC 6154). */
+    DRAFTS = 1U << 19,          /**< `\Drafts` (RFC 6154). */
+    JUNK = 1U << 20,            /**< `\Junk` (RFC 6154). */
+    SENT = 1U << 21,            /**< `\Sent` (RFC 6154). */
+    TRASH = 1U << 22,           /**< `\Trash` (RFC 6154). */
+    IMPORTANT = 1U << 23,       /**< `\Important` (RFC 8457). */
+  };
+
+  Q_DECLARE_FLAGS(Flags, Flag)
+
+  constexpr static Flags SYSTEM_FLAGS = Flags::fromInt(
+    SEEN | ANSWERED | FLAGGED | DELETED | DRAFT |
+    RECENT); /**< Mail system flags, the low 8 bits. */
+
+private:
+  Flags _flags;
+  QList<Atom> _keywords; /**< Sorted, unique. */
+
+public:
+  FlagSet() = default;
+
+  /**
+   * @brief Construct a set of flags without keywords.
+   *
+   * @param flags Flags.
+   */
+  FlagSet(Flags flags)
+    : _flags{ flags }
+  {
+  }
+
+  /**
+   * @brief Add a flag.
+   *
+   * @param flag Flag.
+   */
+  TEMAIL_INLINE void insert(Flag flag) { _flags |= flag; }
+
+  /**
+   * @brief Add a flag by name.
+   *
+   * @param flag Flag such as `\Seen` or `$Forwarded`, unknown `\` names are
+   * kept as keywords.
+   */
+  void insert(QStringView flag);
+
+  /**
+   * @brief Remove a flag.
+   *
+   * @param flag Flag.
+   */
+  TEMAIL_INLINE void remove(Flag flag) { _flags.setFlag(flag, false); }
+
+  /**
+   * @brief Remove a flag by name.
+   *
+   * @param flag Flag such as `\Seen` or `$Forwarded`.
+   */
+  void remove(QStringView flag);
+
+  /**
+   * @brief Check if a flag is set.
+   *
+   * @param flag Flag.
+   */
+  [[nodiscard]] TEMAIL_INLINE bool test(Flag flag) const
+  {
+    return _flags.testFlag(flag);
+  }
+
+  /**
+   * @brief Check if a flag is set by name, without interning it.
+   *
+   * @param flag Flag such as `\Seen` or `$Forwarded`.
+   */
+  [[nodiscard]] bool contains(QStringView flag) const;
+
+  /**
+   * @brief Check if all flags and keywords of another set are set.
+   *
+   * @param other Flag set.
+   */
+  [[nodiscard]] bool contains(const FlagSet& other) const;
+
+  /**
+   * @brief Get flags with a bit.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE Flags flags() const { return _flags; }
+
+  /**
+   * @brief Get keyword atoms in ascending order.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE const QList<Atom>& keywords() const
+  {
+    return _keywords;
+  }
+
+  /**
+   * @brief Check if set is empty.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE bool empty() const
+  {
+    return !_flags && _keywords.isEmpty();
+  }
+
+  /**
+   * @brief Remove all flags.
+   *
+   */
+  TEMAIL_INLINE void clear()
+  {
+    _flags = {};
+    _keywords.clear();
+  }
+
+  /**
+   * @brief Get flag names, bits first.
+   *
+   * @return QStringList Names such as `\Seen`.
+   */
+  [[nodiscard]] QStringList to_list() const;
+
+  /**
+   * @brief Format as a space separated IMAP4 flag list, without parentheses.
+   *
+   * @return QString Flags such as `\Seen $Forwarded`.
+   */
+  [[nodiscard]] QString to_string() const;
+
+  /**
+   * @brief Parse an IMAP4 flag list.
+   *
+   * @param list Flags such as `(\Seen $Forwarded)`, parentheses are optional.
+   * @return FlagSet Parsed set.
+   */
+  static FlagSet parse(QStringView list);
+
+  /**
+   * @brief Intern a keyword, atoms are valid for the process lifetime.
+   *
+   * @param keyword Keyword such as `$Forwarded`.
+   * @return Atom Keyword atom.
+   */
+  static Atom intern(QStringView keyword);
+
+  /**
+   * @brief Get name of an interned keyword.
+   *
+   * @param atom Keyword atom.
+   * @return QString Keyword as first interned, empty if unknown.
+   */
+  static QString name(Atom atom);
+
+  friend bool operator==(const FlagSet& lhs, const FlagSet& rhs)
+  {
+    return lhs._flags == rhs._flags && lhs._keywords == rhs._keywords;
+  }
+
+private:
+  /**
+   * @brief Find the bit of a flag name.
+   *
+   * @param flag Flag name.
+   * @return std::optional<Flag> Bit, empty if the name is a keyword.
+   */
+  static std::optional<Flag> _flag(QStringView flag);
+
+  /**
+   * @brief Find an interned keyword.
+   *
+   * @param keyword Keyword.
+   * @return std::optional<Atom> Atom, empty if never interned.
+   */
+  static std::optional<Atom> _find(QStringView keyword);
+};
+
+}
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(temail::client::FlagSet::Flags)
+
+Q_DECLARE_METATYPE(temail::client::FlagSet)
+
+TEMAIL_INLINE QDebug&
+operator<<(QDebug& dbg, const temail::client::FlagSet& set)
+{
+  return dbg.noquote() << QString{ "FlagSet[%1]" }.arg(set.to_string());
+}
@@ -11,12 +11,17 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <deque>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <qanystringview.h>
+#include <qbytearray.h>
+#include <qdatetime.h>
 #include <qeventloop.h>
 #include <qlist.h>
 #include <qmap.h>
@@ -25,15 +30,21 @@
 #include <qqueue.h>
 #include <qregularexpression.h>
 #include <qsslsocket.h>
+#include <qstringlist.h>
 #include <qtimer.h>
 #include <qtmetamacros.h>
+#include <qtypes.h>
 #include <queue>
 #include <qvariant.h>
 #include <utility>
 #include <vector>
 
 #include "temail/client/base.hpp"
+#include "temail/client/body.hpp"
+#include "temail/client/flags.hpp"
 #include "temail/client/request.hpp"
+#include "temail/client/response.hpp"
+#include "temail/client/sequence.hpp"
 #include "temail/common.hpp"
 #include "temail/tag.hpp"
 
@@ -42,9 +53,14 @@ namespace temail::client {
 namespace detail {
 
 class IMAPResponse;
+class IMAPSubmitQueue;
+class IMAPDeflate;
 
 }
 
+template<typename T>
+class CommandAwaiter;
+
 /**
  * @brief IMAP4 client.
  *
@@ -88,6 +104,9 @@ public:
     MAILBOX,    /**< MAILBOX response. */
     COPY,       /**< COPY response. */
     STORE,      /**< STORE response. */
+    ENABLED,    /**< ENABLED response (RFC 5161). */
+    VANISHED,   /**< VANISHED response (RFC 7162). */
+    ESEARCH,    /**< ESEARCH response (RFC 4731). */
   };
 
   Q_ENUM(Response)
@@ -104,51 +123,213 @@ public:
     SELECT, /**< SELECT command. */
     NOOP,   /**< NOOP command. */
     SEARCH, /**< SEARCH command. */
-    FETCH,  /**< FETCH command. */
-    NOCMD,  /**< No command. */
+    FETCH,      /**< FETCH command. */
+    UID_FETCH,  /**< UID FETCH command. */
+    UID_SEARCH, /**< UID SEARCH command. */
+    UID_STORE,  /**< UID STORE command. */
+    ENABLE,     /**< ENABLE command. */
+    IDLE,       /**< IDLE command. */
+    COMPRESS,   /**< COMPRESS command (RFC 4978). */
+    APPEND,     /**< APPEND command. */
+    CAPABILITY, /**< CAPABILITY command. */
+    NOCMD,      /**< No command. */
   };
 
   Q_ENUM(Command)
 
   using ResponseHandler = std::function<
-    void(const detail::IMAPResponse&, ErrorCallback, CommandCallback)>;
+    void(detail::IMAPResponse&, ErrorCallback, ResultCallback)>;
 
   constexpr static uint16_t PORT_NO_SSL =
     143; /**< Default port when don't using SSL. */
   constexpr static uint16_t PORT_USE_SSL =
     993; /**< Default port when using SSL. */
 
-  inline static const QString CONNECT_TAG =
-    "CONNECT"; /**< Response tag used by connect. */
-  inline static const QString DISCONNECT_TAG =
-    "DISCONNECT"; /**< Response tag used by disconnect. */
+  constexpr static TagGenerator::Tag CONNECT_TAG =
+    std::numeric_limits<TagGenerator::Tag>::max(); /**< Response tag used by
+                                                      connect. */
+  constexpr static TagGenerator::Tag DISCONNECT_TAG =
+    CONNECT_TAG - 1; /**< Response tag used by disconnect. */
+
+  constexpr static int IDLE_RESTART_MSECS =
+    29 * 60 * 1000; /**< IDLE is restarted before the 30 minutes server
+                       timeout (RFC 2177). */
+
+  constexpr static qint64 UPLOAD_CHUNK_SIZE =
+    64 * 1024; /**< APPEND bytes read from a device at once. */
+  constexpr static qint64 UPLOAD_BUFFER_SIZE =
+    256 * 1024; /**< APPEND pauses while more bytes are unsent. */
+  constexpr static qint64 LITERAL_MINUS_MAX =
+    4096; /**< Largest non-synchronizing literal with LITERAL- (RFC 7888). */
+
+  constexpr static std::size_t INITIAL_SLOTS =
+    64; /**< Initial callback slots, must be power of 2. */
 
   inline static const QMap<request::Fetch::Field, QString> FETCH_FIELD{
     { request::Fetch::ENVELOPE,
       "BODY.PEEK[HEADER.FIELDS (DATE SUBJECT FROM TO)]" },
     { request::Fetch::MIME,
       "BODY.PEEK[HEADER.FIELDS (CONTENT-TYPE)] BODY.PEEK[1.MIME]" },
-    { request::Fetch::TEXT, "BODY[1]" }
+    { request::Fetch::TEXT, "BODY[1]" },
+    { request::Fetch::SIZE, "RFC822.SIZE" },
+    { request::Fetch::FLAGS, "FLAGS" },
+    { request::Fetch::EMAILID, "EMAILID" },
   }; /**< Request fetch field to command map. */
 
+  inline static const QMap<request::Store::Action, QString> STORE_ACTION{
+    { request::Store::SET, "" },
+    { request::Store::ADD, "+" },
+    { request::Store::REMOVE, "-" },
+  }; /**< Store action to FLAGS prefix map. */
+
   static const QMap<Command, ResponseHandler>
     RESPONSE_HANDLER; /**< Response handler map. */
 
+  /**
+   * @brief Transport byte counters, accumulated over reconnections.
+   *
+   */
+  struct Traffic
+  {
+    std::size_t wire_in{ 0 };  /**< Bytes read from the socket. */
+    std::size_t data_in{ 0 };  /**< Bytes read after decompression. */
+    std::size_t wire_out{ 0 }; /**< Bytes written to the socket. */
+    std::size_t data_out{ 0 }; /**< Bytes written before compression. */
+
+    /**
+     * @brief Get received compression ratio, 1 if nothing compressed.
+     *
+     */
+    [[nodiscard]] TEMAIL_INLINE double ratio_in() const
+    {
+      return wire_in == 0 ? 1.0
+                          : static_cast<double>(data_in) /
+                              static_cast<double>(wire_in);
+    }
+
+    /**
+     * @brief Get sent compression ratio, 1 if nothing compressed.
+     *
+     */
+    [[nodiscard]] TEMAIL_INLINE double ratio_out() const
+    {
+      return wire_out == 0 ? 1.0
+                           : static_cast<double>(data_out) /
+                               static_cast<double>(wire_out);
+    }
+  };
+
 private:
+  /**
+   * @brief Callbacks of a pending command.
+   *
+   */
+  struct TagSlot
+  {
+    TagGenerator::Tag tag{ 0 };
+    ResultCallback success; /**< Empty if result goes to `read`. */
+    ErrorCallback error;
+    bool used{ false };
+  };
+
+  /**
+   * @brief Server capabilities used by the client.
+   *
+   */
+  enum Capability : uint8_t
+  {
+    CAP_COMPRESS = 0b00001,      /**< COMPRESS=DEFLATE (RFC 4978). */
+    CAP_LITERAL_PLUS = 0b00010,  /**< LITERAL+ (RFC 7888). */
+    CAP_LITERAL_MINUS = 0b00100, /**< LITERAL- (RFC 7888). */
+    CAP_MULTIAPPEND = 0b01000,   /**< MULTIAPPEND (RFC 3502). */
+    CAP_OBJECTID = 0b10000,      /**< OBJECTID (RFC 8474). */
+  };
+
+  /**
+   * @brief APPEND command being streamed.
+   *
+   */
+  struct Upload
+  {
+    /**
+     * @brief Stream position.
+     *
+     */
+    enum Stage : uint8_t
+    {
+      HEADER, /**< Next message header or command end. */
+      WAIT,   /**< Synchronizing literal waits for continuation. */
+      BODY,   /**< Message body. */
+    };
+
+    TagGenerator::Tag tag{ 0 };
+    QByteArray before;  /**< Output queued ahead of this command. */
+    QByteArray command; /**< Command without tag and messages. */
+    QList<request::AppendMessage> messages;
+    qsizetype index{ 0 };   /**< Message being sent. */
+    qint64 left{ 0 };       /**< Body bytes left. */
+    std::size_t syncs{ 0 }; /**< Synchronizing literals sent. */
+    Stage stage{ HEADER };
+  };
+
+  /**
+   * @brief APPEND split into one command per message, whose results are
+   * merged into one.
+   *
+   */
+  struct AppendBatch
+  {
+    std::size_t pending{ 0 }; /**< Commands not answered yet. */
+    bool failed{ false };     /**< An error has been reported. */
+    QList<TagGenerator::Tag> tags;
+    response::Append result; /**< UIDs appended so far. */
+    ResultCallback success;   /**< Result is queued for `read` if empty. */
+    ErrorCallback error;
+  };
+
   QSslSocket _sock;
-  std::queue<QVariant> _queue;
+  std::queue<response::Result> _queue;
   Status _status{ Status::DISCONNECT };
+  std::size_t _uidvalidity{ 0 }; /**< UIDVALIDITY of the selected folder. */
+  std::atomic<bool> _qresync{ false }; /**< QRESYNC has been enabled. */
 
   TagGenerator _tags;
   std::deque<QPair<Command, detail::IMAPResponse>> _resp;
-  QMap<QString, QPair<CommandCallback, ErrorCallback>> _resp_cb;
+  std::vector<TagSlot> _resp_cb = std::vector<TagSlot>(
+    INITIAL_SLOTS); /**< Callback ring indexed by tag number. */
+  std::array<TagSlot, 2> _conn_cb; /**< Connect and disconnect callbacks. */
+
+  QByteArray _out;                    /**< Commands waiting for flush. */
+  QList<TagGenerator::Tag> _out_tags; /**< Tags of commands in `_out`. */
+
+  std::unique_ptr<detail::IMAPSubmitQueue>
+    _submit; /**< Commands submitted by any thread, drained by the socket
+                thread, which owns all the states above. */
+  std::atomic<bool> _drain_pending{ false }; /**< Drain has been scheduled. */
+  std::atomic<int> _batch{ 0 };              /**< Nested batch depth. */
+
+  std::atomic<bool> _idle{ false }; /**< IDLE mode is requested. */
+  bool _idling{ false };            /**< IDLE runs, DONE is not sent. */
+  bool _idle_done{ false };         /**< DONE waits for the continuation. */
+  QTimer _idle_timer;
+
+  std::unique_ptr<detail::IMAPDeflate>
+    _deflate; /**< COMPRESS=DEFLATE layer, pass through until started. */
+  std::atomic<bool> _compress{ true }; /**< COMPRESS is allowed. */
+  bool _compress_pending{ false };     /**< Output waits for COMPRESS. */
+  std::atomic<uint8_t> _caps{ 0 };     /**< Advertised `Capability` bits. */
 
-  QMutex _resp_lock;    /**< Lock to ensure thread safe of `_resp`. */
-  QMutex _request_lock; /**< Lock to ensure sync enqueue (to `_resp`), because
-                           `flush` operation may fail, maybe we need to pop
-                           immediately after push. */
-  QMutex _read_lock;    /**> Lock to ensure thread safe of `read`. */
-  QMutex _cb_lock;      /**> Lock to ensure thread safe of callback map.  */
+  std::deque<Upload> _uploads; /**< APPEND commands, streamed in order. */
+
+  std::shared_ptr<BodyStore> _bodies; /**< Body store, may be null. */
+  mutable QMutex _bodies_lock;        /**< Guards `_bodies`. */
+
+  std::atomic<std::size_t> _wire_in{ 0 };
+  std::atomic<std::size_t> _data_in{ 0 };
+  std::atomic<std::size_t> _wire_out{ 0 };
+  std::atomic<std::size_t> _data_out{ 0 };
+
+  QMutex _read_lock; /**> Lock to ensure thread safe of `read`. */
 
 public:
   /**
@@ -172,59 +353,440 @@ public:
     return _status == Status::CONNECT || _status == Status::AUTHENTICATE;
   }
   bool is_disconnected() override { return _status == Status::DISCONNECT; }
-  void login(
-    const QString& username,
-    const QString& password,
-    const CommandCallback& callback = _default_command_handler) override;
-  void logout(
-    const CommandCallback& callback = _default_command_handler) override;
-  void list(
-    const QString& path,
-    const QString& pattern,
-    const CommandCallback& callback = _default_command_handler) override;
-  void select(
-    const QString& path,
-    const CommandCallback& callback = _default_command_handler) override;
-  void noop(
-    const CommandCallback& callback = _default_command_handler) override;
-  void search(
-    request::Search::Criteria criteria,
-    const CommandCallback& callback = _default_command_handler) override;
-  void fetch(
+  void login(const QString& username,
+             const QString& password,
+             const ResultCallback& callback = {}) override;
+  using Base::login;
+  void logout(const ResultCallback& callback = {}) override;
+  using Base::logout;
+  void list(const QString& path,
+            const QString& pattern,
+            const ResultCallback& callback = {}) override;
+  using Base::list;
+  void select(const QString& path,
+              const ResultCallback& callback = {}) override;
+  using Base::select;
+  void noop(const ResultCallback& callback = {}) override;
+  using Base::noop;
+  void search(const request::SearchQuery& query,
+              const ResultCallback& callback = {}) override;
+  void search(const request::SearchQuery& query,
+              request::SearchReturn::Options options,
+              request::SearchPartial partial = {},
+              const ResultCallback& callback = {}) override;
+  using Base::search;
+  void fetch(std::size_t id,
+             request::Fetch::FieldFlags field,
+             std::size_t range = 1,
+             const ResultCallback& callback = {}) override;
+  void fetch(const SequenceSet& ids,
+             request::Fetch::FieldFlags field,
+             const ResultCallback& callback = {}) override;
+  using Base::fetch;
+  void fetch_stream(std::size_t id,
+                    request::Fetch::FieldFlags field,
+                    const FetchSink& sink,
+                    std::size_t range = 1,
+                    const ResultCallback& callback = {}) override;
+  using Base::fetch_stream;
+  void uid_fetch(std::size_t uid,
+                 request::Fetch::FieldFlags field,
+                 std::size_t range = 1,
+                 const ResultCallback& callback = {}) override;
+  void uid_fetch(const SequenceSet& uids,
+                 request::Fetch::FieldFlags field,
+                 const ResultCallback& callback = {}) override;
+  using Base::uid_fetch;
+  void uid_fetch_envelopes(const SequenceSet& uids,
+                           const ResultCallback& callback = {}) override;
+  using Base::uid_fetch_envelopes;
+  void uid_search(const request::SearchQuery& query,
+                  const ResultCallback& callback = {}) override;
+  void uid_search(const request::SearchQuery& query,
+                  request::SearchReturn::Options options,
+                  request::SearchPartial partial = {},
+                  const ResultCallback& callback = {}) override;
+  using Base::uid_search;
+  void uid_store(std::size_t uid,
+                 std::size_t range,
+                 request::Store::Action action,
+                 const FlagSet& flags,
+                 const ResultCallback& callback = {}) override;
+  void uid_store(const SequenceSet& uids,
+                 request::Store::Action action,
+                 const FlagSet& flags,
+                 const ResultCallback& callback = {}) override;
+  using Base::uid_store;
+  void select_qresync(const QString& path,
+                      std::size_t uidvalidity,
+                      std::size_t modseq,
+                      std::size_t last_uid = 0,
+                      const ResultCallback& callback = {}) override;
+  using Base::select_qresync;
+  void uid_fetch_changed(std::size_t uid,
+                         request::Fetch::FieldFlags field,
+                         std::size_t range,
+                         std::size_t modseq,
+                         const ResultCallback& callback = {}) override;
+  using Base::uid_fetch_changed;
+  void append(const QString& path,
+              const QList<request::AppendMessage>& messages,
+              const ResultCallback& callback = {}) override;
+  using Base::append;
+  response::Result read_result() override;
+
+  /**
+   * @brief Begin a batch, commands are kept in the output buffer until the
+   * matching `end_batch`, then written with a single flush (thread safe).
+   * IDLE, DONE, COMPRESS and APPEND data are held as well.
+   *
+   * @note Without a batch, commands issued in the same event loop turn are
+   * still coalesced and flushed once when the loop regains control.
+   */
+  void begin_batch();
+
+  /**
+   * @brief End a batch, flushes the output buffer when the outermost batch
+   * ends.
+   *
+   */
+  void end_batch();
+
+  /**
+   * @brief Enter or leave IDLE push mode (RFC 2177, thread safe).
+   *
+   * @note While enabled, the connection idles whenever no command is
+   * pending. Queued commands end IDLE transparently, and IDLE is entered
+   * again once they complete. Updates are reported by `idle_exists`,
+   * `idle_expunge` and `idle_fetch`.
+   *
+   * @param enable Enable IDLE mode.
+   */
+  void idle(bool enable = true);
+
+  /**
+   * @brief Check if IDLE mode is enabled (thread safe).
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE bool is_idle() const
+  {
+    return _idle.load(std::memory_order_acquire);
+  }
+
+  /**
+   * @brief Allow or forbid COMPRESS=DEFLATE (RFC 4978, thread safe).
+   *
+   * @note Compression is negotiated right after LOGIN when the server
+   * advertises it, changes take effect on the next LOGIN. Enabled by default.
+   *
+   * @param enable Allow compression.
+   */
+  TEMAIL_INLINE void set_compress(bool enable)
+  {
+    _compress.store(enable, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Check if transport compression is active.
+   *
+   */
+  [[nodiscard]] bool is_compressed() const;
+
+  /**
+   * @brief Get transport byte counters (thread safe).
+   *
+   * @return Traffic Counters, `ratio_in` shows the compression achieved.
+   */
+  [[nodiscard]] Traffic traffic() const;
+
+  /**
+   * @brief Attach a body store, set it before issuing commands.
+   *
+   * @note Fetched bodies are written into the store. When the server has
+   * OBJECTID (RFC 8474), FETCH and UID FETCH of `TEXT` with a callback first
+   * fetch EMAILIDs, then download only the bodies missing from the store.
+   * Bodies are written in the global thread pool, off the socket thread, so
+   * they may be found shortly after the fetch completes.
+   *
+   * @param store Body store, may be shared by several clients, null to
+   * detach.
+   */
+  TEMAIL_INLINE void set_body_store(std::shared_ptr<BodyStore> store)
+  {
+    QMutexLocker guard{ &_bodies_lock };
+    _bodies = std::move(store);
+  }
+
+  /**
+   * @brief Get attached body store, may be null.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE std::shared_ptr<BodyStore> body_store() const
+  {
+    QMutexLocker guard{ &_bodies_lock };
+    return _bodies;
+  }
+
+#if defined(TEMAIL_COROUTINE)
+  /**
+   * @brief Awaitable LOGIN, resumes when its own tagged completion arrives.
+   *
+   * @param username Username.
+   * @param password Password.
+   * @return CommandAwaiter<response::Login> Awaiter.
+   */
+  CommandAwaiter<response::Login> async_login(const QString& username,
+                                              const QString& password);
+
+  /**
+   * @brief Awaitable LIST.
+   *
+   * @param path Parent path.
+   * @param pattern Filter pattern.
+   * @return CommandAwaiter<response::List> Awaiter.
+   */
+  CommandAwaiter<response::List> async_list(const QString& path,
+                                            const QString& pattern);
+
+  /**
+   * @brief Awaitable SELECT.
+   *
+   * @param path Folder path.
+   * @return CommandAwaiter<response::Select> Awaiter.
+   */
+  CommandAwaiter<response::Select> async_select(const QString& path);
+
+  /**
+   * @brief Awaitable SEARCH.
+   *
+   * @param query Search query, `Search::Criteria` converts to it.
+   * @return CommandAwaiter<response::Search> Awaiter.
+   */
+  CommandAwaiter<response::Search> async_search(
+    const request::SearchQuery& query);
+
+  /**
+   * @brief Awaitable FETCH.
+   *
+   * @param id Mail start id.
+   * @param field Mail field.
+   * @param range Id range.
+   * @return CommandAwaiter<response::Fetch> Awaiter.
+   */
+  CommandAwaiter<response::Fetch> async_fetch(
     std::size_t id,
     request::Fetch::FieldFlags field,
-    std::size_t range = 1,
-    const CommandCallback& callback = _default_command_handler) override;
-  QVariant read() override;
+    std::size_t range = 1);
+#endif
 
 private:
+  template<typename T>
+  friend class CommandAwaiter;
+
   /**
-   * @brief Helper to send a command.
+   * @brief Helper to send a command, may be called from any thread.
+   *
+   * @note Success callback is invoked in the submitting thread, which needs a
+   * running event loop if it is not the socket thread.
    *
    * @param type Command type,
    * @param cmd Command content.
-   * @param callback Success callback.
+   * @param callback Success callback, result is queued for `read` if empty.
+   * @param sink FETCH literal sink, literals are buffered if empty.
+   * @param error Error callback, invoked in the same thread as `callback`.
+   * @param messages APPEND mails, streamed after `cmd`.
+   * @param envelopes Collect UID FETCH data into `response::Envelopes`.
    */
   void _request(Command type,
                 QAnyStringView cmd,
-                const CommandCallback& callback);
+                const ResultCallback& callback,
+                const FetchSink& sink = {},
+                const ErrorCallback& error = _default_error_handler,
+                const QList<request::AppendMessage>& messages = {},
+                bool envelopes = false);
+
+  /**
+   * @brief Move submitted commands into the output buffer and flush it.
+   *
+   */
+  void _drain_submissions();
+
+  /**
+   * @brief Write buffered commands to the socket with a single flush, every
+   * write goes through it.
+   *
+   * @note Nothing is written while a batch is open.
+   */
+  void _flush_output();
+
+  /**
+   * @brief Build LOGIN command.
+   *
+   * @param username Username.
+   * @param password Password.
+   * @return QString LOGIN command.
+   */
+  static QString _login_command(const QString& username,
+                                const QString& password);
+
+  /**
+   * @brief Build LIST command.
+   *
+   * @param path Parent path.
+   * @param pattern Filter pattern.
+   * @return QString LIST command.
+   */
+  static QString _list_command(const QString& path, const QString& pattern);
+
+  /**
+   * @brief Build SELECT command.
+   *
+   * @param path Folder path.
+   * @return QString SELECT command.
+   */
+  static QString _select_command(const QString& path);
+
+  /**
+   * @brief Build SEARCH command.
+   *
+   * @param query Search query.
+   * @return QString SEARCH command.
+   */
+  static QString _search_command(const request::SearchQuery& query);
+
+  /**
+   * @brief Build extended SEARCH command, such as
+   * `SEARCH RETURN (COUNT PARTIAL 1:100) ALL`.
+   *
+   * @param query Search query.
+   * @param options Result options.
+   * @param partial Result window, replaces `ALL`.
+   * @return QString SEARCH command.
+   */
+  static QString _esearch_command(const request::SearchQuery& query,
+                                  request::SearchReturn::Options options,
+                                  request::SearchPartial partial);
+
+  /**
+   * @brief Send `ENABLE QRESYNC` once per connection, ahead of the first
+   * command which needs it.
+   *
+   */
+  void _enable_qresync();
+
+  /**
+   * @brief Build sequence range such as `1`, `1:10` or `1:*`.
+   *
+   * @param id Start id.
+   * @param range Id range, 0 for all from `id`.
+   * @return SequenceSet Sequence range.
+   */
+  static SequenceSet _range_set(std::size_t id, std::size_t range);
+
+  /**
+   * @brief Build sequence number range such as `1` or `1:10`.
+   *
+   * @param id Start id.
+   * @param range Id range, 0 or 1 for `id` only.
+   * @return SequenceSet Sequence range.
+   */
+  static SequenceSet _id_set(std::size_t id, std::size_t range);
+
+  /**
+   * @brief Build flag list without parens for STORE and APPEND.
+   *
+   * @param flags Flags, `\Recent`, `\*` and mailbox attributes are dropped,
+   * keywords are sent as interned.
+   * @return QString Space separated flags.
+   */
+  static QString _flags_command(const FlagSet& flags);
+
+  /**
+   * @brief Build quoted date-time such as `"17-Jul-1996 02:44:25 -0700"`.
+   *
+   * @param date Date time.
+   * @return QString Quoted IMAP date-time.
+   */
+  static QString _date_command(const QDateTime& date);
 
   /**
-   * @brief Set error for specific command.
+   * @brief Build UID STORE command.
+   *
+   * @param uids Mail UIDs.
+   * @param action Store action.
+   * @param flags Flags.
+   * @return QString UID STORE command.
+   */
+  static QString _store_command(const SequenceSet& uids,
+                                request::Store::Action action,
+                                const FlagSet& flags);
+
+  /**
+   * @brief Build FETCH command.
+   *
+   * @param ids Mail ids.
+   * @param field Mail field.
+   * @return QString FETCH command.
+   */
+  static QString _fetch_command(const SequenceSet& ids,
+                                request::Fetch::FieldFlags field);
+
+  /**
+   * @brief Send FETCH or UID FETCH.
+   *
+   * @param type `Command::FETCH` or `Command::UID_FETCH`.
+   * @param ids Mail ids or UIDs.
+   * @param field Mail field, EMAILID is added when bodies are stored.
+   * @param callback Success callback.
+   */
+  void _fetch_request(Command type,
+                      const SequenceSet& ids,
+                      request::Fetch::FieldFlags field,
+                      const ResultCallback& callback);
+
+  /**
+   * @brief Fetch mails, bodies found in the body store by EMAILID are not
+   * downloaded.
+   *
+   * @param type `Command::FETCH` or `Command::UID_FETCH`.
+   * @param ids Mail ids or UIDs.
+   * @param field Mail field, including `TEXT`.
+   * @param callback Success callback, must not be empty.
+   */
+  void _fetch_bodies(Command type,
+                     const SequenceSet& ids,
+                     request::Fetch::FieldFlags field,
+                     const ResultCallback& callback);
+
+  /**
+   * @brief Write fetched bodies into the body store, in the global thread
+   * pool.
+   *
+   * @param items Fetched mails.
+   */
+  void _store_bodies(const response::Fetch& items) const;
+
+  /**
+   * @brief Set error for specific command, commands without handler (such
+   * as the rest of a failed APPEND batch) are not reported.
    *
    * @param tag Command tag.
    * @param error Error type.
    * @param estr Error string.
    */
-  void _tag_error(const QString& tag, ErrorType error, const QString& estr);
+  void _tag_error(TagGenerator::Tag tag,
+                  ErrorType error,
+                  const QString& estr);
 
   /**
    * @brief Handles success callback.
    *
    * @param tag Command tag.
    * @param data Response data.
+   * @return true Result is queued for `read`.
+   * @return false Result is consumed by a callback, or tag is unknown.
    */
-  void _handle_success(const QString& tag, const QVariant& data);
+  bool _handle_success(TagGenerator::Tag tag, response::Result&& data);
 
   /**
    * @brief Handles error callback.
@@ -232,8 +794,11 @@ private:
    * @param tag Command tag.
    * @param error Error type.
    * @param estr Error string.
+   * @return true Tag had a handler.
    */
-  void _handle_error(const QString& tag, ErrorType error, const QString& estr);
+  bool _handle_error(TagGenerator::Tag tag,
+                     ErrorType error,
+                     const QString& estr);
 
   /**
    * @brief Add command handlers.
@@ -242,10 +807,155 @@ private:
    * @param success Success handler.
    * @param error Error handler.
    */
-  void _add_handler(const QString& tag,
-                    const CommandCallback& success,
+  void _add_handler(TagGenerator::Tag tag,
+                    const ResultCallback& success,
                     const ErrorCallback& error);
 
+  /**
+   * @brief Get callback slot of a tag.
+   *
+   * @param tag Command tag.
+   * @return TagSlot& Slot the tag maps to (may be used by another tag).
+   */
+  TagSlot& _slot_of(TagGenerator::Tag tag);
+
+  /**
+   * @brief Double callback slots.
+   *
+   */
+  void _grow_slots();
+
+  /**
+   * @brief Dispatch completed response to its handler.
+   *
+   * @param resp Command type and completed response.
+   */
+  void _handle_response(QPair<Command, detail::IMAPResponse>& resp);
+
+  /**
+   * @brief Send IDLE if IDLE mode is enabled and the connection is quiet.
+   *
+   */
+  void _enter_idle();
+
+  /**
+   * @brief End running IDLE, DONE is written before any later command.
+   *
+   */
+  void _leave_idle();
+
+  /**
+   * @brief Report untagged updates of running IDLE.
+   *
+   * @param resp IDLE response.
+   */
+  void _handle_idle(detail::IMAPResponse& resp);
+
+  /**
+   * @brief Send COMPRESS DEFLATE if allowed and offered, later output is
+   * held until the server answers.
+   *
+   */
+  void _start_compress();
+
+  /**
+   * @brief Send CAPABILITY, then start compression once the server answers.
+   *
+   */
+  void _request_capabilities();
+
+  /**
+   * @brief Inflate socket input if compression is active, the connection is
+   * aborted on corrupted input.
+   *
+   * @param data Input bytes, replaced by inflated bytes.
+   * @return true Input is usable.
+   * @return false Connection aborted.
+   */
+  bool _inflate(QByteArray& data);
+
+  /**
+   * @brief Collect capabilities used by the client.
+   *
+   * @param text Untagged CAPABILITY data, or response text such as
+   * `[CAPABILITY ...] Logged in`.
+   * @param code Text is response text, which needs the `[CAPABILITY ...]`
+   * code.
+   * @return uint8_t Capability bits.
+   */
+  static uint8_t _parse_capabilities(const QString& text, bool code);
+
+  /**
+   * @brief Queue APPEND uploads, one per message without MULTIAPPEND.
+   *
+   * @param tag Command tag, handlers already added.
+   * @param cmd Command without messages.
+   * @param messages Mails to upload.
+   * @param success Success handler, called once with the merged result.
+   * @param error Error handler, called once on the first failure.
+   */
+  void _queue_append(TagGenerator::Tag tag,
+                     const QByteArray& cmd,
+                     QList<request::AppendMessage> messages,
+                     const ResultCallback& success,
+                     const ErrorCallback& error);
+
+  /**
+   * @brief Stream queued uploads while the socket keeps up, then flush
+   * commands queued behind them.
+   *
+   */
+  void _pump_uploads();
+
+  /**
+   * @brief Stream an upload until socket buffer is full or a continuation
+   * is needed.
+   *
+   * @param upload Upload at the head of the queue.
+   * @return true Upload completed.
+   * @return false Upload paused or connection aborted.
+   */
+  bool _stream_upload(Upload& upload);
+
+  /**
+   * @brief Compress and count output bytes.
+   *
+   * @param data Plain bytes.
+   * @return QByteArray Bytes for the socket.
+   */
+  QByteArray _encode_output(const QByteArray& data);
+
+  /**
+   * @brief Write bytes immediately, the connection is aborted on failure.
+   *
+   * @param data Plain bytes.
+   * @return true Bytes written.
+   * @return false Connection aborted.
+   */
+  bool _write(const QByteArray& data);
+
+signals:
+  /**
+   * @brief Emitted when mailbox size changes in IDLE.
+   *
+   * @param count Message count.
+   */
+  void idle_exists(std::size_t count);
+
+  /**
+   * @brief Emitted when a message is expunged in IDLE.
+   *
+   * @param id Sequence number of the expunged message.
+   */
+  void idle_expunge(std::size_t id);
+
+  /**
+   * @brief Emitted when message data (usually flags) changes in IDLE.
+   *
+   * @param item Changed message.
+   */
+  void idle_fetch(const temail::client::response::FetchItem& item);
+
 private slots: // NOLINT
   /**
    * @brief Handles the tcp socket `connected` signal.
@@ -270,6 +980,16 @@ private slots: // NOLINT
    *
    */
   void _on_ready_read();
+
+  /**
+   * @brief Handles the tcp socket `bytesWritten` signal.
+   *
+   */
+  void _on_bytes_written(qint64 bytes);
 };
 
 }
+
+#if defined(TEMAIL_COROUTINE)
+#include "temail/client/coroutine.hpp"
+#endif
@@ -0,0 +1,234 @@
+/**
+ * @file pool.hpp
+ * @author Dessera (dessera@qq.com)
+ * @brief Temail IMAP4 connection pool.
+ * @version 0.1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2025 Dessera
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <qmap.h>
+#include <qobject.h>
+#include <qstring.h>
+#include <qstringlist.h>
+#include <vector>
+
+#include "temail/client/base.hpp"
+#include "temail/client/imap.hpp"
+#include "temail/client/request.hpp"
+#include "temail/client/response.hpp"
+#include "temail/common.hpp"
+
+namespace temail::client {
+
+/**
+ * @brief Pool of authenticated IMAP4 connections to one account, commands
+ * are routed by target mailbox so several mailboxes are served in parallel.
+ *
+ * @note Not thread safe, use it from the thread it lives in.
+ */
+class TEMAIL_PUBLIC IMAPPool : public QObject
+{
+  Q_OBJECT
+
+public:
+  using ErrorType = Base::ErrorType;
+  using ErrorCallback = Base::ErrorCallback;
+  template<typename T>
+  using Callback = Base::Callback<T>;
+
+  /**
+   * @brief Ends a job and returns its connection to the pool.
+   *
+   */
+  using Release = std::function<void()>;
+
+  /**
+   * @brief Job run on a connection which has selected the target mailbox,
+   * `release` must be called once all its commands completed.
+   *
+   */
+  using Job = std::function<void(IMAP& client, const Release& release)>;
+
+  /**
+   * @brief UID FETCH results keyed by mailbox.
+   *
+   */
+  using MailboxFetch = QMap<QString, response::UidFetch>;
+
+  constexpr static std::size_t DEFAULT_MAX_CONNECTIONS =
+    4; /**< Default connection cap, most providers allow 5 to 20. */
+
+  /**
+   * @brief Account shared by all connections.
+   *
+   */
+  struct Account
+  {
+    QString url;
+    uint16_t port{ 0 }; /**< 0 for the default port of `ssl`. */
+    Base::SslOption ssl{ Base::USE_SSL };
+    QString username;
+    QString password;
+  };
+
+private:
+  /**
+   * @brief Pooled connection.
+   *
+   */
+  struct Connection
+  {
+    IMAP* client{ nullptr };
+    QString mailbox;             /**< Selected mailbox, empty if unknown. */
+    bool ready{ false };         /**< Connection is authenticated. */
+    bool busy{ false };          /**< Job running or connection opening. */
+    std::size_t generation{ 0 }; /**< Bumped when a job ends. */
+    ErrorCallback error;         /**< Error callback of the running job. */
+  };
+
+  /**
+   * @brief Job waiting for a connection.
+   *
+   */
+  struct Pending
+  {
+    QString mailbox;
+    Job job;
+    ErrorCallback error;
+  };
+
+  Account _account;
+  std::size_t _max_connections;
+
+  std::vector<Connection> _conns;
+  std::deque<Pending> _pending;
+
+public:
+  /**
+   * @brief Construct a new IMAPPool object, connections are opened on
+   * demand.
+   *
+   * @param account Account to login.
+   * @param max_connections Connection cap, keep it within provider limits.
+   * @param parent Parent object.
+   */
+  explicit IMAPPool(Account account,
+                    std::size_t max_connections = DEFAULT_MAX_CONNECTIONS,
+                    QObject* parent = nullptr);
+
+  ~IMAPPool() override;
+
+  /**
+   * @brief Queue a job for a mailbox.
+   *
+   * @note Idle connections which already selected `mailbox` are preferred,
+   * a new connection is opened while the cap is not reached. Any client
+   * error during the job ends it and is passed to `error`.
+   *
+   * @param mailbox Mailbox to select, empty to run without SELECT.
+   * @param job Job to run.
+   * @param error Error callback.
+   */
+  void submit(const QString& mailbox,
+              const Job& job,
+              const ErrorCallback& error = {});
+
+  /**
+   * @brief Fetch all mails of several mailboxes in parallel.
+   *
+   * @param mailboxes Mailboxes to fetch.
+   * @param field Mail field.
+   * @param callback Called once with all mailboxes fetched successfully.
+   * @param error Called for each failed mailbox, `estr` names the mailbox.
+   */
+  void fetch(const QStringList& mailboxes,
+             request::Fetch::FieldFlags field,
+             const Callback<MailboxFetch>& callback,
+             const ErrorCallback& error = {});
+
+  /**
+   * @brief Get opened connection count.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE std::size_t size() const
+  {
+    return _conns.size();
+  }
+
+  /**
+   * @brief Get connection cap.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE std::size_t max_connections() const
+  {
+    return _max_connections;
+  }
+
+  /**
+   * @brief Get jobs waiting for a connection.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE std::size_t pending() const
+  {
+    return _pending.size();
+  }
+
+private:
+  /**
+   * @brief Hand pending jobs to idle connections, open connections for the
+   * rest while the cap allows.
+   *
+   */
+  void _dispatch();
+
+  /**
+   * @brief Connect and login a pooled connection.
+   *
+   * @param index Connection index.
+   */
+  void _open(std::size_t index);
+
+  /**
+   * @brief Run a job on an idle connection.
+   *
+   * @param index Connection index.
+   * @param pending Job to run.
+   */
+  void _run(std::size_t index, Pending&& pending);
+
+  /**
+   * @brief Return a connection to the pool, stale releases are ignored.
+   *
+   * @param index Connection index.
+   * @param generation Generation of the job.
+   */
+  void _release(std::size_t index, std::size_t generation);
+
+  /**
+   * @brief Handles client errors of a pooled connection.
+   *
+   * @param index Connection index.
+   * @param error Error type.
+   * @param estr Error string.
+   */
+  void _on_error(std::size_t index, ErrorType error, const QString& estr);
+
+  /**
+   * @brief Fail all pending jobs.
+   *
+   * @param error Error type.
+   * @param estr Error string.
+   */
+  void _fail_pending(ErrorType error, const QString& estr);
+};
+
+}
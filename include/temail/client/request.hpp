@@ -12,10 +12,20 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <qdatetime.h>
+#include <qfile.h>
 #include <qflags.h>
+#include <qiodevice.h>
 #include <qobject.h>
+#include <qstring.h>
 #include <qtmetamacros.h>
+#include <qtypes.h>
+#include <utility>
 
+#include "temail/client/flags.hpp"
+#include "temail/client/sequence.hpp"
 #include "temail/common.hpp"
 
 namespace temail::client::request {
@@ -54,6 +64,328 @@ public:
   Q_ENUM(Criteria)
 };
 
+/**
+ * @brief Search query, an expression tree of search keys which is written
+ * into the command, or evaluated locally against cached mails.
+ *
+ * @code
+ * auto query = SearchQuery::since(QDate{ 2025, 1, 1 }) &&
+ *              (SearchQuery::from("alice") || SearchQuery::from("bob")) &&
+ *              !SearchQuery{ Search::SEEN };
+ * @endcode
+ */
+class TEMAIL_PUBLIC SearchQuery
+{
+public:
+  /**
+   * @brief Search key of a leaf, kept for local evaluation.
+   *
+   */
+  struct Key
+  {
+    /**
+     * @brief Search key types.
+     *
+     */
+    enum Type : uint8_t
+    {
+      CRITERIA,    /**< Flag criteria. */
+      SINCE,       /**< Internal date on or after `date`. */
+      BEFORE,      /**< Internal date before `date`. */
+      ON,          /**< Internal date within `date`. */
+      SENT_SINCE,  /**< Date field on or after `date`. */
+      SENT_BEFORE, /**< Date field before `date`. */
+      SENT_ON,     /**< Date field within `date`. */
+      LARGER,      /**< Larger than `size`. */
+      SMALLER,     /**< Smaller than `size`. */
+      HEADER,      /**< Header `field` contains `value`. */
+      FROM,        /**< From field contains `value`. */
+      TO,          /**< To field contains `value`. */
+      SUBJECT,     /**< Subject field contains `value`. */
+      BODY,        /**< Body contains `value`. */
+      TEXT,        /**< Header or body contains `value`. */
+      UID,         /**< UID in `ids`. */
+      IDS,         /**< Sequence number in `ids`. */
+    };
+
+    Type type{ CRITERIA };
+    Search::Criteria criteria{ Search::ALL };
+    QDate date;
+    qint64 size{ 0 };
+    QString field;
+    QString value;
+    SequenceSet ids;
+  };
+
+  using KeyPredicate = std::function<bool(const Key&)>;
+
+private:
+  struct Node;
+
+  std::shared_ptr<const Node> _node; /**< Immutable, shared by copies. */
+
+public:
+  /**
+   * @brief Construct a query of a flag criteria, `ALL` by default.
+   *
+   * @param criteria Search criteria.
+   */
+  SearchQuery(Search::Criteria criteria = Search::ALL); // NOLINT
+
+  /**
+   * @brief Mails with internal date on or after `date` (SINCE).
+   *
+   */
+  static SearchQuery since(const QDate& date);
+
+  /**
+   * @brief Mails with internal date before `date` (BEFORE).
+   *
+   */
+  static SearchQuery before(const QDate& date);
+
+  /**
+   * @brief Mails with internal date within `date` (ON).
+   *
+   */
+  static SearchQuery on(const QDate& date);
+
+  /**
+   * @brief Mails with Date field on or after `date` (SENTSINCE).
+   *
+   */
+  static SearchQuery sent_since(const QDate& date);
+
+  /**
+   * @brief Mails with Date field before `date` (SENTBEFORE).
+   *
+   */
+  static SearchQuery sent_before(const QDate& date);
+
+  /**
+   * @brief Mails with Date field within `date` (SENTON).
+   *
+   */
+  static SearchQuery sent_on(const QDate& date);
+
+  /**
+   * @brief Mails larger than `size` bytes (LARGER).
+   *
+   */
+  static SearchQuery larger(qint64 size);
+
+  /**
+   * @brief Mails smaller than `size` bytes (SMALLER).
+   *
+   */
+  static SearchQuery smaller(qint64 size);
+
+  /**
+   * @brief Mails with header `field` containing `value`, any mail with the
+   * field if `value` is empty (HEADER).
+   *
+   */
+  static SearchQuery header(const QString& field, const QString& value);
+
+  /**
+   * @brief Mails with From field containing `value` (FROM).
+   *
+   */
+  static SearchQuery from(const QString& value);
+
+  /**
+   * @brief Mails with To field containing `value` (TO).
+   *
+   */
+  static SearchQuery to(const QString& value);
+
+  /**
+   * @brief Mails with Subject field containing `value` (SUBJECT).
+   *
+   */
+  static SearchQuery subject(const QString& value);
+
+  /**
+   * @brief Mails with body containing `value` (BODY).
+   *
+   */
+  static SearchQuery body(const QString& value);
+
+  /**
+   * @brief Mails with header or body containing `value` (TEXT).
+   *
+   */
+  static SearchQuery text(const QString& value);
+
+  /**
+   * @brief Mails with UIDs in `uids` (UID), `uids` must not be empty.
+   *
+   */
+  static SearchQuery uid(const SequenceSet& uids);
+
+  /**
+   * @brief Mails with ids in `ids`, `ids` must not be empty.
+   *
+   */
+  static SearchQuery ids(const SequenceSet& ids);
+
+  /**
+   * @brief Mails matching both queries.
+   *
+   */
+  SearchQuery operator&&(const SearchQuery& other) const;
+
+  /**
+   * @brief Mails matching any of the queries (OR).
+   *
+   */
+  SearchQuery operator||(const SearchQuery& other) const;
+
+  /**
+   * @brief Mails not matching the query (NOT).
+   *
+   */
+  SearchQuery operator!() const;
+
+  /**
+   * @brief Check if any string needs `CHARSET UTF-8`.
+   *
+   */
+  [[nodiscard]] bool utf8() const;
+
+  /**
+   * @brief Check if any string is written as a non-synchronizing literal
+   * (`{n+}`), which non-ASCII strings and strings with CR or LF need.
+   *
+   */
+  [[nodiscard]] bool literal() const;
+
+  /**
+   * @brief Append search keys to a command.
+   *
+   * @param out Command buffer.
+   */
+  void write(QString& out) const;
+
+  /**
+   * @brief Get search keys, such as `SINCE 1-Jan-2025 NOT SEEN`.
+   *
+   */
+  [[nodiscard]] QString to_string() const;
+
+  /**
+   * @brief Evaluate the query for one mail, operands are short-circuited.
+   *
+   * @param match Check if the mail matches a key.
+   * @return true If the mail matches the query.
+   */
+  [[nodiscard]] bool evaluate(const KeyPredicate& match) const;
+
+  /**
+   * @brief Check if all keys satisfy a predicate, such as being answerable
+   * without the server.
+   *
+   * @param pred Key predicate.
+   */
+  [[nodiscard]] bool all_of(const KeyPredicate& pred) const;
+
+private:
+  explicit SearchQuery(std::shared_ptr<const Node> node);
+
+  /**
+   * @brief Create a query of one search key, serialized once.
+   *
+   * @param key Search key.
+   */
+  static SearchQuery _leaf(Key key);
+
+  /**
+   * @brief Create a query combining operands.
+   *
+   * @param kind Node kind.
+   * @param lhs First operand.
+   * @param rhs Second operand, null for NOT.
+   */
+  static SearchQuery _branch(uint8_t kind,
+                             std::shared_ptr<const Node> lhs,
+                             std::shared_ptr<const Node> rhs);
+
+  /**
+   * @brief Check if query is the `ALL` key.
+   *
+   */
+  [[nodiscard]] bool _all() const;
+
+  /**
+   * @brief Append a node to a command.
+   *
+   * @param out Command buffer.
+   * @param node Node to write.
+   * @param nested Node is an operand of OR or NOT.
+   */
+  static void _write(QString& out, const Node& node, bool nested);
+
+  /**
+   * @brief Evaluate a node for one mail.
+   *
+   * @param node Node to evaluate.
+   * @param match Check if the mail matches a key.
+   */
+  static bool _evaluate(const Node& node, const KeyPredicate& match);
+
+  /**
+   * @brief Check if all keys of a node satisfy a predicate.
+   *
+   * @param node Node to check.
+   * @param pred Key predicate.
+   */
+  static bool _all_of(const Node& node, const KeyPredicate& pred);
+};
+
+/**
+ * @brief Extended SEARCH result options (RFC 4731).
+ *
+ */
+class TEMAIL_PUBLIC SearchReturn : public QObject
+{
+  Q_OBJECT
+
+public:
+  /**
+   * @brief Result options, the server sends only what is requested.
+   *
+   */
+  enum Option : uint8_t
+  {
+    MIN = 0b0001,   /**< Lowest matching id. */
+    MAX = 0b0010,   /**< Highest matching id. */
+    COUNT = 0b0100, /**< Number of matches. */
+    ALL = 0b1000,   /**< All matching ids as a sequence set. */
+  };
+
+  Q_ENUM(Option)
+
+  Q_DECLARE_FLAGS(Options, Option)
+  Q_FLAG(Options)
+};
+
+/**
+ * @brief Result window of an extended SEARCH (RFC 9394 PARTIAL), positions
+ * are 1-based and negative positions count back from the last match.
+ *
+ */
+struct SearchPartial
+{
+  int32_t first{ 0 }; /**< First position, 0 for no window. */
+  int32_t last{ 0 };  /**< Last position, same sign as `first`. */
+
+  /**
+   * @brief Check if no window is requested.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE bool empty() const { return first == 0; }
+};
+
 /**
  * @brief Fetch fields (not a part of RFC1730).
  *
@@ -70,9 +402,12 @@ public:
   enum Field : uint8_t
   {
     ENVELOPE =
-      0b001,      /**< Non-standard ENVELOPE macro (date, subject, from, to). */
-    MIME = 0b010, /**< MIME info. */
-    TEXT = 0b100, /**< Mail text (first part). */
+      0b000001, /**< Non-standard ENVELOPE macro (date, subject, from, to). */
+    MIME = 0b000010,    /**< MIME info. */
+    TEXT = 0b000100,    /**< Mail text (first part). */
+    SIZE = 0b001000,    /**< Mail size (RFC822.SIZE). */
+    FLAGS = 0b010000,   /**< Mail flags. */
+    EMAILID = 0b100000, /**< Mail content id (RFC 8474). */
   };
 
   Q_ENUM(Field)
@@ -81,6 +416,59 @@ public:
   Q_FLAG(FieldFlags)
 };
 
+/**
+ * @brief Store actions.
+ *
+ */
+class TEMAIL_PUBLIC Store : public QObject
+{
+  Q_OBJECT
+
+public:
+  /**
+   * @brief Store actions.
+   *
+   */
+  enum Action : uint8_t
+  {
+    SET,    /**< Replace flags (FLAGS). */
+    ADD,    /**< Add flags (+FLAGS). */
+    REMOVE, /**< Remove flags (-FLAGS). */
+  };
+
+  Q_ENUM(Action)
+};
+
+/**
+ * @brief Message uploaded by APPEND, the body is streamed from `device`.
+ *
+ */
+struct AppendMessage
+{
+  std::shared_ptr<QIODevice> device; /**< Opened for reading, random access
+                                        unless `size` is set. */
+  qint64 size{ -1 }; /**< Bytes to send, -1 for the rest of `device`. */
+  FlagSet flags;     /**< Flags, `\Recent` is never sent. */
+  QDateTime date;    /**< Internal date, server time if invalid. */
+
+  /**
+   * @brief Create a message streamed from a file.
+   *
+   * @param path File path, RFC 5322 message with CRLF line endings.
+   * @param flags Message flags.
+   * @return AppendMessage Message, `device` is null if file is unreadable.
+   */
+  static AppendMessage from_file(const QString& path, FlagSet flags = {})
+  {
+    auto file = std::make_shared<QFile>(path);
+    if (!file->open(QIODevice::ReadOnly)) {
+      return { nullptr, -1, std::move(flags), {} };
+    }
+    return { std::move(file), -1, std::move(flags), {} };
+  }
+};
+
 }
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(temail::client::request::SearchReturn::Options)
 Q_DECLARE_OPERATORS_FOR_FLAGS(temail::client::request::Fetch::FieldFlags)
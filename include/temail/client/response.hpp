@@ -13,17 +13,27 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <ostream>
+#include <qbytearray.h>
+#include <qbytearrayview.h>
 #include <qdatetime.h>
 #include <qdebug.h>
+#include <qhash.h>
 #include <qlist.h>
 #include <qmap.h>
 #include <qstring.h>
 #include <qstringlist.h>
+#include <qstringview.h>
 #include <qvariant.h>
+#include <type_traits>
 #include <utility>
+#include <variant>
+#include <vector>
 
+#include "temail/client/flags.hpp"
 #include "temail/client/request.hpp"
+#include "temail/client/sequence.hpp"
 #include "temail/common.hpp"
 
 namespace temail::client::response {
@@ -43,7 +53,7 @@ struct ListItem
 {
   QString parent;
   QString name;
-  QStringList attrs;
+  FlagSet attrs;
 };
 
 /**
@@ -52,6 +62,326 @@ struct ListItem
  */
 using List = QList<ListItem>;
 
+/**
+ * @brief NOOP response.
+ *
+ */
+struct Noop
+{};
+
+/**
+ * @brief Search response, ids are kept as ranges.
+ *
+ */
+using Search = SequenceSet;
+
+/**
+ * @brief Extended SEARCH response (RFC 4731), data which was not requested
+ * is left empty.
+ *
+ */
+struct ESearch
+{
+  std::size_t uidvalidity{ 0 }; /**< UIDVALIDITY, set for UID SEARCH. */
+  bool uid{ false };            /**< Ids are UIDs. */
+  std::size_t min{ 0 };         /**< MIN, 0 if nothing matched. */
+  std::size_t max{ 0 };         /**< MAX, 0 if nothing matched. */
+  std::size_t count{ 0 };       /**< COUNT. */
+  Search ids;                   /**< ALL, or ids within the PARTIAL window. */
+};
+
+/**
+ * @brief Raw header fields of a fetched mail, nothing is decoded until a
+ * field is accessed.
+ *
+ */
+class TEMAIL_PUBLIC FetchHeader
+{
+private:
+  QByteArray _raw;
+
+public:
+  FetchHeader() = default;
+
+  /**
+   * @brief Construct a new header from raw bytes.
+   *
+   * @param raw Raw header bytes (RFC 5322).
+   */
+  explicit FetchHeader(QByteArray raw)
+    : _raw{ std::move(raw) }
+  {
+  }
+
+  /**
+   * @brief Get raw header bytes.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE auto& raw() const { return _raw; }
+
+  /**
+   * @brief Check if header was not fetched.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE bool empty() const { return _raw.isEmpty(); }
+
+  /**
+   * @brief Find a header field (case insensitive), folded lines are joined.
+   *
+   * @param name Field name without colon.
+   * @return QByteArray Undecoded field value, empty if not found.
+   */
+  [[nodiscard]] QByteArray field(QByteArrayView name) const;
+
+  /**
+   * @brief Decode RFC 2047 encoded words of a header value.
+   *
+   * @param value Raw header value.
+   * @return QString Decoded value.
+   */
+  static QString decode(QByteArrayView value);
+};
+
+/**
+ * @brief Mail envelope (DATE, SUBJECT, FROM, TO header fields).
+ *
+ */
+class TEMAIL_PUBLIC FetchEnvelope : public FetchHeader
+{
+public:
+  using FetchHeader::FetchHeader;
+
+  /**
+   * @brief Get Date field, parsed on each call.
+   *
+   */
+  [[nodiscard]] QDateTime date() const;
+
+  /**
+   * @brief Get From field, decoded on each call.
+   *
+   */
+  [[nodiscard]] QString from() const;
+
+  /**
+   * @brief Get To field, decoded on each call.
+   *
+   */
+  [[nodiscard]] QString to() const;
+
+  /**
+   * @brief Get Subject field, decoded on each call.
+   *
+   */
+  [[nodiscard]] QString subject() const;
+};
+
+/**
+ * @brief Mail content type (Content-Type header field).
+ *
+ */
+class TEMAIL_PUBLIC FetchContentType : public FetchHeader
+{
+public:
+  using FetchHeader::FetchHeader;
+
+  /**
+   * @brief Get media type such as `text/plain`, lower case.
+   *
+   */
+  [[nodiscard]] QString content_type() const;
+
+  /**
+   * @brief Get charset parameter, lower case.
+   *
+   */
+  [[nodiscard]] QString charset() const;
+};
+
+/**
+ * @brief Fetched mail.
+ *
+ */
+struct FetchItem
+{
+  std::size_t id{ 0 };
+  std::size_t uid{ 0 };              /**< UID, 0 if not fetched. */
+  std::size_t modseq{ 0 };           /**< MODSEQ, 0 if not fetched. */
+  std::size_t size{ 0 };             /**< RFC822.SIZE, 0 if not fetched. */
+  request::Fetch::FieldFlags fields; /**< Fields present in this item. */
+  QString emailid;                   /**< EMAILID, empty if not fetched. */
+  FlagSet flags;                     /**< Flags, set by FETCH or STORE. */
+  FetchEnvelope envelope;            /**< ENVELOPE. */
+  FetchContentType content_type;     /**< Mail content type, MIME. */
+  FetchContentType part_type;        /**< First part content type, MIME. */
+  QByteArray text; /**< First part, TEXT, still transfer-encoded. */
+};
+
+/**
+ * @brief Fetch response, ordered by mail id.
+ *
+ */
+using Fetch = QList<FetchItem>;
+
+/**
+ * @brief Envelopes of a bulk header sync stored as columns, filled by the
+ * UID FETCH parser without building `FetchItem`s.
+ *
+ * @note A mail costs about 30 bytes plus its subject: addresses are
+ * interned, dates are packed into 64 bits, subjects share one string arena
+ * and system flags are bits (keywords are not kept).
+ */
+class TEMAIL_PUBLIC Envelopes
+{
+public:
+  constexpr static int64_t NO_DATE =
+    std::numeric_limits<int64_t>::min(); /**< Packed date of a missing or
+                                            invalid Date field. */
+
+private:
+  std::size_t _uidvalidity{ 0 };
+  std::vector<uint32_t> _uids;
+  std::vector<int64_t> _dates; /**< Milliseconds since epoch, UTC. */
+  std::vector<uint32_t> _from; /**< Index in `_strings`. */
+  std::vector<uint32_t> _to;   /**< Index in `_strings`. */
+  std::vector<uint32_t> _subjects{ 0 }; /**< Offsets in `_arena`, n + 1. */
+  std::vector<uint32_t> _sizes;
+  std::vector<uint8_t> _flags; /**< `FlagSet::SYSTEM_FLAGS` bits. */
+  QString _arena;
+  QStringList _strings{ QString{} }; /**< Interned strings, 0 is empty. */
+  QHash<QString, uint32_t> _interned;
+
+public:
+  /**
+   * @brief Get mail count.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE std::size_t size() const
+  {
+    return _uids.size();
+  }
+
+  /**
+   * @brief Check if there is no mail.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE bool empty() const { return _uids.empty(); }
+
+  /**
+   * @brief Reserve columns for `count` mails.
+   *
+   */
+  void reserve(std::size_t count);
+
+  /**
+   * @brief Append a mail, header fields are decoded once.
+   *
+   * @param uid Mail UID.
+   * @param envelope Raw envelope, may be empty.
+   * @param size RFC822.SIZE.
+   * @param flags Flags, only system flags are kept.
+   */
+  void append(uint32_t uid,
+              const FetchEnvelope& envelope,
+              std::size_t size,
+              FlagSet::Flags flags);
+
+  /**
+   * @brief Get UIDVALIDITY of the selected folder.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE std::size_t uidvalidity() const
+  {
+    return _uidvalidity;
+  }
+
+  /**
+   * @brief Set UIDVALIDITY, filled by the client.
+   *
+   */
+  TEMAIL_INLINE void set_uidvalidity(std::size_t uidvalidity)
+  {
+    _uidvalidity = uidvalidity;
+  }
+
+  [[nodiscard]] TEMAIL_INLINE uint32_t uid(std::size_t index) const
+  {
+    return _uids[index];
+  }
+
+  /**
+   * @brief Get packed Date field, `NO_DATE` if missing, cheap to sort by.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE int64_t date_msecs(std::size_t index) const
+  {
+    return _dates[index];
+  }
+
+  /**
+   * @brief Get Date field in UTC, invalid if missing.
+   *
+   */
+  [[nodiscard]] QDateTime date(std::size_t index) const;
+
+  /**
+   * @brief Get decoded From field.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE const QString& from(std::size_t index) const
+  {
+    return _strings[_from[index]];
+  }
+
+  /**
+   * @brief Get decoded To field.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE const QString& to(std::size_t index) const
+  {
+    return _strings[_to[index]];
+  }
+
+  /**
+   * @brief Get decoded Subject field, valid while the store lives.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE QStringView subject(std::size_t index) const
+  {
+    return QStringView{ _arena }.sliced(
+      _subjects[index], _subjects[index + 1] - _subjects[index]);
+  }
+
+  /**
+   * @brief Get RFC822.SIZE.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE uint32_t mail_size(std::size_t index) const
+  {
+    return _sizes[index];
+  }
+
+  [[nodiscard]] TEMAIL_INLINE FlagSet::Flags flags(std::size_t index) const
+  {
+    return FlagSet::Flags::fromInt(_flags[index]);
+  }
+
+  /**
+   * @brief Get interned addresses, shared by all mails.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE auto& addresses() const { return _strings; }
+
+private:
+  /**
+   * @brief Intern a string.
+   *
+   * @param value String.
+   * @return uint32_t Index in `_strings`.
+   */
+  uint32_t _intern(const QString& value);
+};
+
 /**
  * @brief SELECT response.
  *
@@ -62,43 +392,61 @@ struct Select
   std::size_t recent{ 0 };
   std::size_t unseen{ 0 };
   std::size_t uidvalidity{ 0 };
-  QStringList flags;
-  QStringList permanent_flags;
+  std::size_t highestmodseq{ 0 }; /**< 0 if server has no CONDSTORE. */
+  FlagSet flags;
+  FlagSet permanent_flags;
   QString permission;
+  Search vanished; /**< UIDs expunged since QRESYNC modseq. */
+  Fetch changed;   /**< Mails changed since QRESYNC modseq. */
 };
 
 /**
- * @brief NOOP response.
+ * @brief UID FETCH and UID STORE response.
  *
  */
-struct Noop
-{};
+struct UidFetch
+{
+  std::size_t uidvalidity{ 0 }; /**< UIDVALIDITY of the selected folder. */
+  Fetch items;
+  Search vanished; /**< UIDs expunged since CHANGEDSINCE modseq. */
+};
 
 /**
- * @brief Search response.
+ * @brief UID SEARCH response.
  *
  */
-using Search = QList<std::size_t>;
-
-struct FetchEnvelope
+struct UidSearch
 {
-  QDateTime date;
-  QString from;
-  QString to;
-  QString subject;
+  std::size_t uidvalidity{ 0 }; /**< UIDVALIDITY of the selected folder. */
+  Search uids;
 };
 
-struct FetchContentType
+/**
+ * @brief APPEND response.
+ *
+ */
+struct Append
 {
-  QString content_type;
-  QString charset;
+  std::size_t uidvalidity{ 0 }; /**< 0 if server has no UIDPLUS. */
+  Search uids;                  /**< UIDs of appended mails (APPENDUID). */
 };
 
 /**
- * @brief Fetch response.
+ * @brief Any command response, `std::monostate` for commands without data.
  *
  */
-using Fetch = QList<QMap<request::Fetch::Field, QVariant>>;
+using Result = std::variant<std::monostate,
+                            Login,
+                            List,
+                            Select,
+                            Noop,
+                            Search,
+                            Fetch,
+                            UidFetch,
+                            UidSearch,
+                            ESearch,
+                            Envelopes,
+                            Append>;
 
 }
 
@@ -147,10 +495,10 @@ operator<<(QDebug& dbg, const temail::client::response::FetchEnvelope& response)
 {
   return dbg.noquote()
          << QString{ "FetchEnvelope[date: %1, from: %2, to: %3, subject: %4]" }
-              .arg(response.date.toString())
-              .arg(response.from)
-              .arg(response.to)
-              .arg(response.subject);
+              .arg(response.date().toString())
+              .arg(response.from())
+              .arg(response.to())
+              .arg(response.subject());
 }
 
 Q_DECLARE_METATYPE(temail::client::response::FetchContentType)
@@ -161,6 +509,96 @@ operator<<(QDebug& dbg,
 {
   return dbg.noquote()
          << QString{ "FetchContentType[content_type: %1, charset: %2]" }
-              .arg(response.content_type)
-              .arg(response.charset);
+              .arg(response.content_type())
+              .arg(response.charset());
+}
+
+Q_DECLARE_METATYPE(temail::client::response::FetchItem)
+
+TEMAIL_INLINE QDebug&
+operator<<(QDebug& dbg, const temail::client::response::FetchItem& response)
+{
+  return dbg.noquote() << QString{ "FetchItem[id: %1, text: %2 bytes]" }
+                            .arg(response.id)
+                            .arg(response.text.size());
+}
+
+Q_DECLARE_METATYPE(temail::client::response::UidFetch)
+
+TEMAIL_INLINE QDebug&
+operator<<(QDebug& dbg, const temail::client::response::UidFetch& response)
+{
+  return dbg.noquote() << QString{ "UidFetch[uidvalidity: %1, items: %2]" }
+                            .arg(response.uidvalidity)
+                            .arg(response.items.size());
+}
+
+Q_DECLARE_METATYPE(temail::client::response::UidSearch)
+
+TEMAIL_INLINE QDebug&
+operator<<(QDebug& dbg, const temail::client::response::UidSearch& response)
+{
+  return dbg.noquote() << QString{ "UidSearch[uidvalidity: %1, uids: %2]" }
+                            .arg(response.uidvalidity)
+                            .arg(response.uids.size());
+}
+
+Q_DECLARE_METATYPE(temail::client::response::ESearch)
+
+TEMAIL_INLINE QDebug&
+operator<<(QDebug& dbg, const temail::client::response::ESearch& response)
+{
+  return dbg.noquote()
+         << QString{ "ESearch[min: %1, max: %2, count: %3, ids: %4]" }
+              .arg(response.min)
+              .arg(response.max)
+              .arg(response.count)
+              .arg(response.ids.size());
+}
+
+Q_DECLARE_METATYPE(temail::client::response::Envelopes)
+
+TEMAIL_INLINE QDebug&
+operator<<(QDebug& dbg, const temail::client::response::Envelopes& response)
+{
+  return dbg.noquote() << QString{ "Envelopes[uidvalidity: %1, mails: %2, "
+                                   "addresses: %3]" }
+                            .arg(response.uidvalidity())
+                            .arg(response.size())
+                            .arg(response.addresses().size());
+}
+
+Q_DECLARE_METATYPE(temail::client::response::Append)
+
+TEMAIL_INLINE QDebug&
+operator<<(QDebug& dbg, const temail::client::response::Append& response)
+{
+  return dbg.noquote() << QString{ "Append[uidvalidity: %1, uids: %2]" }
+                            .arg(response.uidvalidity)
+                            .arg(response.uids.size());
+}
+
+namespace temail::client::response {
+
+/**
+ * @brief Box a response into `QVariant`, for the untyped interface only.
+ *
+ * @param result Response.
+ * @return QVariant Boxed response, invalid for `std::monostate`.
+ */
+TEMAIL_INLINE QVariant
+to_variant(Result&& result)
+{
+  return std::visit(
+    [](auto&& value) -> QVariant {
+      using Vt = std::decay_t<decltype(value)>;
+      if constexpr (std::is_same_v<Vt, std::monostate>) {
+        return {};
+      } else {
+        return QVariant::fromValue(std::forward<decltype(value)>(value));
+      }
+    },
+    std::move(result));
+}
+
 }
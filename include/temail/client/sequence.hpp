@@ -0,0 +1,273 @@
+/**
+ * @file sequence.hpp
+ * @author Dessera (dessera@qq.com)
+ * @brief Temail IMAP4 sequence set.
+ * @version 0.1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2025 Dessera
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <qdebug.h>
+#include <qlist.h>
+#include <qmetatype.h>
+#include <qstring.h>
+#include <qstringview.h>
+
+#include "temail/common.hpp"
+
+namespace temail::client {
+
+/**
+ * @brief Set of mail ids (sequence numbers or UIDs) stored as sorted,
+ * disjoint ranges, as in IMAP4 `sequence-set` such as `1:5,7,9:*`.
+ *
+ * @note A contiguous run costs 8 bytes however long it is, so a search
+ * matching a whole mailbox is a single range.
+ */
+class TEMAIL_PUBLIC SequenceSet
+{
+public:
+  using Id = uint32_t;
+
+  constexpr static Id LAST =
+    std::numeric_limits<Id>::max(); /**< Largest id, written as `*`. */
+
+  /**
+   * @brief Closed range `first:last`.
+   *
+   */
+  struct Range
+  {
+    Id first{ 0 };
+    Id last{ 0 };
+
+    [[nodiscard]] TEMAIL_INLINE std::size_t size() const
+    {
+      return static_cast<std::size_t>(last - first) + 1;
+    }
+
+    friend bool operator==(const Range& lhs, const Range& rhs)
+    {
+      return lhs.first == rhs.first && lhs.last == rhs.last;
+    }
+
+    friend bool operator!=(const Range& lhs, const Range& rhs)
+    {
+      return !(lhs == rhs);
+    }
+  };
+
+  /**
+   * @brief Forward iterator over ids in ascending order.
+   *
+   */
+  class const_iterator
+  {
+  private:
+    const Range* _range{ nullptr };
+    const Range* _end{ nullptr };
+    Id _id{ 0 };
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Id;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Id*;
+    using reference = Id;
+
+    const_iterator() = default;
+
+    const_iterator(const Range* range, const Range* end)
+      : _range{ range }
+      , _end{ end }
+      , _id{ range != end ? range->first : 0 }
+    {
+    }
+
+    TEMAIL_INLINE Id operator*() const { return _id; }
+
+    TEMAIL_INLINE const_iterator& operator++()
+    {
+      if (_id == _range->last) {
+        ++_range;
+        _id = _range != _end ? _range->first : 0;
+      } else {
+        ++_id;
+      }
+      return *this;
+    }
+
+    TEMAIL_INLINE const_iterator operator++(int)
+    {
+      auto it = *this;
+      ++*this;
+      return it;
+    }
+
+    friend bool operator==(const const_iterator& lhs,
+                           const const_iterator& rhs)
+    {
+      return lhs._range == rhs._range && lhs._id == rhs._id;
+    }
+
+    friend bool operator!=(const const_iterator& lhs,
+                           const const_iterator& rhs)
+    {
+      return !(lhs == rhs);
+    }
+  };
+
+private:
+  QList<Range> _ranges; /**< Sorted, never overlapping nor adjacent. */
+
+public:
+  SequenceSet() = default;
+
+  /**
+   * @brief Construct a set of one range.
+   *
+   * @param first First id.
+   * @param last Last id, `LAST` for `*`.
+   */
+  SequenceSet(Id first, Id last);
+
+  /**
+   * @brief Add an id, ascending insertion is amortized O(1).
+   *
+   * @param id Id to add.
+   */
+  TEMAIL_INLINE void insert(Id id) { insert(id, id); }
+
+  /**
+   * @brief Add a range, ascending insertion is amortized O(1).
+   *
+   * @param first First id.
+   * @param last Last id, swapped with `first` if smaller.
+   */
+  void insert(Id first, Id last);
+
+  /**
+   * @brief Add all ids of another set.
+   *
+   * @param other Set to merge.
+   */
+  void insert(const SequenceSet& other);
+
+  /**
+   * @brief Remove a range.
+   *
+   * @param first First id.
+   * @param last Last id, swapped with `first` if smaller.
+   */
+  void remove(Id first, Id last);
+
+  /**
+   * @brief Remove all ids of another set.
+   *
+   * @param other Set to subtract.
+   */
+  void remove(const SequenceSet& other);
+
+  /**
+   * @brief Check if an id is in the set, O(log ranges).
+   *
+   * @param id Id to find.
+   */
+  [[nodiscard]] bool contains(Id id) const;
+
+  /**
+   * @brief Get id count, O(ranges).
+   *
+   */
+  [[nodiscard]] std::size_t size() const;
+
+  /**
+   * @brief Check if set is empty.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE bool empty() const { return _ranges.isEmpty(); }
+
+  /**
+   * @brief Get sorted ranges.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE const QList<Range>& ranges() const
+  {
+    return _ranges;
+  }
+
+  /**
+   * @brief Get smallest id, the set must not be empty.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE Id front() const
+  {
+    return _ranges.first().first;
+  }
+
+  /**
+   * @brief Get largest id, the set must not be empty.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE Id back() const { return _ranges.last().last; }
+
+  /**
+   * @brief Remove all ids.
+   *
+   */
+  TEMAIL_INLINE void clear() { _ranges.clear(); }
+
+  [[nodiscard]] TEMAIL_INLINE const_iterator begin() const
+  {
+    return { _ranges.constData(), _ranges.constData() + _ranges.size() };
+  }
+
+  [[nodiscard]] TEMAIL_INLINE const_iterator end() const
+  {
+    auto* end = _ranges.constData() + _ranges.size();
+    return { end, end };
+  }
+
+  /**
+   * @brief Format as IMAP4 `sequence-set`, such as `1:5,7,9:*`.
+   *
+   * @return QString Sequence set, empty if set is empty.
+   */
+  [[nodiscard]] QString to_string() const;
+
+  /**
+   * @brief Parse an IMAP4 `sequence-set`, `*` is read as `LAST`.
+   *
+   * @param set Sequence set such as `1:5,7,9:*`, invalid items are skipped.
+   * @return SequenceSet Parsed set.
+   */
+  static SequenceSet parse(QStringView set);
+
+  friend bool operator==(const SequenceSet& lhs, const SequenceSet& rhs)
+  {
+    return lhs._ranges == rhs._ranges;
+  }
+
+  friend bool operator!=(const SequenceSet& lhs, const SequenceSet& rhs)
+  {
+    return !(lhs == rhs);
+  }
+};
+
+}
+
+Q_DECLARE_METATYPE(temail::client::SequenceSet)
+
+TEMAIL_INLINE QDebug&
+operator<<(QDebug& dbg, const temail::client::SequenceSet& set)
+{
+  return dbg.noquote() << QString{ "SequenceSet[%1]" }.arg(set.to_string());
+}
@@ -0,0 +1,48 @@
+/**
+ * @file capability.hpp
+ * @author Dessera (dessera@qq.com)
+ * @brief IMAP4 CAPABILITY response parser.
+ * @version 0.1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2025 Dessera
+ *
+ */
+
+#pragma once
+
+#include <functional>
+#include <qstring.h>
+#include <qstringlist.h>
+#include <qstringview.h>
+#include <qvariant.h>
+
+#include "temail/client/imap.hpp"
+#include "temail/private/client/imap/response.hpp"
+
+namespace temail::client::detail {
+
+/**
+ * @brief Handles IMAP4 CAPABILITY response, capabilities are collected by the
+ * client from the untagged responses.
+ *
+ * @param resp Response data.
+ * @param error_handler Emitted on error.
+ * @param success_handler Emitted on success with value.
+ */
+void
+imap_handle_capability(const detail::IMAPResponse& resp,
+                       const IMAP::ErrorCallback& error_handler,
+                       const IMAP::ResultCallback& success_handler);
+
+/**
+ * @brief Collect capability names, such as `IMAP4rev1` or `LITERAL+`.
+ *
+ * @param text Untagged CAPABILITY data, or response text.
+ * @param code Text is response text, only a leading `[CAPABILITY ...]` code
+ * is parsed.
+ * @return QStringList Capability names, empty without a code.
+ */
+QStringList
+imap_parse_capabilities(QStringView text, bool code);
+}
@@ -0,0 +1,34 @@
+/**
+ * @file compress.hpp
+ * @author Dessera (dessera@qq.com)
+ * @brief IMAP4 COMPRESS response parser.
+ * @version 0.1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2025 Dessera
+ *
+ */
+
+#pragma once
+
+#include <functional>
+#include <qstring.h>
+#include <qvariant.h>
+
+#include "temail/client/imap.hpp"
+#include "temail/private/client/imap/response.hpp"
+
+namespace temail::client::detail {
+
+/**
+ * @brief Handles IMAP4 COMPRESS response.
+ *
+ * @param resp Response data.
+ * @param error_handler Emitted on error.
+ * @param success_handler Emitted on success with value.
+ */
+void
+imap_handle_compress(const detail::IMAPResponse& resp,
+                     const IMAP::ErrorCallback& error_handler,
+                     const IMAP::ResultCallback& success_handler);
+}
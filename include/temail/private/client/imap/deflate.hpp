@@ -0,0 +1,91 @@
+/**
+ * @file deflate.hpp
+ * @author Dessera (dessera@qq.com)
+ * @brief IMAP4 COMPRESS=DEFLATE transport layer.
+ * @version 0.1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2025 Dessera
+ *
+ */
+
+#pragma once
+
+#include <qbytearray.h>
+#include <zlib.h>
+
+#include "temail/common.hpp"
+
+namespace temail::client::detail {
+
+/**
+ * @brief Streaming raw deflate (RFC 1951) in both directions, as required by
+ * COMPRESS=DEFLATE (RFC 4978).
+ *
+ * @note Each `deflate` call is sync flushed, so every command reaches the
+ * server as soon as it is written.
+ */
+class IMAPDeflate
+{
+private:
+  constexpr static int CHUNK_SIZE = 16384; /**< Output buffer growth step. */
+
+  z_stream _inflater{};
+  z_stream _deflater{};
+  bool _active{ false };
+  bool _error{ false };
+
+public:
+  IMAPDeflate() = default;
+
+  ~IMAPDeflate() { reset(); }
+
+  IMAPDeflate(const IMAPDeflate&) = delete;
+  IMAPDeflate& operator=(const IMAPDeflate&) = delete;
+  IMAPDeflate(IMAPDeflate&&) = delete;
+  IMAPDeflate& operator=(IMAPDeflate&&) = delete;
+
+  /**
+   * @brief Start both streams.
+   *
+   * @return true Streams started.
+   * @return false zlib failed to initialize.
+   */
+  bool start();
+
+  /**
+   * @brief Drop both streams, data passes through unchanged afterwards.
+   *
+   */
+  void reset();
+
+  /**
+   * @brief Check if compression is active.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE auto active() const { return _active; }
+
+  /**
+   * @brief Get error flag, set on corrupted input.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE auto error() const { return _error; }
+
+  /**
+   * @brief Decompress bytes received from the server.
+   *
+   * @param data Compressed bytes, may be split at any byte.
+   * @return QByteArray Decompressed bytes, empty on error.
+   */
+  QByteArray inflate(const QByteArray& data);
+
+  /**
+   * @brief Compress bytes sent to the server.
+   *
+   * @param data Plain bytes.
+   * @return QByteArray Compressed and flushed bytes, empty on error.
+   */
+  QByteArray deflate(const QByteArray& data);
+};
+
+}
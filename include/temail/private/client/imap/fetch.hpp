@@ -16,6 +16,7 @@
 #include <qvariant.h>
 
 #include "temail/client/imap.hpp"
+#include "temail/client/response.hpp"
 #include "temail/private/client/imap/response.hpp"
 
 namespace temail::client::detail {
@@ -30,5 +31,37 @@ namespace temail::client::detail {
 void
 imap_handle_fetch(const detail::IMAPResponse& resp,
                   const IMAP::ErrorCallback& error_handler,
-                  const IMAP::CommandCallback& success_handler);
+                  const IMAP::ResultCallback& success_handler);
+
+/**
+ * @brief Handles IMAP4 UID FETCH response, into `response::Envelopes` if
+ * the response collected columns.
+ *
+ * @param resp Response data, collected columns are moved out.
+ * @param error_handler Emitted on error.
+ * @param success_handler Emitted on success with value.
+ */
+void
+imap_handle_uid_fetch(detail::IMAPResponse& resp,
+                      const IMAP::ErrorCallback& error_handler,
+                      const IMAP::ResultCallback& success_handler);
+
+/**
+ * @brief Collect untagged FETCH data of a response.
+ *
+ * @param resp Response data.
+ * @return response::Fetch Fetched items ordered by id.
+ */
+response::Fetch
+imap_parse_fetch(const detail::IMAPResponse& resp);
+
+/**
+ * @brief Collect UIDs of untagged VANISHED data of a response.
+ *
+ * @param resp Response data.
+ * @return response::Search Expunged UIDs.
+ */
+response::Search
+imap_parse_vanished(const detail::IMAPResponse& resp);
+
 }
@@ -0,0 +1,235 @@
+/**
+ * @file keyword.hpp
+ * @author Dessera (dessera@qq.com)
+ * @brief IMAP4 keyword tables.
+ * @version 0.1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2025 Dessera
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include "temail/client/imap.hpp"
+
+namespace temail::client::detail {
+
+/**
+ * @brief Compile-time perfect hash table from keyword to enum value.
+ *
+ * @note The seed is searched at compile time, so adding keywords never needs
+ * manual tuning. Entries are indexed by enum value and must follow the enum
+ * order, `ordered` checks each of them. `Q_ENUM` names stay untouched for
+ * debugging.
+ *
+ * @tparam Et Enum type.
+ * @tparam N Keyword count.
+ */
+template<typename Et, std::size_t N>
+class KeywordTable
+{
+public:
+  constexpr static std::size_t SIZE = [] {
+    std::size_t size = 1;
+    while (size < N * 4) {
+      size <<= 1;
+    }
+    return size;
+  }(); /**< Slot count (power of 2). */
+
+  constexpr static uint32_t MAX_SEED = 4096; /**< Seed search limit. */
+
+  /**
+   * @brief Keyword of an enum value.
+   *
+   */
+  struct Entry
+  {
+    Et value;
+    std::string_view name;
+  };
+
+private:
+  std::array<Et, N> _values{};
+  std::array<std::string_view, N> _names{};
+  std::array<uint8_t, SIZE> _slots{}; /**< Keyword index + 1, 0 if empty. */
+  uint32_t _seed{ 0 };
+
+public:
+  /**
+   * @brief Construct a new keyword table.
+   *
+   * @param entries Keywords, ordered by enum value.
+   */
+  constexpr explicit KeywordTable(const Entry (&entries)[N])
+  {
+    for (std::size_t i = 0; i < N; ++i) {
+      _values[i] = entries[i].value;
+      _names[i] = entries[i].name;
+    }
+
+    for (uint32_t seed = 1; seed < MAX_SEED; ++seed) {
+      if (_try_seed(seed)) {
+        _seed = seed;
+        return;
+      }
+    }
+  }
+
+  /**
+   * @brief Check if a collision free seed was found.
+   *
+   */
+  [[nodiscard]] constexpr bool valid() const { return _seed != 0; }
+
+  /**
+   * @brief Check if every entry sits at the index of its enum value and is
+   * found by its name.
+   *
+   */
+  [[nodiscard]] constexpr bool ordered() const
+  {
+    for (std::size_t i = 0; i < N; ++i) {
+      if (static_cast<std::size_t>(_values[i]) != i ||
+          value(_names[i]) != _values[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * @brief Convert keyword to enum (case insensitive).
+   *
+   * @param key Raw keyword bytes.
+   * @return std::optional<Et> Enum value, empty if unknown.
+   */
+  [[nodiscard]] constexpr std::optional<Et> value(std::string_view key) const
+  {
+    if (key.empty()) {
+      return std::nullopt;
+    }
+
+    auto slot = _slots[_hash(key, _seed)];
+    if (slot == 0 || !_equal(_names[slot - 1], key)) {
+      return std::nullopt;
+    }
+
+    return static_cast<Et>(slot - 1);
+  }
+
+  /**
+   * @brief Convert enum to keyword.
+   *
+   * @param value Enum value.
+   * @return std::string_view Keyword.
+   */
+  [[nodiscard]] constexpr std::string_view name(Et value) const
+  {
+    return _names[static_cast<std::size_t>(value)];
+  }
+
+private:
+  constexpr static uint32_t _fold(char ch)
+  {
+    return static_cast<uint8_t>(ch) | 0x20U;
+  }
+
+  constexpr static std::size_t _hash(std::string_view key, uint32_t seed)
+  {
+    uint32_t hash = key.size();
+    hash = hash * seed + _fold(key.front());
+    hash = hash * seed + _fold(key[key.size() / 2]);
+    hash = hash * seed + _fold(key.back());
+    return (hash ^ (hash >> 7U)) & (SIZE - 1);
+  }
+
+  constexpr static bool _equal(std::string_view name, std::string_view key)
+  {
+    if (name.size() != key.size()) {
+      return false;
+    }
+
+    for (std::size_t i = 0; i < name.size(); ++i) {
+      if (_fold(name[i]) != _fold(key[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  constexpr bool _try_seed(uint32_t seed)
+  {
+    for (std::size_t i = 0; i < SIZE; ++i) {
+      _slots[i] = 0;
+    }
+
+    for (std::size_t i = 0; i < N; ++i) {
+      auto& slot = _slots[_hash(_names[i], seed)];
+      if (slot != 0) {
+        return false;
+      }
+      slot = static_cast<uint8_t>(i + 1);
+    }
+    return true;
+  }
+};
+
+inline constexpr KeywordTable<IMAP::Response, 20> RESPONSE_KEYWORDS{ {
+  { IMAP::Response::OK, "OK" },
+  { IMAP::Response::NO, "NO" },
+  { IMAP::Response::BAD, "BAD" },
+  { IMAP::Response::PREAUTH, "PREAUTH" },
+  { IMAP::Response::BYE, "BYE" },
+  { IMAP::Response::CAPABILITY, "CAPABILITY" },
+  { IMAP::Response::LIST, "LIST" },
+  { IMAP::Response::LSUB, "LSUB" },
+  { IMAP::Response::SEARCH, "SEARCH" },
+  { IMAP::Response::FLAGS, "FLAGS" },
+  { IMAP::Response::EXISTS, "EXISTS" },
+  { IMAP::Response::RECENT, "RECENT" },
+  { IMAP::Response::EXPUNGE, "EXPUNGE" },
+  { IMAP::Response::FETCH, "FETCH" },
+  { IMAP::Response::MAILBOX, "MAILBOX" },
+  { IMAP::Response::COPY, "COPY" },
+  { IMAP::Response::STORE, "STORE" },
+  { IMAP::Response::ENABLED, "ENABLED" },
+  { IMAP::Response::VANISHED, "VANISHED" },
+  { IMAP::Response::ESEARCH, "ESEARCH" },
+} }; /**< IMAP4 response keywords. */
+
+static_assert(RESPONSE_KEYWORDS.valid(), "No perfect hash for responses");
+static_assert(RESPONSE_KEYWORDS.ordered(),
+              "Response keywords mismatch enum order");
+
+inline constexpr KeywordTable<IMAP::Command, 16> COMMAND_KEYWORDS{ {
+  { IMAP::Command::LOGIN, "LOGIN" },
+  { IMAP::Command::LOGOUT, "LOGOUT" },
+  { IMAP::Command::LIST, "LIST" },
+  { IMAP::Command::SELECT, "SELECT" },
+  { IMAP::Command::NOOP, "NOOP" },
+  { IMAP::Command::SEARCH, "SEARCH" },
+  { IMAP::Command::FETCH, "FETCH" },
+  { IMAP::Command::UID_FETCH, "UID FETCH" },
+  { IMAP::Command::UID_SEARCH, "UID SEARCH" },
+  { IMAP::Command::UID_STORE, "UID STORE" },
+  { IMAP::Command::ENABLE, "ENABLE" },
+  { IMAP::Command::IDLE, "IDLE" },
+  { IMAP::Command::COMPRESS, "COMPRESS" },
+  { IMAP::Command::APPEND, "APPEND" },
+  { IMAP::Command::CAPABILITY, "CAPABILITY" },
+  { IMAP::Command::NOCMD, "NOCMD" },
+} }; /**< IMAP4 command keywords. */
+
+static_assert(COMMAND_KEYWORDS.valid(), "No perfect hash for commands");
+static_assert(COMMAND_KEYWORDS.ordered(),
+              "Command keywords mismatch enum order");
+
+}
@@ -30,5 +30,5 @@ namespace temail::client::detail {
 void
 imap_handle_logout(const detail::IMAPResponse& resp,
                    const IMAP::ErrorCallback& error_handler,
-                   const IMAP::CommandCallback& success_handler);
+                   const IMAP::ResultCallback& success_handler);
 }
@@ -13,19 +13,22 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <qbytearray.h>
-#include <qdatastream.h>
 #include <qlist.h>
 #include <qmap.h>
 #include <qpair.h>
-#include <qregularexpression.h>
 #include <qsslsocket.h>
 #include <qstring.h>
 #include <qtypes.h>
 #include <utility>
 
+#include "temail/client/flags.hpp"
 #include "temail/client/imap.hpp"
+#include "temail/client/response.hpp"
 #include "temail/common.hpp"
+#include "temail/private/client/imap/tokenizer.hpp"
+#include "temail/tag.hpp"
 
 namespace temail::client::detail {
 
@@ -35,45 +38,64 @@ namespace temail::client::detail {
  */
 class IMAPResponse
 {
-public:
-  inline static QRegularExpression TAGGED_REG{
-    R"REGEX((?P<tag>[A-Z]\d+) (?P<type>[A-Z]+) (?P<data>.*))REGEX"
-  }; /**< Regex to parse tagged response. */
-
-  inline static QRegularExpression UNTAGGED_REG{
-    R"REGEX(\* (?P<type>[A-Z-]+)( (?P<data>.*))?)REGEX"
-  }; /**< Regex to parse untagged response. */
-
-  inline static QRegularExpression UNTAGGED_TRAILING_REG{
-    R"REGEX(\* (?P<data>.*) (?P<type>[A-Z-]+))REGEX"
-  }; /**< Regex to parse untagged trailing response. */
-
-  inline static QRegularExpression UNTAGGED_FETCH_REG{
-    R"REGEX(\* (?P<id>[0-9]+) FETCH \((?P<data>.*)(\))?)REGEX"
-  }; /**< Regex to parse first FETCH response. */
+private:
+  /**
+   * @brief Parser states, one per grammar position.
+   *
+   */
+  enum class State : uint8_t
+  {
+    LINE,            /**< Expect `*` or tag. */
+    UNTAGGED,        /**< Expect untagged keyword or message number. */
+    UNTAGGED_NUMBER, /**< Expect keyword after message number. */
+    TAGGED,          /**< Expect tagged status keyword. */
+    TEXT,            /**< Expect rest of line. */
+    FETCH,           /**< Expect `(` of FETCH data. */
+    FETCH_KEY,       /**< Expect FETCH item name or `)`. */
+    FETCH_VALUE,     /**< Expect FETCH item value. */
+    FETCH_LIST,      /**< Inside parenthesized FETCH item value. */
+    FETCH_END,       /**< Expect CRLF after FETCH data. */
+    DONE,            /**< Tagged response received. */
+  };
 
   /**
-   * @brief Regex to parse FETCH paired response.
+   * @brief Kinds of response lines.
    *
-   * @note - BODY[1.MIME] NIL => (field BODY[1.MIME])
-   *       - BODY[HEADER.FIELDS (CONTENT-TYPE)] {12} => (field
-   * BODY[HEADER.FIELDS (CONTENT-TYPE)]) (size 12)
    */
-  inline static QRegularExpression PAIRED_FETCH_REG{
-    R"REGEX(\s?(?P<field>[A-Za-z0-9-\[\]\(\)\.\s]+?) (NIL|{(?P<size>[0-9]+)}(\s(?P<data>[\s\S]*))?)\s?)REGEX"
+  enum class Kind : uint8_t
+  {
+    TAGGED,
+    UNTAGGED,
+    UNTAGGED_TRAILING,
+    CONTINUATION,
   };
 
-private:
-  QString _tag;
+  char _prefix;
+  TagGenerator::Tag _tag;
+
+  IMAPTokenizer _tokens;
+  State _state{ State::LINE };
+
+  Kind _kind{ Kind::UNTAGGED };
+  IMAP::Response _type{ IMAP::Response::OK };
+  QByteArray _number;
 
-  bool _raw_mode{ false };
-  QByteArray _buffer{ "\r\n" };
+  IMAP::FetchSink _sink;
 
   std::size_t _id{ 0 };
-  qint64 _bytes_to_read{ 0 };
   QString _field;
+  QByteArray _list;
+  int _depth{ 0 };
+
+  bool _columns{ false };
+  response::Envelopes _envelopes;
+  uint32_t _row_uid{ 0 };     /**< UID of the FETCH data being parsed. */
+  std::size_t _row_size{ 0 }; /**< RFC822.SIZE of the FETCH data. */
+  FlagSet::Flags _row_flags;  /**< FLAGS of the FETCH data. */
+  QByteArray _row_header;     /**< Envelope header of the FETCH data. */
 
   bool _error{ false };
+  std::size_t _continuations{ 0 };
 
   QList<QPair<IMAP::Response, QString>> _tagged;
   QList<QPair<IMAP::Response, QString>> _untagged;
@@ -84,11 +106,19 @@ public:
   /**
    * @brief Construct a new IMAPResponse object.
    *
-   * @param sock Tcp socket.
+   * @param prefix Request tag prefix.
    * @param tag Request tag.
+   * @param sink FETCH literal sink, literals are kept in `raw` if empty.
+   * @param envelopes Collect FETCH data into `envelopes` instead of `raw`.
    */
-  IMAPResponse(QString tag)
-    : _tag{ std::move(tag) }
+  IMAPResponse(char prefix,
+               TagGenerator::Tag tag,
+               IMAP::FetchSink sink = {},
+               bool envelopes = false)
+    : _prefix{ prefix }
+    , _tag{ tag }
+    , _sink{ std::move(sink) }
+    , _columns{ envelopes }
   {
   }
 
@@ -139,72 +169,151 @@ public:
    * @brief Get raw response.
    *
    * @return const QMap<std::size_t, QMap<QString, QByteArray>>& Map of mail
-   * id and a submap, which contains fetch field and data.
+   * id and a submap, which contains fetch field and data (streamed literals
+   * are not included).
    */
   [[nodiscard]] TEMAIL_INLINE auto& raw() const { return _raw; }
 
+  /**
+   * @brief Check if FETCH data is collected into `envelopes`.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE bool collects_envelopes() const
+  {
+    return _columns;
+  }
+
+  /**
+   * @brief Get FETCH data collected into columns while parsing, mails
+   * without UID are skipped.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE auto& envelopes() const { return _envelopes; }
+
+  /**
+   * @brief Move collected columns out, the store is left empty.
+   *
+   */
+  TEMAIL_INLINE response::Envelopes take_envelopes()
+  {
+    return std::exchange(_envelopes, {});
+  }
+
+  /**
+   * @brief Check if a continuation request (`+`) has been received.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE bool continued() const
+  {
+    return _continuations != 0;
+  }
+
+  /**
+   * @brief Get count of continuation requests, one per synchronizing
+   * literal.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE auto continuations() const
+  {
+    return _continuations;
+  }
+
+  /**
+   * @brief Check if parser stopped between lines, so untagged data is not
+   * half parsed.
+   *
+   */
+  [[nodiscard]] TEMAIL_INLINE bool at_line_start() const
+  {
+    return _state == State::LINE || _state == State::DONE;
+  }
+
+  /**
+   * @brief Drop untagged data parsed so far, used by long-running commands
+   * (IDLE) which report updates before they complete.
+   *
+   */
+  TEMAIL_INLINE void clear_untagged()
+  {
+    _untagged.clear();
+    _untagged_trailing.clear();
+    _raw.clear();
+    _envelopes = response::Envelopes{};
+  }
+
+  /**
+   * @brief Get input bytes left after the tagged response, which belong to
+   * the next pending response.
+   *
+   * @return QByteArray Unconsumed input.
+   */
+  [[nodiscard]] TEMAIL_INLINE QByteArray remaining() const
+  {
+    return _tokens.remaining();
+  }
+
   /**
    * @brief Get response tag.
    *
-   * @return const QString& response tag.
+   * @return TagGenerator::Tag response tag.
    */
-  [[nodiscard]] TEMAIL_INLINE auto& tag() const { return _tag; }
+  [[nodiscard]] TEMAIL_INLINE auto tag() const { return _tag; }
 
 private:
   /**
-   * @brief Handles command input data.
+   * @brief Handles a line start token.
    *
-   * @param stream Data stream.
-   * @return true Successfully parsed command data.
-   * @return false Need more input or error occurred.
+   * @param token Token type.
+   * @return true Token accepted.
+   * @return false Error occurred.
    */
-  bool _handle_command(const QDataStream& stream);
+  bool _handle_line(IMAPTokenizer::Token token);
 
   /**
-   * @brief Handles raw input data.
+   * @brief Handles token after untagged mark.
    *
-   * @param stream Data stream.
-   * @return true Successfully parsed raw data.
-   * @return false Need more input or error occurred.
+   * @param token Token type.
+   * @return true Token accepted.
+   * @return false Error occurred.
+   */
+  bool _handle_untagged(IMAPTokenizer::Token token);
+
+  /**
+   * @brief Handles completed line text.
+   *
+   * @return true Response completed.
+   * @return false Need more input.
    */
-  bool _handle_raw(const QDataStream& stream);
+  bool _handle_text();
 
   /**
-   * @brief Handles tagged input data.
+   * @brief Handles tokens inside FETCH data.
    *
-   * @param data Data string.
-   * @return true Successfully parsed untagged data.
+   * @param token Token type.
+   * @return true Token accepted.
    * @return false Error occurred.
    */
-  bool _handle_tagged(const QString& data);
+  bool _handle_fetch(IMAPTokenizer::Token token);
 
   /**
-   * @brief Handles untagged input data.
+   * @brief Store a FETCH item value into `raw`, or into the envelope row.
    *
-   * @param data Data string.
-   * @param stream Data stream.
-   * @return true Successfully parsed untagged data.
-   * @return false Need more input or error occurred.
+   * @param value Item value.
    */
-  bool _handle_untagged(const QString& data, const QDataStream& stream);
+  void _store_value(QByteArray value);
 
   /**
-   * @brief Handles raw paired input data.
+   * @brief Append the envelope row of a finished FETCH data.
    *
-   * @param data Data string.
-   * @return true Successfully parsed raw data.
-   * @return false Error occurred.
    */
-  bool _handle_raw_meta(const QString& data);
+  void _end_fetch();
 
   /**
-   * @brief Try to Read a line into buffer.
+   * @brief Convert keyword token into response type.
    *
-   * @param stream Data stream.
-   * @return true Read successfully.
-   * @return false Failed to read a line (EOF or error).
+   * @return IMAP::Response Response type.
    */
-  bool _read_line_to_buffer(const QDataStream& stream);
+  IMAP::Response _keyword();
 };
 
 }
@@ -0,0 +1,102 @@
+/**
+ * @file scanner.hpp
+ * @author Dessera (dessera@qq.com)
+ * @brief Vectorized delimiter scanner for IMAP4 input.
+ * @version 0.1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2025 Dessera
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+
+// `TEMAIL_SCALAR_SCAN` keeps the scalar loop, the baseline benchmark uses it.
+#if defined(TEMAIL_SCALAR_SCAN)
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "temail/common.hpp"
+
+namespace temail::client::detail {
+
+/**
+ * @brief Find first byte in `[begin, end)` equal to any of `Chars`, one byte
+ * at a time.
+ *
+ * @tparam Chars Delimiters.
+ * @param begin Range begin.
+ * @param end Range end.
+ * @return const char* First match, `end` if not found.
+ */
+template<char... Chars>
+TEMAIL_INLINE const char*
+scan_any_scalar(const char* begin, const char* end)
+{
+  for (; begin != end; ++begin) {
+    const auto ch = *begin;
+    if (((ch == Chars) || ...)) {
+      return begin;
+    }
+  }
+  return end;
+}
+
+/**
+ * @brief Find first byte in `[begin, end)` equal to any of `Chars`, using
+ * AVX2 or SSE2 when the target supports it and `TEMAIL_SCALAR_SCAN` is not
+ * defined.
+ *
+ * @tparam Chars Delimiters.
+ * @param begin Range begin.
+ * @param end Range end.
+ * @return const char* First match, `end` if not found.
+ */
+template<char... Chars>
+TEMAIL_INLINE const char*
+scan_any(const char* begin, const char* end)
+{
+#if defined(TEMAIL_SCALAR_SCAN)
+#elif defined(__AVX2__)
+  constexpr auto BLOCK = 32;
+  while (end - begin >= BLOCK) {
+    const auto block =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+
+    auto hits = _mm256_setzero_si256();
+    ((hits = _mm256_or_si256(
+        hits, _mm256_cmpeq_epi8(block, _mm256_set1_epi8(Chars)))),
+     ...);
+
+    auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+    if (mask != 0) {
+      return begin + __builtin_ctz(mask);
+    }
+    begin += BLOCK;
+  }
+#elif defined(__SSE2__)
+  constexpr auto BLOCK = 16;
+  while (end - begin >= BLOCK) {
+    const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+
+    auto hits = _mm_setzero_si128();
+    ((hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8(Chars)))),
+     ...);
+
+    auto mask = static_cast<uint32_t>(_mm_movemask_epi8(hits));
+    if (mask != 0) {
+      return begin + __builtin_ctz(mask);
+    }
+    begin += BLOCK;
+  }
+#endif
+
+  return scan_any_scalar<Chars...>(begin, end);
+}
+
+}
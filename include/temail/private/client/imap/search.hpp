@@ -30,5 +30,17 @@ namespace temail::client::detail {
 void
 imap_handle_search(const detail::IMAPResponse& resp,
                    const IMAP::ErrorCallback& error_handler,
-                   const IMAP::CommandCallback& success_handler);
+                   const IMAP::ResultCallback& success_handler);
+
+/**
+ * @brief Handles IMAP4 UID SEARCH response.
+ *
+ * @param resp Response data.
+ * @param error_handler Emitted on error.
+ * @param success_handler Emitted on success with value.
+ */
+void
+imap_handle_uid_search(const detail::IMAPResponse& resp,
+                       const IMAP::ErrorCallback& error_handler,
+                       const IMAP::ResultCallback& success_handler);
 }
@@ -0,0 +1,126 @@
+/**
+ * @file submit.hpp
+ * @author Dessera (dessera@qq.com)
+ * @brief IMAP4 command submission queue.
+ * @version 0.1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2025 Dessera
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <qbytearray.h>
+#include <qlist.h>
+#include <qobject.h>
+#include <qpointer.h>
+#include <utility>
+
+#include "temail/client/imap.hpp"
+#include "temail/client/request.hpp"
+
+namespace temail::client::detail {
+
+/**
+ * @brief Lock-free multi-producer single-consumer queue (Vyukov).
+ *
+ * @note `push` may be called from any thread, `pop` only from the consumer
+ * thread.
+ *
+ * @tparam T Value type, must be default constructible.
+ */
+template<typename T>
+class MPSCQueue
+{
+private:
+  struct Node
+  {
+    std::atomic<Node*> next{ nullptr };
+    T value;
+  };
+
+  std::atomic<Node*> _head; /**< Last pushed node, shared by producers. */
+  Node* _tail;              /**< Consumed stub node, owned by consumer. */
+
+public:
+  MPSCQueue()
+    : _head{ new Node{} }
+    , _tail{ _head.load(std::memory_order_relaxed) }
+  {
+  }
+
+  ~MPSCQueue()
+  {
+    auto value = T{};
+    while (pop(value)) {
+    }
+    delete _tail;
+  }
+
+  MPSCQueue(const MPSCQueue&) = delete;
+  MPSCQueue& operator=(const MPSCQueue&) = delete;
+  MPSCQueue(MPSCQueue&&) = delete;
+  MPSCQueue& operator=(MPSCQueue&&) = delete;
+
+  /**
+   * @brief Push value, wait-free for producers.
+   *
+   * @param value Value.
+   */
+  void push(T value)
+  {
+    auto* node = new Node{};
+    node->value = std::move(value);
+
+    auto* prev = _head.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  /**
+   * @brief Pop value.
+   *
+   * @param value Output value.
+   * @return true Value popped.
+   * @return false Queue is empty (or a push is not linked yet).
+   */
+  bool pop(T& value)
+  {
+    auto* next = _tail->next.load(std::memory_order_acquire);
+    if (next == nullptr) {
+      return false;
+    }
+
+    value = std::move(next->value);
+    delete _tail;
+    _tail = next;
+    return true;
+  }
+};
+
+/**
+ * @brief Command submitted by any thread.
+ *
+ */
+struct IMAPSubmission
+{
+  IMAP::Command type{ IMAP::Command::NOCMD };
+  QByteArray cmd;
+  IMAP::ResultCallback callback;
+  IMAP::ErrorCallback error;
+  IMAP::FetchSink sink;
+  QPointer<QObject> context; /**< Completion context in submitting thread. */
+  bool remote{ false };      /**< Submitted outside the socket thread. */
+  QList<request::AppendMessage> messages; /**< APPEND mails. */
+  bool envelopes{ false };                /**< FETCH data into columns. */
+};
+
+/**
+ * @brief Submission queue feeding the socket thread.
+ *
+ */
+class IMAPSubmitQueue : public MPSCQueue<IMAPSubmission>
+{};
+
+}
@@ -0,0 +1,152 @@
+/**
+ * @file tokenizer.hpp
+ * @author Dessera (dessera@qq.com)
+ * @brief IMAP4 response tokenizer.
+ * @version 0.1.0
+ * @date 2026-10-16
+ *
+ * @copyright Copyright (c) 2025 Dessera
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <qbytearray.h>
+#include <qtypes.h>
+#include <utility>
+
+#include "temail/common.hpp"
+
+namespace temail::client::detail {
+
+/**
+ * @brief Resumable RFC3501 tokenizer, works directly on incoming bytes.
+ *
+ * @note Input may be split at any byte, `next` returns `Token::NONE` when it
+ * needs more input and continues from the same position after `feed`.
+ */
+class IMAPTokenizer
+{
+public:
+  /**
+   * @brief Token types.
+   *
+   */
+  enum class Token : uint8_t
+  {
+    NONE,          /**< Need more input. */
+    ERROR,         /**< Malformed input, tokenizer stops here. */
+    ATOM,          /**< Atom, bracket sections such as `BODY[1]` included. */
+    NIL,           /**< NIL atom. */
+    QUOTED,        /**< Quoted string (unescaped). */
+    LITERAL,       /**< Literal string `{n}\r\n...` (or its last chunk). */
+    LITERAL_CHUNK, /**< Partial literal, only in streaming mode. */
+    LIST_BEGIN,    /**< `(`. */
+    LIST_END,      /**< `)`. */
+    TEXT,          /**< Rest of line (only returned by `next_text`). */
+    CRLF,          /**< End of line. */
+  };
+
+private:
+  enum class State : uint8_t
+  {
+    START,
+    CR,
+    ATOM,
+    QUOTED,
+    QUOTED_ESCAPE,
+    LITERAL_SIZE,
+    LITERAL_CR,
+    LITERAL_LF,
+    LITERAL_DATA,
+    TEXT,
+    TEXT_LF,
+    TEXT_LITERAL,
+    ERROR,
+  };
+
+  QByteArray _input;
+  qsizetype _pos{ 0 };
+
+  State _state{ State::START };
+  QByteArray _value;
+  qint64 _literal_size{ 0 };
+  int _bracket{ 0 };
+  bool _stream_literals{ false };
+
+public:
+  /**
+   * @brief Append input data.
+   *
+   * @param data Input data.
+   */
+  void feed(const QByteArray& data);
+
+  /**
+   * @brief Enable or disable streaming mode, literals are returned as
+   * `Token::LITERAL_CHUNK` as soon as bytes arrive, and the last chunk as
+   * `Token::LITERAL`.
+   *
+   * @param enable Streaming flag.
+   */
+  TEMAIL_INLINE void stream_literals(bool enable) { _stream_literals = enable; }
+
+  /**
+   * @brief Read next token.
+   *
+   * @return Token Token type, value is available by `value`.
+   */
+  Token next();
+
+  /**
+   * @brief Read the rest of current line as text, trailing CRLF is consumed.
+   *
+   * @note Literals inside text are inlined as quoted strings.
+   *
+   * @return Token `Token::TEXT` if the line is completed.
+   */
+  Token next_text();
+
+  /**
+   * @brief Get value of last token.
+   *
+   * @return const QByteArray& Token value.
+   */
+  [[nodiscard]] TEMAIL_INLINE auto& value() const { return _value; }
+
+  /**
+   * @brief Take value of last token.
+   *
+   * @return QByteArray Token value.
+   */
+  TEMAIL_INLINE QByteArray take_value() { return std::move(_value); }
+
+  /**
+   * @brief Get unconsumed input.
+   *
+   * @return QByteArray Unconsumed input.
+   */
+  [[nodiscard]] TEMAIL_INLINE QByteArray remaining() const
+  {
+    return _input.sliced(_pos);
+  }
+
+private:
+  /**
+   * @brief Enter error state.
+   *
+   * @return Token `Token::ERROR`.
+   */
+  Token _fail();
+
+  /**
+   * @brief Check if text value ends with literal marker and strip it.
+   *
+   * @return true Literal marker found, `_literal_size` is set.
+   * @return false No literal marker.
+   */
+  bool _take_text_literal();
+};
+
+}
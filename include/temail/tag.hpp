@@ -14,6 +14,9 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
+#include <optional>
+#include <qbytearray.h>
 #include <qstring.h>
 #include <random>
 
@@ -34,8 +37,11 @@ public:
     'N', 'O', 'P', 'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z',
   }; /**< Alphabet. */
 
-  constexpr static uint16_t MAX_TAG_INDEX = 999; /**< Max index of tag. */
-  constexpr static int TAG_BASE = 10;            /**< Tag base. */
+  using Tag = uint64_t; /**< Tag number, monotonically increasing. */
+
+  constexpr static int TAG_BASE = 10; /**< Tag base. */
+  constexpr static std::size_t MAX_TAG_LENGTH =
+    std::numeric_limits<Tag>::digits10 + 2; /**< Max length of tag text. */
 
 private:
   inline static std::mt19937 RND{
@@ -48,7 +54,7 @@ private:
   }; /**< Letter selector. */
 
   char _tag;
-  uint16_t _idx{ 0 };
+  Tag _idx{ 0 };
 
 public:
   /**
@@ -73,9 +79,16 @@ public:
   /**
    * @brief Generate next tag.
    *
-   * @return QString Next tag.
+   * @return Tag Next tag.
    */
-  QString generate();
+  TEMAIL_INLINE Tag generate() { return _idx++; }
+
+  /**
+   * @brief Get prefix letter.
+   *
+   * @return char Prefix letter.
+   */
+  [[nodiscard]] TEMAIL_INLINE char prefix() const { return _tag; }
 
   /**
    * @brief Get label of current tag (for logging or debug).
@@ -83,6 +96,25 @@ public:
    * @return QString Tag Label.
    */
   [[nodiscard]] QString label() const;
+
+  /**
+   * @brief Append tag text to buffer without temporary allocation.
+   *
+   * @param out Output buffer.
+   * @param prefix Prefix letter.
+   * @param tag Tag number.
+   */
+  static void write(QByteArray& out, char prefix, Tag tag);
+
+  /**
+   * @brief Parse tag text.
+   *
+   * @param prefix Expected prefix letter.
+   * @param data Tag text.
+   * @return std::optional<Tag> Tag number, empty if `data` is not a tag with
+   * `prefix`.
+   */
+  static std::optional<Tag> parse(char prefix, const QByteArray& data);
 };
 
 }
@@ -0,0 +1,343 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <qbytearray.h>
+#include <qcryptographichash.h>
+#include <qdebug.h>
+#include <qdir.h>
+#include <qfile.h>
+#include <qlogging.h>
+#include <qmutex.h>
+#include <qstring.h>
+#include <qstringlist.h>
+#include <qstringview.h>
+#include <utility>
+
+#include "temail/client/body.hpp"
+
+namespace temail::client {
+
+namespace {
+
+constexpr char PACK_MAGIC[4] = { 'T', 'M', 'B', 'P' };
+constexpr uint32_t PACK_VERSION = 1;
+constexpr std::size_t HASH_SIZE = 32;
+
+/**
+ * @brief Pack file header, native endian as the metadata cache.
+ *
+ */
+struct PackHeader
+{
+  char magic[4];
+  uint32_t version;
+};
+
+/**
+ * @brief Record header, followed by the EMAILID and the compressed body.
+ *
+ * @note A record without body attaches an EMAILID to a stored body.
+ */
+struct RecordHeader
+{
+  char hash[HASH_SIZE];
+  uint32_t size;     /**< Compressed size, 0 for none. */
+  uint32_t raw_size; /**< Body size. */
+  uint16_t id_size;  /**< EMAILID size, 0 for none. */
+  uint16_t reserved;
+};
+
+static_assert(sizeof(PackHeader) == 8);
+static_assert(sizeof(RecordHeader) == 44);
+
+}
+
+BodyStore::BodyStore(QString directory)
+  : _directory{ std::move(directory) }
+{
+  _load();
+}
+
+BodyStore::Hash
+BodyStore::put(const QByteArray& body, const QString& emailid)
+{
+  auto digest = hash(body);
+
+  QMutexLocker guard{ &_lock };
+
+  auto stored = _bodies.contains(digest);
+  auto known = emailid.isEmpty() || _emailids.value(emailid) == digest;
+  if (stored && known) {
+    return digest;
+  }
+
+  auto packed = stored ? QByteArray{} : qCompress(body);
+  auto id = known ? QByteArray{} : emailid.toUtf8();
+  if (packed.size() > std::numeric_limits<uint32_t>::max() ||
+      body.size() > std::numeric_limits<uint32_t>::max() ||
+      id.size() > std::numeric_limits<uint16_t>::max()) {
+    qWarning() << "IMAP4 Body Store| Body or EMAILID is too large.";
+    return {};
+  }
+
+  if (!_open_pack()) {
+    return {};
+  }
+
+  auto header = RecordHeader{};
+  std::memcpy(header.hash, digest.constData(), HASH_SIZE);
+  header.size = static_cast<uint32_t>(packed.size());
+  header.raw_size = static_cast<uint32_t>(body.size());
+  header.id_size = static_cast<uint16_t>(id.size());
+  header.reserved = 0;
+
+  auto record = QByteArray{};
+  record.reserve(
+    static_cast<qsizetype>(sizeof(header)) + id.size() + packed.size());
+  record.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  record.append(id);
+  record.append(packed);
+
+  auto offset = _pack.size();
+  if (_pack.write(record) != record.size() || !_pack.flush()) {
+    qWarning() << "IMAP4 Body Store| Failed to write" << _pack.fileName()
+               << ":" << _pack.errorString();
+
+    // later records must not land behind a partial one, which would hide
+    // them from the next load, so cut it off or leave the pack behind.
+    if (!_pack.resize(offset)) {
+      _pack.close();
+      _pack_index += 1;
+    }
+    return {};
+  }
+
+  if (!stored) {
+    _bodies.insert(digest,
+                   Location{ _pack_index,
+                             offset + static_cast<qint64>(sizeof(header)) +
+                               id.size(),
+                             header.size,
+                             header.raw_size });
+    _stats.bodies += 1;
+    _stats.raw_bytes += header.raw_size;
+    _stats.packed_bytes += header.size;
+  }
+
+  if (!known) {
+    _emailids.insert(emailid, digest);
+    _stats.emailids = _emailids.size();
+  }
+
+  return digest;
+}
+
+std::optional<QByteArray>
+BodyStore::get(const Hash& hash) const
+{
+  QMutexLocker guard{ &_lock };
+  return _get(hash);
+}
+
+std::optional<QByteArray>
+BodyStore::find(const QString& emailid) const
+{
+  QMutexLocker guard{ &_lock };
+
+  auto it = _emailids.constFind(emailid);
+  if (it == _emailids.cend()) {
+    return std::nullopt;
+  }
+
+  return _get(*it);
+}
+
+bool
+BodyStore::contains(const Hash& hash) const
+{
+  QMutexLocker guard{ &_lock };
+  return _bodies.contains(hash);
+}
+
+BodyStore::Stats
+BodyStore::stats() const
+{
+  QMutexLocker guard{ &_lock };
+  return _stats;
+}
+
+BodyStore::Hash
+BodyStore::hash(const QByteArray& body)
+{
+  return QCryptographicHash::hash(body, QCryptographicHash::Sha256);
+}
+
+void
+BodyStore::_load()
+{
+  if (!QDir{}.mkpath(_directory)) {
+    qWarning() << "IMAP4 Body Store| Failed to create directory:"
+               << _directory;
+    return;
+  }
+
+  // names are zero padded, so packs are indexed from the oldest.
+  auto names = QDir{ _directory }.entryList(
+    QStringList{ "pack-*.pack" }, QDir::Files, QDir::Name);
+
+  auto last = std::optional<uint32_t>{};
+  auto last_end = qint64{ 0 };
+
+  for (const auto& name : names) {
+    auto ok = false;
+    auto index = QStringView{ name }.sliced(5).chopped(5).toUInt(&ok);
+    if (!ok) {
+      continue;
+    }
+
+    last = index;
+    last_end = _load_pack(index);
+  }
+
+  if (!last.has_value()) {
+    return;
+  }
+
+  // appending after a foreign file would corrupt it, start a new pack.
+  if (last_end < 0) {
+    _pack_index = *last + 1;
+    return;
+  }
+
+  _pack_index = *last;
+
+  auto file = QFile{ _pack_path(_pack_index) };
+  if (file.size() > last_end) {
+    qWarning() << "IMAP4 Body Store| Cutting truncated record off"
+               << file.fileName();
+    file.resize(last_end);
+  }
+}
+
+qint64
+BodyStore::_load_pack(uint32_t index)
+{
+  auto file = QFile{ _pack_path(index) };
+  if (!file.open(QIODevice::ReadOnly)) {
+    qWarning() << "IMAP4 Body Store| Failed to open" << file.fileName()
+               << ":" << file.errorString();
+    return -1;
+  }
+
+  auto pack = PackHeader{};
+  if (file.read(reinterpret_cast<char*>(&pack), sizeof(pack)) !=
+        static_cast<qint64>(sizeof(pack)) ||
+      std::memcmp(pack.magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0 ||
+      pack.version != PACK_VERSION) {
+    qWarning() << "IMAP4 Body Store| Ignoring invalid pack" << file.fileName();
+    return -1;
+  }
+
+  auto size = file.size();
+  auto pos = static_cast<qint64>(sizeof(pack));
+
+  while (size - pos >= static_cast<qint64>(sizeof(RecordHeader))) {
+    auto header = RecordHeader{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    auto data = pos + static_cast<qint64>(sizeof(header)) + header.id_size;
+    auto end = data + header.size;
+    if (end > size) {
+      break;
+    }
+
+    auto digest = Hash{ header.hash, static_cast<qsizetype>(HASH_SIZE) };
+    if (header.size != 0 && !_bodies.contains(digest)) {
+      _bodies.insert(
+        digest, Location{ index, data, header.size, header.raw_size });
+      _stats.bodies += 1;
+      _stats.raw_bytes += header.raw_size;
+      _stats.packed_bytes += header.size;
+    }
+
+    if (header.id_size != 0) {
+      _emailids.insert(QString::fromUtf8(file.read(header.id_size)), digest);
+    }
+
+    pos = end;
+    file.seek(pos);
+  }
+
+  _stats.emailids = _emailids.size();
+  return pos;
+}
+
+bool
+BodyStore::_open_pack()
+{
+  if (_pack.isOpen()) {
+    if (_pack.size() < PACK_SIZE) {
+      return true;
+    }
+    _pack.close();
+    _pack_index += 1;
+  }
+
+  _pack.setFileName(_pack_path(_pack_index));
+  if (_pack.size() >= PACK_SIZE) {
+    _pack_index += 1;
+    _pack.setFileName(_pack_path(_pack_index));
+  }
+  auto fresh = !_pack.exists();
+
+  if (!_pack.open(QIODevice::WriteOnly | QIODevice::Append)) {
+    qWarning() << "IMAP4 Body Store| Failed to open" << _pack.fileName()
+               << ":" << _pack.errorString();
+    return false;
+  }
+
+  if (fresh) {
+    auto pack = PackHeader{};
+    std::memcpy(pack.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+    pack.version = PACK_VERSION;
+    _pack.write(reinterpret_cast<const char*>(&pack), sizeof(pack));
+  }
+
+  return true;
+}
+
+std::optional<QByteArray>
+BodyStore::_get(const Hash& hash) const
+{
+  auto it = _bodies.constFind(hash);
+  if (it == _bodies.cend()) {
+    return std::nullopt;
+  }
+
+  auto file = QFile{ _pack_path(it->pack) };
+  if (!file.open(QIODevice::ReadOnly) || !file.seek(it->offset)) {
+    qWarning() << "IMAP4 Body Store| Failed to open" << file.fileName()
+               << ":" << file.errorString();
+    return std::nullopt;
+  }
+
+  // the digest is checked again, a damaged pack must not serve wrong mail.
+  auto body = qUncompress(file.read(it->size));
+  if (body.size() != it->raw_size || BodyStore::hash(body) != hash) {
+    qWarning() << "IMAP4 Body Store| Corrupted body in" << file.fileName();
+    return std::nullopt;
+  }
+
+  return body;
+}
+
+QString
+BodyStore::_pack_path(uint32_t index) const
+{
+  return QDir{ _directory }.filePath(
+    QString{ "pack-%1.pack" }.arg(index, 6, 10, QChar{ '0' }));
+}
+
+}
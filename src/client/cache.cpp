@@ -0,0 +1,825 @@
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <qbytearray.h>
+#include <qdebug.h>
+#include <qdir.h>
+#include <qfile.h>
+#include <qlogging.h>
+#include <qsavefile.h>
+#include <qstring.h>
+#include <qstringlist.h>
+#include <qstringview.h>
+#include <qurl.h>
+#include <utility>
+
+#include "temail/client/base.hpp"
+#include "temail/client/cache.hpp"
+#include "temail/client/flags.hpp"
+#include "temail/client/request.hpp"
+#include "temail/client/response.hpp"
+#include "temail/client/sequence.hpp"
+
+namespace temail::client {
+
+namespace {
+
+constexpr char CACHE_MAGIC[4] = { 'T', 'M', 'C', '1' };
+constexpr uint32_t CACHE_VERSION = 3;
+
+// header fields fetched by `request::Fetch::ENVELOPE`.
+constexpr std::array<const char*, 4> ENVELOPE_FIELDS{
+  "Date", "Subject", "From", "To"
+};
+
+/**
+ * @brief Cache file header, fields are native endian so a file moved to a
+ * machine of other endianness fails the version check and is rebuilt.
+ *
+ */
+struct FileHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint64_t uidvalidity;
+  uint64_t highestmodseq;
+  uint32_t count; /**< Entry count. */
+  uint32_t reserved;
+};
+
+/**
+ * @brief Fixed size entry, sorted by UID and followed by the data heap.
+ *
+ */
+struct FileEntry
+{
+  uint32_t uid;
+  uint32_t flags;         /**< `FlagSet::Flag` bits. */
+  uint32_t keywords_size; /**< Space separated keywords, UTF-8. */
+  uint32_t envelope_size; /**< Raw envelope header. */
+  uint32_t fields;        /**< Fetched `request::Fetch::Field` bits. */
+  uint32_t reserved;
+  uint64_t size;
+  uint64_t modseq;
+  uint64_t offset; /**< Keywords offset in the heap, envelope follows. */
+};
+
+static_assert(sizeof(FileHeader) == 32);
+static_assert(sizeof(FileEntry) == 48);
+
+// the mapping has no alignment guarantee, so fields are copied out.
+template<typename T>
+TEMAIL_INLINE T
+_read(const uchar* data)
+{
+  auto value = T{};
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+TEMAIL_INLINE FileEntry
+_read_entry(const uchar* map, std::size_t index)
+{
+  return _read<FileEntry>(map + sizeof(FileHeader) +
+                          (index * sizeof(FileEntry)));
+}
+
+TEMAIL_INLINE std::size_t
+_heap_offset(std::size_t count)
+{
+  return sizeof(FileHeader) + (count * sizeof(FileEntry));
+}
+
+/**
+ * @brief Check header and entries of a mapped file, so records can be read
+ * without bound checks.
+ *
+ */
+bool
+_validate(const uchar* map, std::size_t size)
+{
+  if (size < sizeof(FileHeader)) {
+    return false;
+  }
+
+  auto header = _read<FileHeader>(map);
+  if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+      header.version != CACHE_VERSION) {
+    return false;
+  }
+
+  auto heap = _heap_offset(header.count);
+  if (heap > size) {
+    return false;
+  }
+
+  auto heap_size = size - heap;
+  auto last_uid = uint32_t{ 0 };
+  for (std::size_t i = 0; i < header.count; ++i) {
+    auto entry = _read_entry(map, i);
+    auto data_size =
+      static_cast<uint64_t>(entry.keywords_size) + entry.envelope_size;
+
+    if (entry.uid <= last_uid || entry.offset > heap_size ||
+        data_size > heap_size - entry.offset) {
+      return false;
+    }
+    last_uid = entry.uid;
+  }
+
+  return true;
+}
+
+constexpr auto CACHED_FIELDS = request::Fetch::FieldFlags{
+  request::Fetch::SIZE | request::Fetch::FLAGS | request::Fetch::ENVELOPE
+};
+
+/**
+ * @brief Searched fields of a dirty record or a mapped entry, keywords of an
+ * entry are never decoded and its envelope is only wrapped once a key needs
+ * it.
+ *
+ */
+class MatchView
+{
+public:
+  SequenceSet::Id uid;
+  request::Fetch::FieldFlags fields;
+  std::size_t size;
+  FlagSet::Flags flags;
+
+private:
+  const response::FetchEnvelope* _record{ nullptr };
+  const char* _raw{ nullptr };
+  uint32_t _raw_size{ 0 };
+  mutable std::optional<response::FetchEnvelope> _mapped;
+
+public:
+  explicit MatchView(const IMAPCache::Record& record)
+    : uid{ record.uid }
+    , fields{ record.fields }
+    , size{ record.size }
+    , flags{ record.flags.flags() }
+    , _record{ &record.envelope }
+  {
+  }
+
+  MatchView(const FileEntry& entry, const char* heap)
+    : uid{ entry.uid }
+    , fields{ request::Fetch::FieldFlags::fromInt(
+                static_cast<int>(entry.fields)) &
+              CACHED_FIELDS }
+    , size{ static_cast<std::size_t>(entry.size) }
+    , flags{ FlagSet::Flags::fromInt(entry.flags) }
+    , _raw{ heap + entry.offset + entry.keywords_size }
+    , _raw_size{ entry.envelope_size }
+  {
+  }
+
+  [[nodiscard]] const response::FetchEnvelope& envelope() const
+  {
+    if (_record != nullptr) {
+      return *_record;
+    }
+
+    // the mapping outlives the search, bytes are not copied.
+    if (!_mapped) {
+      _mapped.emplace(
+        QByteArray::fromRawData(_raw, static_cast<qsizetype>(_raw_size)));
+    }
+    return *_mapped;
+  }
+};
+
+void
+_merge(IMAPCache::Record& record, const response::FetchItem& item)
+{
+  record.fields |= item.fields & CACHED_FIELDS;
+
+  if (item.modseq != 0) {
+    record.modseq = item.modseq;
+  }
+
+  if (item.fields.testFlag(request::Fetch::SIZE)) {
+    record.size = item.size;
+  }
+
+  if (item.fields.testFlag(request::Fetch::FLAGS)) {
+    record.flags = item.flags;
+  }
+
+  if (item.fields.testFlag(request::Fetch::ENVELOPE)) {
+    record.envelope = item.envelope;
+  }
+}
+
+using SearchKey = request::SearchQuery::Key;
+
+/**
+ * @brief Check if a key can be evaluated with cached fields.
+ *
+ */
+bool
+_local_key(const SearchKey& key)
+{
+  switch (key.type) {
+    // \Recent belongs to one session, a cached value is meaningless.
+    case SearchKey::CRITERIA:
+      return key.criteria != request::Search::NEW &&
+             key.criteria != request::Search::OLD &&
+             key.criteria != request::Search::RECENT;
+
+    case SearchKey::SENT_SINCE:
+    case SearchKey::SENT_BEFORE:
+    case SearchKey::SENT_ON:
+    case SearchKey::LARGER:
+    case SearchKey::SMALLER:
+    case SearchKey::FROM:
+    case SearchKey::TO:
+    case SearchKey::SUBJECT:
+      return true;
+
+    case SearchKey::HEADER:
+      return std::any_of(
+        ENVELOPE_FIELDS.cbegin(), ENVELOPE_FIELDS.cend(), [&](auto name) {
+          return key.field.compare(name, Qt::CaseInsensitive) == 0;
+        });
+
+    // `*` alone is the largest UID of the mailbox, unknown here.
+    case SearchKey::UID:
+      return key.ids.empty() ||
+             key.ids.ranges().last().first != SequenceSet::LAST;
+
+    default:
+      return false;
+  }
+}
+
+bool
+_match_criteria(FlagSet::Flags flags, request::Search::Criteria criteria)
+{
+  auto has = [flags](FlagSet::Flag flag) { return (flags & flag) != 0; };
+
+  switch (criteria) {
+    case request::Search::ANSWERED:
+      return has(FlagSet::ANSWERED);
+    case request::Search::DELETED:
+      return has(FlagSet::DELETED);
+    case request::Search::DRAFT:
+      return has(FlagSet::DRAFT);
+    case request::Search::FLAGGED:
+      return has(FlagSet::FLAGGED);
+    case request::Search::SEEN:
+      return has(FlagSet::SEEN);
+    case request::Search::UNANSWERED:
+      return !has(FlagSet::ANSWERED);
+    case request::Search::UNDELETED:
+      return !has(FlagSet::DELETED);
+    case request::Search::UNDRAFT:
+      return !has(FlagSet::DRAFT);
+    case request::Search::UNFLAGGED:
+      return !has(FlagSet::FLAGGED);
+    case request::Search::UNSEEN:
+      return !has(FlagSet::SEEN);
+    default:
+      return true;
+  }
+}
+
+/**
+ * @brief Match a local key, `complete` is cleared if a needed field was
+ * never fetched.
+ *
+ */
+bool
+_match(const MatchView& record, const SearchKey& key, bool& complete)
+{
+  auto needs = [&](request::Fetch::Field field) {
+    complete = complete && record.fields.testFlag(field);
+    return complete;
+  };
+
+  switch (key.type) {
+    case SearchKey::CRITERIA:
+      if (key.criteria == request::Search::ALL) {
+        return true;
+      }
+      return needs(request::Fetch::FLAGS) &&
+             _match_criteria(record.flags, key.criteria);
+
+    // time and timezone of the Date field are disregarded.
+    case SearchKey::SENT_SINCE:
+    case SearchKey::SENT_BEFORE:
+    case SearchKey::SENT_ON: {
+      if (!needs(request::Fetch::ENVELOPE)) {
+        return false;
+      }
+
+      auto date = record.envelope().date().date();
+      if (!date.isValid()) {
+        return false;
+      }
+
+      return key.type == SearchKey::SENT_SINCE    ? date >= key.date
+             : key.type == SearchKey::SENT_BEFORE ? date < key.date
+                                                  : date == key.date;
+    }
+
+    case SearchKey::LARGER:
+      return needs(request::Fetch::SIZE) &&
+             static_cast<qint64>(record.size) > key.size;
+
+    case SearchKey::SMALLER:
+      return needs(request::Fetch::SIZE) &&
+             static_cast<qint64>(record.size) < key.size;
+
+    case SearchKey::HEADER: {
+      if (!needs(request::Fetch::ENVELOPE)) {
+        return false;
+      }
+
+      // an empty value matches any mail which has the field.
+      auto raw = record.envelope().field(key.field.toLatin1());
+      return key.value.isEmpty()
+               ? !raw.isEmpty()
+               : response::FetchHeader::decode(raw).contains(
+                   key.value, Qt::CaseInsensitive);
+    }
+
+    case SearchKey::FROM:
+      return needs(request::Fetch::ENVELOPE) &&
+             record.envelope().from().contains(key.value,
+                                               Qt::CaseInsensitive);
+
+    case SearchKey::TO:
+      return needs(request::Fetch::ENVELOPE) &&
+             record.envelope().to().contains(key.value, Qt::CaseInsensitive);
+
+    case SearchKey::SUBJECT:
+      return needs(request::Fetch::ENVELOPE) &&
+             record.envelope().subject().contains(key.value,
+                                                  Qt::CaseInsensitive);
+
+    case SearchKey::UID:
+      return key.ids.contains(record.uid);
+
+    default:
+      complete = false;
+      return false;
+  }
+}
+
+}
+
+IMAPCache::IMAPCache(QString directory)
+  : _directory{ std::move(directory) }
+{
+}
+
+IMAPCache::~IMAPCache()
+{
+  close();
+}
+
+void
+IMAPCache::open(const QString& mailbox, std::size_t uidvalidity)
+{
+  close();
+
+  _mailbox = mailbox;
+  _map_file();
+
+  if (_map != nullptr) {
+    auto header = _read<FileHeader>(_map);
+    _uidvalidity = header.uidvalidity;
+    _highestmodseq = header.highestmodseq;
+  }
+
+  if (uidvalidity != 0 && uidvalidity != _uidvalidity) {
+    clear(uidvalidity);
+  }
+}
+
+void
+IMAPCache::close()
+{
+  if (!is_open()) {
+    return;
+  }
+
+  flush();
+  _unmap_file();
+
+  _mailbox.clear();
+  _uidvalidity = 0;
+  _highestmodseq = 0;
+  _cleared = false;
+  _modified = false;
+  _dirty.clear();
+  _removed.clear();
+}
+
+void
+IMAPCache::set_highestmodseq(std::size_t modseq)
+{
+  if (modseq != _highestmodseq) {
+    _highestmodseq = modseq;
+    _modified = true;
+  }
+}
+
+std::optional<IMAPCache::Record>
+IMAPCache::find(SequenceSet::Id uid) const
+{
+  if (auto it = _dirty.constFind(uid); it != _dirty.cend()) {
+    return *it;
+  }
+
+  if (_cleared || _removed.contains(uid)) {
+    return std::nullopt;
+  }
+
+  return _find_mapped(uid);
+}
+
+QList<IMAPCache::Record>
+IMAPCache::find(const SequenceSet& uids) const
+{
+  auto records = QList<Record>{};
+
+  // walk cached UIDs, a wanted range such as `1:*` may be huge.
+  for (auto uid : this->uids()) {
+    if (uids.contains(uid)) {
+      records.push_back(*find(uid));
+    }
+  }
+
+  return records;
+}
+
+SequenceSet
+IMAPCache::uids() const
+{
+  auto uids = SequenceSet{};
+
+  if (!_cleared) {
+    for (std::size_t i = 0; i < _mapped_count(); ++i) {
+      uids.insert(_read_entry(_map, i).uid);
+    }
+    uids.remove(_removed);
+  }
+
+  for (auto it = _dirty.keyBegin(); it != _dirty.keyEnd(); ++it) {
+    uids.insert(*it);
+  }
+
+  return uids;
+}
+
+SequenceSet
+IMAPCache::missing(const SequenceSet& uids) const
+{
+  auto missing = uids;
+  missing.remove(this->uids());
+  return missing;
+}
+
+std::optional<SequenceSet>
+IMAPCache::search(const request::SearchQuery& query) const
+{
+  if (!query.all_of(_local_key)) {
+    return std::nullopt;
+  }
+
+  auto matched = SequenceSet{};
+  auto complete = true;
+
+  auto visit = [&](const MatchView& record) {
+    auto match = query.evaluate([&record, &complete](const SearchKey& key) {
+      return _match(record, key, complete);
+    });
+
+    if (match) {
+      matched.insert(record.uid);
+    }
+    return complete;
+  };
+
+  // mapped entries are matched in place, dirty records replace them.
+  if (!_cleared && _map != nullptr) {
+    const auto* heap =
+      reinterpret_cast<const char*>(_map + _heap_offset(_mapped_count()));
+
+    for (std::size_t i = 0; i < _mapped_count(); ++i) {
+      auto entry = _read_entry(_map, i);
+      if (_dirty.contains(entry.uid) || _removed.contains(entry.uid)) {
+        continue;
+      }
+
+      if (!visit(MatchView{ entry, heap })) {
+        return std::nullopt;
+      }
+    }
+  }
+
+  for (const auto& record : _dirty) {
+    if (!visit(MatchView{ record })) {
+      return std::nullopt;
+    }
+  }
+
+  return matched;
+}
+
+void
+IMAPCache::uid_search(Base& client,
+                      const request::SearchQuery& query,
+                      std::size_t highestmodseq,
+                      const Base::Callback<response::UidSearch>& callback) const
+{
+  // a cache behind the server would miss flag changes.
+  if (is_open() && _highestmodseq != 0 && _highestmodseq == highestmodseq) {
+    if (auto uids = search(query)) {
+      callback(response::UidSearch{ _uidvalidity, std::move(*uids) });
+      return;
+    }
+  }
+
+  client.uid_search(query, callback);
+}
+
+void
+IMAPCache::update(const response::Select& select)
+{
+  if (select.uidvalidity != 0 && select.uidvalidity != _uidvalidity) {
+    clear(select.uidvalidity);
+  }
+
+  remove(select.vanished);
+  for (const auto& item : select.changed) {
+    update(item);
+  }
+}
+
+void
+IMAPCache::update(const response::UidFetch& fetch)
+{
+  if (fetch.uidvalidity != 0 && fetch.uidvalidity != _uidvalidity) {
+    clear(fetch.uidvalidity);
+  }
+
+  remove(fetch.vanished);
+  for (const auto& item : fetch.items) {
+    update(item);
+  }
+}
+
+void
+IMAPCache::update(const response::FetchItem& item)
+{
+  if (item.uid == 0 || item.uid > SequenceSet::LAST) {
+    return;
+  }
+
+  auto uid = static_cast<SequenceSet::Id>(item.uid);
+  auto record = find(uid).value_or(Record{ uid });
+  _merge(record, item);
+
+  _dirty.insert(uid, std::move(record));
+  _modified = true;
+}
+
+void
+IMAPCache::remove(const SequenceSet& uids)
+{
+  if (uids.empty()) {
+    return;
+  }
+
+  for (const auto& range : uids.ranges()) {
+    auto it = _dirty.lowerBound(range.first);
+    while (it != _dirty.end() && it.key() <= range.last) {
+      it = _dirty.erase(it);
+    }
+  }
+
+  if (!_cleared) {
+    _removed.insert(uids);
+  }
+  _modified = true;
+}
+
+void
+IMAPCache::clear(std::size_t uidvalidity)
+{
+  _uidvalidity = uidvalidity;
+  _highestmodseq = 0;
+  _cleared = true;
+  _modified = true;
+  _dirty.clear();
+  _removed.clear();
+}
+
+bool
+IMAPCache::flush()
+{
+  if (!is_open() || !_modified) {
+    return true;
+  }
+
+  if (!QDir{}.mkpath(_directory)) {
+    qWarning() << "IMAP4 Cache| Failed to create directory:" << _directory;
+    return false;
+  }
+
+  // merge mapped records with updates, both sorted by UID.
+  auto records = QList<Record>{};
+  auto dirty = _dirty.cbegin();
+  auto mapped = _cleared ? 0 : _mapped_count();
+  records.reserve(static_cast<qsizetype>(mapped) + _dirty.size());
+
+  for (std::size_t i = 0; i < mapped; ++i) {
+    auto uid = _read_entry(_map, i).uid;
+    for (; dirty != _dirty.cend() && dirty.key() <= uid; ++dirty) {
+      records.push_back(*dirty);
+    }
+
+    if (records.isEmpty() || records.back().uid != uid) {
+      if (!_removed.contains(uid)) {
+        records.push_back(_mapped_record(i));
+      }
+    }
+  }
+
+  for (; dirty != _dirty.cend(); ++dirty) {
+    records.push_back(*dirty);
+  }
+
+  auto header = FileHeader{};
+  std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  header.version = CACHE_VERSION;
+  header.uidvalidity = _uidvalidity;
+  header.highestmodseq = _highestmodseq;
+  header.count = static_cast<uint32_t>(records.size());
+  header.reserved = 0;
+
+  // keyword atoms only live as long as the process, so names are stored.
+  auto keywords = QList<QByteArray>{};
+  keywords.reserve(records.size());
+
+  auto entries = QByteArray{};
+  entries.reserve(records.size() * static_cast<qsizetype>(sizeof(FileEntry)));
+
+  auto offset = uint64_t{ 0 };
+  for (const auto& record : records) {
+    auto names = QStringList{};
+    for (auto atom : record.flags.keywords()) {
+      names.append(FlagSet::name(atom));
+    }
+    keywords.push_back(names.join(' ').toUtf8());
+
+    auto entry = FileEntry{};
+    entry.uid = record.uid;
+    entry.flags = record.flags.flags().toInt();
+    entry.keywords_size = static_cast<uint32_t>(keywords.back().size());
+    entry.envelope_size = static_cast<uint32_t>(record.envelope.raw().size());
+    entry.fields = static_cast<uint32_t>(record.fields.toInt());
+    entry.reserved = 0;
+    entry.size = record.size;
+    entry.modseq = record.modseq;
+    entry.offset = offset;
+
+    entries.append(reinterpret_cast<const char*>(&entry), sizeof(entry));
+    offset += entry.keywords_size + entry.envelope_size;
+  }
+
+  auto file = QSaveFile{ _file_path() };
+  if (!file.open(QIODevice::WriteOnly)) {
+    qWarning() << "IMAP4 Cache| Failed to open" << file.fileName() << ":"
+               << file.errorString();
+    return false;
+  }
+
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(entries);
+  for (qsizetype i = 0; i < records.size(); ++i) {
+    file.write(keywords[i]);
+    file.write(records[i].envelope.raw());
+  }
+
+  // some platforms cannot replace a mapped file.
+  _unmap_file();
+  auto committed = file.commit();
+
+  if (committed) {
+    _cleared = false;
+    _modified = false;
+    _dirty.clear();
+    _removed.clear();
+  } else {
+    qWarning() << "IMAP4 Cache| Failed to write" << file.fileName() << ":"
+               << file.errorString();
+  }
+
+  _map_file();
+  return committed;
+}
+
+void
+IMAPCache::_map_file()
+{
+  _file.setFileName(_file_path());
+  if (!_file.open(QIODevice::ReadOnly)) {
+    return;
+  }
+
+  auto size = static_cast<std::size_t>(_file.size());
+  auto* map = size != 0 ? _file.map(0, _file.size()) : nullptr;
+
+  if (map == nullptr || !_validate(map, size)) {
+    qWarning() << "IMAP4 Cache| Ignoring invalid cache file:"
+               << _file.fileName();
+    _file.close();
+    return;
+  }
+
+  _map = map;
+}
+
+void
+IMAPCache::_unmap_file()
+{
+  // closing the file also unmaps it.
+  _file.close();
+  _map = nullptr;
+}
+
+std::size_t
+IMAPCache::_mapped_count() const
+{
+  return _map != nullptr ? _read<FileHeader>(_map).count : 0;
+}
+
+IMAPCache::Record
+IMAPCache::_mapped_record(std::size_t index) const
+{
+  auto entry = _read_entry(_map, index);
+  const auto* data =
+    reinterpret_cast<const char*>(_map + _heap_offset(_mapped_count())) +
+    entry.offset;
+
+  auto flags = FlagSet{ FlagSet::Flags::fromInt(entry.flags) };
+  auto keywords = QString::fromUtf8(data, entry.keywords_size);
+  for (auto keyword : QStringView{ keywords }.split(' ', Qt::SkipEmptyParts)) {
+    flags.insert(keyword);
+  }
+
+  // bytes are copied, records outlive the mapping.
+  return Record{
+    entry.uid,
+    request::Fetch::FieldFlags::fromInt(static_cast<int>(entry.fields)) &
+      CACHED_FIELDS,
+    static_cast<std::size_t>(entry.size),
+    static_cast<std::size_t>(entry.modseq),
+    std::move(flags),
+    response::FetchEnvelope{
+      QByteArray{ data + entry.keywords_size, entry.envelope_size } },
+  };
+}
+
+std::optional<IMAPCache::Record>
+IMAPCache::_find_mapped(SequenceSet::Id uid) const
+{
+  auto lo = std::size_t{ 0 };
+  auto hi = _mapped_count();
+
+  while (lo < hi) {
+    auto mid = lo + ((hi - lo) / 2);
+    auto mid_uid = _read_entry(_map, mid).uid;
+
+    if (mid_uid == uid) {
+      return _mapped_record(mid);
+    }
+
+    if (mid_uid < uid) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return std::nullopt;
+}
+
+QString
+IMAPCache::_file_path() const
+{
+  // one flat file per mailbox, hierarchy delimiters are escaped too.
+  auto name = QString::fromLatin1(QUrl::toPercentEncoding(_mailbox));
+  return QDir{ _directory }.filePath(name + ".cache");
+}
+
+}
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <qalgorithms.h>
+#include <qhash.h>
+#include <qmutex.h>
+#include <qstring.h>
+#include <qstringlist.h>
+#include <qstringview.h>
+
+#include "temail/client/flags.hpp"
+
+namespace temail::client {
+
+namespace {
+
+/**
+ * @brief Name of a flag with a bit.
+ *
+ */
+struct FlagName
+{
+  FlagSet::Flag flag;
+  const char* name;
+};
+
+const std::array<FlagName, 23> FLAG_NAMES{ {
+  { FlagSet::SEEN, "\\Seen" },
+  { FlagSet::ANSWERED, "\\Answered" },
+  { FlagSet::FLAGGED, "\\Flagged" },
+  { FlagSet::DELETED, "\\Deleted" },
+  { FlagSet::DRAFT, "\\Draft" },
+  { FlagSet::RECENT, "\\Recent" },
+  { FlagSet::ANY_KEYWORD, "\\*" },
+  { FlagSet::NOINFERIORS, "\\Noinferiors" },
+  { FlagSet::NOSELECT, "\\Noselect" },
+  { FlagSet::MARKED, "\\Marked" },
+  { FlagSet::UNMARKED, "\\Unmarked" },
+  { FlagSet::HAS_CHILDREN, "\\HasChildren" },
+  { FlagSet::HAS_NO_CHILDREN, "\\HasNoChildren" },
+  { FlagSet::NONEXISTENT, "\\NonExistent" },
+  { FlagSet::SUBSCRIBED, "\\Subscribed" },
+  { FlagSet::REMOTE, "\\Remote" },
+  { FlagSet::ALL, "\\All" },
+  { FlagSet::ARCHIVE, "\\Archive" },
+  { FlagSet::DRAFTS, "\\Drafts" },
+  { FlagSet::JUNK, "\\Junk" },
+  { FlagSet::SENT, "\\Sent" },
+  { FlagSet::TRASH, "\\Trash" },
+  { FlagSet::IMPORTANT, "\\Important" },
+} }; /**< Flag names, in bit order. */
+
+/**
+ * @brief Process-wide keyword atoms.
+ *
+ */
+struct AtomTable
+{
+  QMutex lock;
+  QHash<QString, FlagSet::Atom> atoms; /**< Case-folded keyword to atom. */
+  QStringList names;                   /**< Keyword as first interned. */
+};
+
+AtomTable&
+_atom_table()
+{
+  static auto table = AtomTable{};
+  return table;
+}
+
+}
+
+void
+FlagSet::insert(QStringView flag)
+{
+  if (auto bit = _flag(flag)) {
+    _flags |= *bit;
+    return;
+  }
+
+  auto atom = intern(flag);
+  auto it = std::lower_bound(_keywords.begin(), _keywords.end(), atom);
+  if (it == _keywords.end() || *it != atom) {
+    _keywords.insert(it, atom);
+  }
+}
+
+void
+FlagSet::remove(QStringView flag)
+{
+  if (auto bit = _flag(flag)) {
+    remove(*bit);
+    return;
+  }
+
+  if (auto atom = _find(flag)) {
+    _keywords.removeOne(*atom);
+  }
+}
+
+bool
+FlagSet::contains(QStringView flag) const
+{
+  if (auto bit = _flag(flag)) {
+    return test(*bit);
+  }
+
+  auto atom = _find(flag);
+  return atom.has_value() &&
+         std::binary_search(_keywords.cbegin(), _keywords.cend(), *atom);
+}
+
+bool
+FlagSet::contains(const FlagSet& other) const
+{
+  return (_flags & other._flags) == other._flags &&
+         std::includes(_keywords.cbegin(),
+                       _keywords.cend(),
+                       other._keywords.cbegin(),
+                       other._keywords.cend());
+}
+
+QStringList
+FlagSet::to_list() const
+{
+  auto list = QStringList{};
+  list.reserve(static_cast<qsizetype>(qPopulationCount(_flags.toInt())) +
+               _keywords.size());
+
+  for (const auto& item : FLAG_NAMES) {
+    if (_flags.testFlag(item.flag)) {
+      list.append(QString::fromLatin1(item.name));
+    }
+  }
+
+  for (auto atom : _keywords) {
+    list.append(name(atom));
+  }
+
+  return list;
+}
+
+QString
+FlagSet::to_string() const
+{
+  return to_list().join(' ');
+}
+
+FlagSet
+FlagSet::parse(QStringView list)
+{
+  auto parsed = FlagSet{};
+
+  list = list.trimmed();
+  if (list.startsWith('(')) {
+    list = list.sliced(1);
+  }
+  if (list.endsWith(')')) {
+    list.chop(1);
+  }
+
+  for (auto flag : list.split(' ', Qt::SkipEmptyParts)) {
+    parsed.insert(flag);
+  }
+
+  return parsed;
+}
+
+FlagSet::Atom
+FlagSet::intern(QStringView keyword)
+{
+  auto& table = _atom_table();
+  auto key = keyword.toString().toCaseFolded();
+
+  QMutexLocker guard{ &table.lock };
+
+  auto it = table.atoms.constFind(key);
+  if (it != table.atoms.cend()) {
+    return *it;
+  }
+
+  auto atom = static_cast<Atom>(table.names.size());
+  table.names.append(keyword.toString());
+  table.atoms.insert(key, atom);
+  return atom;
+}
+
+QString
+FlagSet::name(Atom atom)
+{
+  auto& table = _atom_table();
+
+  QMutexLocker guard{ &table.lock };
+  return table.names.value(atom);
+}
+
+std::optional<FlagSet::Flag>
+FlagSet::_flag(QStringView flag)
+{
+  if (!flag.startsWith('\\')) {
+    return std::nullopt;
+  }
+
+  for (const auto& item : FLAG_NAMES) {
+    if (flag.compare(QLatin1String{ item.name }, Qt::CaseInsensitive) == 0) {
+      return item.flag;
+    }
+  }
+
+  return std::nullopt;
+}
+
+std::optional<FlagSet::Atom>
+FlagSet::_find(QStringView keyword)
+{
+  auto& table = _atom_table();
+  auto key = keyword.toString().toCaseFolded();
+
+  QMutexLocker guard{ &table.lock };
+
+  auto it = table.atoms.constFind(key);
+  if (it == table.atoms.cend()) {
+    return std::nullopt;
+  }
+
+  return *it;
+}
+
+}
@@ -1,9 +1,15 @@
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
 #include <memory>
+#include <optional>
 #include <qanystringview.h>
 #include <qbytearray.h>
+#include <qdatetime.h>
 #include <qdebug.h>
+#include <qhash.h>
 #include <qlist.h>
 #include <qlogging.h>
 #include <qmap.h>
@@ -11,18 +17,35 @@
 #include <qmutex.h>
 #include <qpair.h>
 #include <qregularexpression.h>
+#include <qpointer.h>
 #include <qsslsocket.h>
 #include <qstring.h>
+#include <qstringlist.h>
+#include <qthread.h>
+#include <qthreadpool.h>
 #include <qtmetamacros.h>
 #include <qtypes.h>
 #include <qvariant.h>
 #include <utility>
+#include <variant>
+#include <vector>
 
 #include "temail/client/base.hpp"
+#include "temail/client/body.hpp"
+#include "temail/client/flags.hpp"
 #include "temail/client/imap.hpp"
 #include "temail/client/request.hpp"
+#include "temail/client/response.hpp"
+#include "temail/client/sequence.hpp"
 #include "temail/common.hpp"
+#include "temail/private/client/imap/append.hpp"
+#include "temail/private/client/imap/capability.hpp"
+#include "temail/private/client/imap/compress.hpp"
+#include "temail/private/client/imap/deflate.hpp"
+#include "temail/private/client/imap/enable.hpp"
 #include "temail/private/client/imap/fetch.hpp"
+#include "temail/private/client/imap/idle.hpp"
+#include "temail/private/client/imap/keyword.hpp"
 #include "temail/private/client/imap/list.hpp"
 #include "temail/private/client/imap/login.hpp"
 #include "temail/private/client/imap/logout.hpp"
@@ -30,10 +53,75 @@
 #include "temail/private/client/imap/response.hpp"
 #include "temail/private/client/imap/search.hpp"
 #include "temail/private/client/imap/select.hpp"
+#include "temail/private/client/imap/store.hpp"
+#include "temail/private/client/imap/submit.hpp"
 #include "temail/tag.hpp"
 
 namespace temail::client {
 
+namespace {
+
+/**
+ * @brief Get a context object living in current thread, used to post
+ * completions back to the submitting thread.
+ *
+ */
+QObject*
+_completion_context()
+{
+  thread_local auto context = std::make_unique<QObject>();
+  return context.get();
+}
+
+/**
+ * @brief Get fetched mails of a FETCH or UID FETCH result.
+ *
+ */
+response::Fetch*
+_fetch_items(response::Result& data)
+{
+  if (auto* fetch = std::get_if<response::Fetch>(&data)) {
+    return fetch;
+  }
+
+  if (auto* fetch = std::get_if<response::UidFetch>(&data)) {
+    return &fetch->items;
+  }
+
+  return nullptr;
+}
+
+/**
+ * @brief Move downloaded bodies into the mails they were fetched for.
+ *
+ */
+void
+_merge_texts(response::Result& data, response::Result& rest, bool uid)
+{
+  auto* items = _fetch_items(data);
+  auto* texts = _fetch_items(rest);
+  if (items == nullptr || texts == nullptr) {
+    return;
+  }
+
+  auto index = QHash<std::size_t, qsizetype>{};
+  index.reserve(items->size());
+  for (qsizetype i = 0; i < items->size(); ++i) {
+    index.insert(uid ? (*items)[i].uid : (*items)[i].id, i);
+  }
+
+  for (auto& text : *texts) {
+    auto it = index.constFind(uid ? text.uid : text.id);
+    if (it != index.cend()) {
+      auto& item = (*items)[*it];
+      item.text = std::move(text.text);
+      item.fields |= request::Fetch::TEXT;
+    }
+  }
+}
+
+}
+
 const QMap<IMAP::Command, IMAP::ResponseHandler> IMAP::RESPONSE_HANDLER{
   { IMAP::Command::LOGIN, detail::imap_handle_login },
   { IMAP::Command::LOGOUT, detail::imap_handle_logout },
@@ -42,13 +130,31 @@ const QMap<IMAP::Command, IMAP::ResponseHandler> IMAP::RESPONSE_HANDLER{
   { IMAP::Command::NOOP, detail::imap_handle_noop },
   { IMAP::Command::SEARCH, detail::imap_handle_search },
   { IMAP::Command::FETCH, detail::imap_handle_fetch },
+  { IMAP::Command::UID_FETCH, detail::imap_handle_uid_fetch },
+  { IMAP::Command::UID_SEARCH, detail::imap_handle_uid_search },
+  { IMAP::Command::UID_STORE, detail::imap_handle_uid_store },
+  { IMAP::Command::ENABLE, detail::imap_handle_enable },
+  { IMAP::Command::IDLE, detail::imap_handle_idle },
+  { IMAP::Command::COMPRESS, detail::imap_handle_compress },
+  { IMAP::Command::APPEND, detail::imap_handle_append },
+  { IMAP::Command::CAPABILITY, detail::imap_handle_capability },
 };
 
 IMAP::IMAP(QObject* parent)
   : Base{ parent }
+  , _submit{ std::make_unique<detail::IMAPSubmitQueue>() }
+  , _deflate{ std::make_unique<detail::IMAPDeflate>() }
 {
   connect(&_sock, &QSslSocket::connected, this, &IMAP::_on_connected);
   connect(&_sock, &QSslSocket::disconnected, this, &IMAP::_on_disconnected);
+  connect(&_sock, &QSslSocket::bytesWritten, this, &IMAP::_on_bytes_written);
+
+  _idle_timer.setSingleShot(true);
+  _idle_timer.setInterval(IDLE_RESTART_MSECS);
+  connect(&_idle_timer, &QTimer::timeout, this, [this] {
+    _leave_idle();
+    _flush_output();
+  });
 }
 
 IMAP::~IMAP()
@@ -65,9 +171,17 @@ IMAP::connect_to_host(const QString& url,
                       SslOption ssl,
                       const CommandCallback& callback)
 {
-  QMutexLocker request_guard{ &_request_lock };
+  if (QThread::currentThread() != thread()) {
+    QMetaObject::invokeMethod(
+      this,
+      [this, url, port, ssl, callback] {
+        connect_to_host(url, port, ssl, callback);
+      },
+      Qt::QueuedConnection);
+    return;
+  }
 
-  _add_handler(CONNECT_TAG, callback, _default_error_handler);
+  _add_handler(CONNECT_TAG, _boxed(callback), _default_error_handler);
 
   if (is_connected()) {
     _tag_error(CONNECT_TAG, E_DUPLICATE, "Connection has established");
@@ -93,9 +207,15 @@ IMAP::connect_to_host(const QString& url,
 void
 IMAP::disconnect_from_host(const CommandCallback& callback)
 {
-  QMutexLocker request_guard{ &_request_lock };
+  if (QThread::currentThread() != thread()) {
+    QMetaObject::invokeMethod(
+      this,
+      [this, callback] { disconnect_from_host(callback); },
+      Qt::QueuedConnection);
+    return;
+  }
 
-  _add_handler(DISCONNECT_TAG, callback, _default_error_handler);
+  _add_handler(DISCONNECT_TAG, _boxed(callback), _default_error_handler);
 
   if (is_disconnected()) {
     _tag_error(DISCONNECT_TAG, E_DUPLICATE, "Connection has not established");
@@ -110,15 +230,13 @@ IMAP::disconnect_from_host(const CommandCallback& callback)
 void
 IMAP::login(const QString& username,
             const QString& password,
-            const CommandCallback& callback)
+            const ResultCallback& callback)
 {
-  _request(Command::LOGIN,
-           QString{ "LOGIN %1 %2" }.arg(username).arg(password),
-           callback);
+  _request(Command::LOGIN, _login_command(username, password), callback);
 }
 
 void
-IMAP::logout(const CommandCallback& callback)
+IMAP::logout(const ResultCallback& callback)
 {
   _request(Command::LOGOUT, "LOGOUT", callback);
 }
@@ -126,65 +244,204 @@ IMAP::logout(const CommandCallback& callback)
 void
 IMAP::list(const QString& path,
            const QString& pattern,
-           const CommandCallback& callback)
+           const ResultCallback& callback)
 {
-  _request(
-    Command::LIST, QString{ "LIST %2 %3" }.arg(path).arg(pattern), callback);
+  _request(Command::LIST, _list_command(path, pattern), callback);
 }
 
 void
-IMAP::select(const QString& path, const CommandCallback& callback)
+IMAP::select(const QString& path, const ResultCallback& callback)
 {
-  _request(Command::SELECT, QString{ "SELECT %2" }.arg(path), callback);
+  _request(Command::SELECT, _select_command(path), callback);
 }
 
 void
-IMAP::noop(const CommandCallback& callback)
+IMAP::noop(const ResultCallback& callback)
 {
   _request(Command::NOOP, "NOOP", callback);
 }
 
 void
-IMAP::search(request::Search::Criteria criteria,
-             const CommandCallback& callback)
+IMAP::search(const request::SearchQuery& query,
+             const ResultCallback& callback)
 {
-  _request(Command::SEARCH,
-           QString{ "SEARCH %1" }.arg(common::enum_name(criteria)),
-           callback);
+  _request(Command::SEARCH, _search_command(query), callback);
+}
+
+void
+IMAP::search(const request::SearchQuery& query,
+             request::SearchReturn::Options options,
+             request::SearchPartial partial,
+             const ResultCallback& callback)
+{
+  _request(
+    Command::SEARCH, _esearch_command(query, options, partial), callback);
 }
 
 void
 IMAP::fetch(std::size_t id,
             request::Fetch::FieldFlags field,
             std::size_t range,
-            const CommandCallback& callback)
+            const ResultCallback& callback)
 {
-  auto cmd_range = range <= 1 ? QString::number(id)
-                              : QString{ "%1:%2" }.arg(id).arg(id + range - 1);
+  fetch(_id_set(id, range), field, callback);
+}
 
-  auto cmd_fields = QString{};
-  if (field.testFlag(request::Fetch::ENVELOPE)) {
-    cmd_fields.append(FETCH_FIELD[request::Fetch::ENVELOPE]);
-    cmd_fields.append(' ');
+void
+IMAP::fetch(const SequenceSet& ids,
+            request::Fetch::FieldFlags field,
+            const ResultCallback& callback)
+{
+  if (field.testFlag(request::Fetch::TEXT) && callback &&
+      body_store() != nullptr) {
+    _fetch_bodies(Command::FETCH, ids, field, callback);
+    return;
   }
 
-  if (field.testFlag(request::Fetch::MIME)) {
-    cmd_fields.append(FETCH_FIELD[request::Fetch::MIME]);
-    cmd_fields.append(' ');
+  _fetch_request(Command::FETCH, ids, field, callback);
+}
+
+void
+IMAP::fetch_stream(std::size_t id,
+                   request::Fetch::FieldFlags field,
+                   const FetchSink& sink,
+                   std::size_t range,
+                   const ResultCallback& callback)
+{
+  _request(Command::FETCH,
+           _fetch_command(_id_set(id, range), field),
+           callback,
+           sink);
+}
+
+void
+IMAP::uid_fetch(std::size_t uid,
+                request::Fetch::FieldFlags field,
+                std::size_t range,
+                const ResultCallback& callback)
+{
+  uid_fetch(_range_set(uid, range), field, callback);
+}
+
+void
+IMAP::uid_fetch(const SequenceSet& uids,
+                request::Fetch::FieldFlags field,
+                const ResultCallback& callback)
+{
+  if (field.testFlag(request::Fetch::TEXT) && callback &&
+      body_store() != nullptr) {
+    _fetch_bodies(Command::UID_FETCH, uids, field, callback);
+    return;
   }
 
-  if (field.testFlag(request::Fetch::TEXT)) {
-    cmd_fields.append(FETCH_FIELD[request::Fetch::TEXT]);
-    cmd_fields.append(' ');
+  _fetch_request(Command::UID_FETCH, uids, field, callback);
+}
+
+void
+IMAP::uid_fetch_envelopes(const SequenceSet& uids,
+                          const ResultCallback& callback)
+{
+  auto field = request::Fetch::FieldFlags{ request::Fetch::ENVELOPE } |
+               request::Fetch::SIZE | request::Fetch::FLAGS;
+
+  // a plain UID FETCH, its parser fills the columns instead of `raw`.
+  _request(Command::UID_FETCH,
+           QString{ "UID %1" }.arg(_fetch_command(uids, field)),
+           callback,
+           {},
+           _default_error_handler,
+           {},
+           true);
+}
+
+void
+IMAP::uid_search(const request::SearchQuery& query,
+                 const ResultCallback& callback)
+{
+  _request(Command::UID_SEARCH,
+           QString{ "UID %1" }.arg(_search_command(query)),
+           callback);
+}
+
+void
+IMAP::uid_search(const request::SearchQuery& query,
+                 request::SearchReturn::Options options,
+                 request::SearchPartial partial,
+                 const ResultCallback& callback)
+{
+  _request(Command::UID_SEARCH,
+           QString{ "UID %1" }.arg(
+             _esearch_command(query, options, partial)),
+           callback);
+}
+
+void
+IMAP::uid_store(std::size_t uid,
+                std::size_t range,
+                request::Store::Action action,
+                const FlagSet& flags,
+                const ResultCallback& callback)
+{
+  uid_store(_range_set(uid, range), action, flags, callback);
+}
+
+void
+IMAP::uid_store(const SequenceSet& uids,
+                request::Store::Action action,
+                const FlagSet& flags,
+                const ResultCallback& callback)
+{
+  _request(Command::UID_STORE, _store_command(uids, action, flags), callback);
+}
+
+void
+IMAP::select_qresync(const QString& path,
+                     std::size_t uidvalidity,
+                     std::size_t modseq,
+                     std::size_t last_uid,
+                     const ResultCallback& callback)
+{
+  _enable_qresync();
+
+  // QRESYNC needs both values, a never synced folder is selected with
+  // CONDSTORE so HIGHESTMODSEQ is still reported.
+  if (uidvalidity == 0 || modseq == 0) {
+    _request(Command::SELECT,
+             QString{ "%1 (CONDSTORE)" }.arg(_select_command(path)),
+             callback);
+    return;
   }
 
-  _request(Command::FETCH,
-           QString{ "FETCH %1 (%2)" }.arg(cmd_range).arg(cmd_fields),
+  auto known = last_uid == 0 ? QString{} : QString{ " 1:%1" }.arg(last_uid);
+  _request(Command::SELECT,
+           QString{ "%1 (QRESYNC (%2 %3%4))" }
+             .arg(_select_command(path))
+             .arg(uidvalidity)
+             .arg(modseq)
+             .arg(known),
            callback);
 }
 
-QVariant
-IMAP::read()
+void
+IMAP::uid_fetch_changed(std::size_t uid,
+                        request::Fetch::FieldFlags field,
+                        std::size_t range,
+                        std::size_t modseq,
+                        const ResultCallback& callback)
+{
+  _enable_qresync();
+
+  auto cmd =
+    _fetch_command(_range_set(uid, range), field | request::Fetch::FLAGS);
+
+  _request(
+    Command::UID_FETCH,
+    QString{ "UID %1 (CHANGEDSINCE %2 VANISHED)" }.arg(cmd).arg(modseq),
+    callback);
+}
+
+response::Result
+IMAP::read_result()
 {
   QMutexLocker guard{ &_read_lock };
 
@@ -193,7 +450,7 @@ IMAP::read()
     return {};
   }
 
-  auto data = _queue.front();
+  auto data = std::move(_queue.front());
   _queue.pop();
 
   return data;
@@ -202,78 +459,602 @@ IMAP::read()
 void
 IMAP::_request(Command type,
                QAnyStringView cmd,
-               const CommandCallback& callback)
+               const ResultCallback& callback,
+               const FetchSink& sink,
+               const ErrorCallback& error,
+               const QList<request::AppendMessage>& messages,
+               bool envelopes)
 {
-  QMutexLocker request_guard{ &_request_lock };
+  auto remote = QThread::currentThread() != thread();
+
+  _submit->push({ type,
+                  cmd.toString().toUtf8(),
+                  callback,
+                  error,
+                  sink,
+                  remote ? _completion_context() : nullptr,
+                  remote,
+                  messages,
+                  envelopes });
+
+  if (!_drain_pending.exchange(true, std::memory_order_acq_rel)) {
+    QMetaObject::invokeMethod(
+      this, &IMAP::_drain_submissions, Qt::QueuedConnection);
+  }
+}
 
-  auto tag = _tags.generate();
-  _add_handler(tag, callback, _default_error_handler);
+void
+IMAP::append(const QString& path,
+             const QList<request::AppendMessage>& messages,
+             const ResultCallback& callback)
+{
+  _request(Command::APPEND,
+           QString{ "APPEND %1" }.arg(path),
+           callback,
+           {},
+           _default_error_handler,
+           messages);
+}
 
-  if (_status == Status::DISCONNECT) {
-    _tag_error(tag, E_NOTCONNECTED, "Connection has not established");
+void
+IMAP::begin_batch()
+{
+  _batch.fetch_add(1, std::memory_order_acq_rel);
+}
+
+void
+IMAP::end_batch()
+{
+  auto batch = _batch.load(std::memory_order_acquire);
+  do {
+    if (batch == 0) {
+      qWarning() << "IMAP4 Client: end_batch without begin_batch.";
+      return;
+    }
+  } while (!_batch.compare_exchange_weak(
+    batch, batch - 1, std::memory_order_acq_rel));
+
+  if (batch != 1) {
     return;
   }
 
-  QMutexLocker guard{ &_resp_lock };
-  _resp.emplace_back(type, detail::IMAPResponse{ tag });
-  guard.unlock();
+  if (QThread::currentThread() == thread()) {
+    _drain_submissions();
+  } else {
+    QMetaObject::invokeMethod(
+      this, &IMAP::_drain_submissions, Qt::QueuedConnection);
+  }
+}
+
+void
+IMAP::idle(bool enable)
+{
+  if (QThread::currentThread() != thread()) {
+    QMetaObject::invokeMethod(
+      this, [this, enable] { idle(enable); }, Qt::QueuedConnection);
+    return;
+  }
 
-  _sock.write(QString{ "%1 %2\r\n" }.arg(tag).arg(cmd).toLocal8Bit());
-  if (!_sock.flush()) {
-    // there must be one response.
-    guard.relock();
-    _resp.pop_back();
+  _idle.store(enable, std::memory_order_release);
 
-    _tag_error(tag, E_INTERNAL, _sock.errorString());
+  if (enable) {
+    _enter_idle();
+  } else {
+    _leave_idle();
+    _flush_output();
   }
 }
 
+bool
+IMAP::is_compressed() const
+{
+  return _deflate->active();
+}
+
+IMAP::Traffic
+IMAP::traffic() const
+{
+  return Traffic{
+    _wire_in.load(std::memory_order_relaxed),
+    _data_in.load(std::memory_order_relaxed),
+    _wire_out.load(std::memory_order_relaxed),
+    _data_out.load(std::memory_order_relaxed),
+  };
+}
+
 void
-IMAP::_tag_error(const QString& tag, ErrorType error, const QString& estr)
+IMAP::_drain_submissions()
 {
-  _handle_error(tag, error, estr);
-  _set_error(error, estr);
+  // must be an RMW, so pushes seen by producers as pending are visible here.
+  _drain_pending.exchange(false, std::memory_order_acq_rel);
+
+  auto sub = detail::IMAPSubmission{};
+  while (_submit->pop(sub)) {
+    auto tag = _tags.generate();
+
+    auto success = std::move(sub.callback);
+    auto error = std::move(sub.error);
+
+    if (sub.remote) {
+      if (success) {
+        success = [context = sub.context, callback = std::move(success)](
+                    response::Result&& data) {
+          if (context.isNull()) {
+            return;
+          }
+          QMetaObject::invokeMethod(
+            context.data(),
+            [callback, data = std::move(data)]() mutable {
+              callback(std::move(data));
+            },
+            Qt::QueuedConnection);
+        };
+      }
+
+      error = [context = sub.context, callback = std::move(error)](
+                ErrorType error, const QString& estr) {
+        if (context.isNull()) {
+          return;
+        }
+        QMetaObject::invokeMethod(
+          context.data(),
+          [callback, error, estr] { callback(error, estr); },
+          Qt::QueuedConnection);
+      };
+    }
+
+    _add_handler(tag, success, error);
+
+    if (_status == Status::DISCONNECT) {
+      _tag_error(tag, E_NOTCONNECTED, "Connection has not established");
+      continue;
+    }
+
+    // only search strings add line breaks, as `{n+}` literals.
+    if (sub.type != Command::APPEND && sub.cmd.contains("\r\n") &&
+        (_caps & CAP_LITERAL_PLUS) == 0 &&
+        ((_caps & CAP_LITERAL_MINUS) == 0 ||
+         sub.cmd.size() > LITERAL_MINUS_MAX)) {
+      _tag_error(
+        tag, E_BADCOMMAND, "Server does not accept non-synchronizing literals");
+      continue;
+    }
+
+    _leave_idle();
+
+    if (sub.type == Command::APPEND) {
+      _queue_append(tag, sub.cmd, std::move(sub.messages), success, error);
+      continue;
+    }
+
+    _resp.emplace_back(sub.type,
+                       detail::IMAPResponse{ _tags.prefix(),
+                                             tag,
+                                             std::move(sub.sink),
+                                             sub.envelopes });
+
+    TagGenerator::write(_out, _tags.prefix(), tag);
+    _out.append(' ');
+    _out.append(sub.cmd);
+    _out.append("\r\n");
+    _out_tags.append(tag);
+  }
+
+  _flush_output();
+  _enter_idle();
 }
 
 void
-IMAP::_handle_success(const QString& tag, const QVariant& data)
+IMAP::_flush_output()
 {
-  CommandCallback cb;
-  QMutexLocker guard{ &_cb_lock };
+  // IDLE, COMPRESS, timers and uploads write here too, so a batch holds
+  // every write until `end_batch` drains and flushes.
+  if (_batch.load(std::memory_order_acquire) != 0) {
+    return;
+  }
+
+  // commands queued behind uploads are written once they are streamed.
+  if (!_uploads.empty()) {
+    _pump_uploads();
+    return;
+  }
 
-  if (!_resp_cb.contains(tag)) {
+  // commands are held until DONE can end the running IDLE, or until the
+  // server has switched to compression.
+  if (_out.isEmpty() || _idle_done || _compress_pending) {
     return;
   }
-  cb = _resp_cb[tag].first;
-  _resp_cb.remove(tag);
-  guard.unlock();
 
-  cb(data);
+  auto tags = std::move(_out_tags);
+  _out_tags.clear();
+
+  _sock.write(_encode_output(_out));
+  _out.clear();
+
+  if (_deflate->error() || !_sock.flush()) {
+    // commands in this flush are the latest ones, none of them is answered.
+    for (qsizetype i = 0; i < tags.size() && !_resp.empty(); ++i) {
+      _resp.pop_back();
+    }
+
+    for (const auto& tag : tags) {
+      _tag_error(tag, E_INTERNAL, _sock.errorString());
+    }
+  }
+}
+
+QString
+IMAP::_login_command(const QString& username, const QString& password)
+{
+  return QString{ "LOGIN %1 %2" }.arg(username).arg(password);
+}
+
+QString
+IMAP::_list_command(const QString& path, const QString& pattern)
+{
+  return QString{ "LIST %2 %3" }.arg(path).arg(pattern);
+}
+
+QString
+IMAP::_select_command(const QString& path)
+{
+  return QString{ "SELECT %2" }.arg(path);
+}
+
+QString
+IMAP::_search_command(const request::SearchQuery& query)
+{
+  auto cmd = QString{ query.utf8() ? "SEARCH CHARSET UTF-8 " : "SEARCH " };
+  query.write(cmd);
+  return cmd;
+}
+
+QString
+IMAP::_esearch_command(const request::SearchQuery& query,
+                       request::SearchReturn::Options options,
+                       request::SearchPartial partial)
+{
+  auto ret = QStringList{};
+  if (options.testFlag(request::SearchReturn::MIN)) {
+    ret.append("MIN");
+  }
+
+  if (options.testFlag(request::SearchReturn::MAX)) {
+    ret.append("MAX");
+  }
+
+  if (options.testFlag(request::SearchReturn::COUNT)) {
+    ret.append("COUNT");
+  }
+
+  // PARTIAL and ALL must not be combined (RFC 9394).
+  if (!partial.empty()) {
+    ret.append(QString{ "PARTIAL %1:%2" }.arg(partial.first).arg(partial.last));
+  } else if (options.testFlag(request::SearchReturn::ALL)) {
+    ret.append("ALL");
+  }
+
+  auto cmd = QString{ "SEARCH RETURN (%1) " }.arg(ret.join(' '));
+  if (query.utf8()) {
+    cmd.append("CHARSET UTF-8 ");
+  }
+  query.write(cmd);
+  return cmd;
 }
 
 void
-IMAP::_handle_error(const QString& tag, ErrorType error, const QString& estr)
+IMAP::_enable_qresync()
+{
+  if (_qresync.exchange(true, std::memory_order_acq_rel)) {
+    return;
+  }
+
+  // result is internal, keep it out of the `read` queue.
+  _request(Command::ENABLE, "ENABLE QRESYNC", [](response::Result&&) {});
+}
+
+SequenceSet
+IMAP::_range_set(std::size_t id, std::size_t range)
+{
+  // ids past 32 bits do not exist, clamp them to `*`.
+  auto first = std::min<std::size_t>(id, SequenceSet::LAST);
+  auto last = range == 0 ? SequenceSet::LAST
+                         : std::min<std::size_t>(id + range - 1,
+                                                 SequenceSet::LAST);
+
+  return { static_cast<SequenceSet::Id>(first),
+           static_cast<SequenceSet::Id>(last) };
+}
+
+SequenceSet
+IMAP::_id_set(std::size_t id, std::size_t range)
 {
-  ErrorCallback cb;
-  QMutexLocker guard{ &_cb_lock };
+  // sequence number ranges keep the single mail default for 0.
+  return _range_set(id, std::max<std::size_t>(range, 1));
+}
 
-  if (!_resp_cb.contains(tag)) {
+QString
+IMAP::_flags_command(const FlagSet& flags)
+{
+  // `\Recent` is server-managed, STORE and APPEND must not carry it.
+  constexpr auto STORE_FLAGS =
+    FlagSet::SYSTEM_FLAGS & ~FlagSet::Flags{ FlagSet::RECENT };
+
+  auto cmd_flags = FlagSet{ flags.flags() & STORE_FLAGS }.to_list();
+  cmd_flags.reserve(cmd_flags.size() + flags.keywords().size());
+  for (auto atom : flags.keywords()) {
+    cmd_flags.append(FlagSet::name(atom));
+  }
+
+  return cmd_flags.join(' ');
+}
+
+QString
+IMAP::_date_command(const QDateTime& date)
+{
+  auto offset = date.offsetFromUtc() / 60;
+  auto zone = std::abs(offset);
+
+  return QString{ "\"%1 %2%3%4\"" }
+    .arg(date.toString("dd-MMM-yyyy hh:mm:ss"))
+    .arg(offset < 0 ? '-' : '+')
+    .arg(zone / 60, 2, 10, QChar{ '0' })
+    .arg(zone % 60, 2, 10, QChar{ '0' });
+}
+
+QString
+IMAP::_store_command(const SequenceSet& uids,
+                     request::Store::Action action,
+                     const FlagSet& flags)
+{
+  return QString{ "UID STORE %1 %2FLAGS (%3)" }
+    .arg(uids.to_string())
+    .arg(STORE_ACTION[action])
+    .arg(_flags_command(flags));
+}
+
+QString
+IMAP::_fetch_command(const SequenceSet& ids,
+                     request::Fetch::FieldFlags field)
+{
+  auto cmd_range = ids.to_string();
+
+  auto cmd_fields = QString{};
+  if (field.testFlag(request::Fetch::ENVELOPE)) {
+    cmd_fields.append(FETCH_FIELD[request::Fetch::ENVELOPE]);
+    cmd_fields.append(' ');
+  }
+
+  if (field.testFlag(request::Fetch::MIME)) {
+    cmd_fields.append(FETCH_FIELD[request::Fetch::MIME]);
+    cmd_fields.append(' ');
+  }
+
+  if (field.testFlag(request::Fetch::TEXT)) {
+    cmd_fields.append(FETCH_FIELD[request::Fetch::TEXT]);
+    cmd_fields.append(' ');
+  }
+
+  if (field.testFlag(request::Fetch::SIZE)) {
+    cmd_fields.append(FETCH_FIELD[request::Fetch::SIZE]);
+    cmd_fields.append(' ');
+  }
+
+  if (field.testFlag(request::Fetch::FLAGS)) {
+    cmd_fields.append(FETCH_FIELD[request::Fetch::FLAGS]);
+    cmd_fields.append(' ');
+  }
+
+  if (field.testFlag(request::Fetch::EMAILID)) {
+    cmd_fields.append(FETCH_FIELD[request::Fetch::EMAILID]);
+    cmd_fields.append(' ');
+  }
+
+  cmd_fields.chop(1);
+  return QString{ "FETCH %1 (%2)" }.arg(cmd_range).arg(cmd_fields);
+}
+
+void
+IMAP::_fetch_request(Command type,
+                     const SequenceSet& ids,
+                     request::Fetch::FieldFlags field,
+                     const ResultCallback& callback)
+{
+  // EMAILID lets later fetches find the stored body.
+  if (field.testFlag(request::Fetch::TEXT) && (_caps & CAP_OBJECTID) != 0 &&
+      body_store() != nullptr) {
+    field |= request::Fetch::EMAILID;
+  }
+
+  auto cmd = _fetch_command(ids, field);
+  if (type == Command::UID_FETCH) {
+    cmd.prepend("UID ");
+  }
+
+  _request(type, cmd, callback);
+}
+
+void
+IMAP::_fetch_bodies(Command type,
+                    const SequenceSet& ids,
+                    request::Fetch::FieldFlags field,
+                    const ResultCallback& callback)
+{
+  // without OBJECTID, a body is only known once downloaded.
+  auto bodies = body_store();
+  if (bodies == nullptr || (_caps & CAP_OBJECTID) == 0) {
+    _fetch_request(type, ids, field, callback);
     return;
   }
-  cb = _resp_cb[tag].second;
-  _resp_cb.remove(tag);
-  guard.unlock();
+
+  auto head = field;
+  head.setFlag(request::Fetch::TEXT, false);
+  head |= request::Fetch::EMAILID;
+
+  auto uid = type == Command::UID_FETCH;
+
+  // runs in the completion thread, so it only touches thread safe members.
+  _fetch_request(
+    type,
+    ids,
+    head,
+    [client = QPointer<IMAP>{ this }, type, bodies, uid, callback](
+      response::Result&& data) {
+      auto* items = _fetch_items(data);
+      if (items == nullptr) {
+        callback(std::move(data));
+        return;
+      }
+
+      auto missing = SequenceSet{};
+      for (auto& item : *items) {
+        auto body = item.emailid.isEmpty() ? std::nullopt
+                                           : bodies->find(item.emailid);
+        if (body.has_value()) {
+          item.text = std::move(*body);
+          item.fields |= request::Fetch::TEXT;
+        } else {
+          auto id = uid ? item.uid : item.id;
+          missing.insert(static_cast<SequenceSet::Id>(id));
+        }
+      }
+
+      if (missing.empty() || client.isNull()) {
+        callback(std::move(data));
+        return;
+      }
+
+      // downloaded bodies are written into the store by the response handler.
+      auto cmd = _fetch_command(
+        missing, request::Fetch::TEXT | request::Fetch::EMAILID);
+      if (uid) {
+        cmd.prepend("UID ");
+      }
+
+      client->_request(type,
+                       cmd,
+                       [uid, callback, data = std::move(data)](
+                         response::Result&& rest) mutable {
+                         _merge_texts(data, rest, uid);
+                         callback(std::move(data));
+                       });
+    });
+}
+
+void
+IMAP::_store_bodies(const response::Fetch& items) const
+{
+  auto store = body_store();
+  if (store == nullptr) {
+    return;
+  }
+
+  auto bodies = QList<QPair<QByteArray, QString>>{};
+  for (const auto& item : items) {
+    if (item.fields.testFlag(request::Fetch::TEXT) && !item.text.isEmpty()) {
+      bodies.append({ item.text, item.emailid });
+    }
+  }
+
+  if (bodies.isEmpty()) {
+    return;
+  }
+
+  // hashing and compressing would stall the socket thread.
+  QThreadPool::globalInstance()->start(
+    [store = std::move(store), bodies = std::move(bodies)] {
+      for (const auto& [body, emailid] : bodies) {
+        store->put(body, emailid);
+      }
+    });
+}
+
+void
+IMAP::_tag_error(TagGenerator::Tag tag, ErrorType error, const QString& estr)
+{
+  if (_handle_error(tag, error, estr)) {
+    _set_error(error, estr);
+  }
+}
+
+bool
+IMAP::_handle_success(TagGenerator::Tag tag, response::Result&& data)
+{
+  auto& slot = _slot_of(tag);
+  if (!slot.used || slot.tag != tag) {
+    return false;
+  }
+  auto cb = std::move(slot.success);
+  slot = TagSlot{};
+
+  // results are moved to exactly one consumer, the callback or `read`.
+  if (!cb) {
+    QMutexLocker guard{ &_read_lock };
+    _queue.push(std::move(data));
+    return true;
+  }
+
+  cb(std::move(data));
+  return false;
+}
+
+bool
+IMAP::_handle_error(TagGenerator::Tag tag,
+                    ErrorType error,
+                    const QString& estr)
+{
+  auto& slot = _slot_of(tag);
+  if (!slot.used || slot.tag != tag) {
+    return false;
+  }
+  auto cb = std::move(slot.error);
+  slot = TagSlot{};
 
   cb(error, estr);
+  return true;
 }
 
 void
-IMAP::_add_handler(const QString& tag,
-                   const CommandCallback& success,
+IMAP::_add_handler(TagGenerator::Tag tag,
+                   const ResultCallback& success,
                    const ErrorCallback& error)
 {
-  QMutexLocker guard{ &_cb_lock };
-  _resp_cb.insert(tag, { success, error });
+  // tags grow monotonically, a busy slot means too many commands in flight.
+  while (true) {
+    auto& slot = _slot_of(tag);
+    if (!slot.used || slot.tag == tag) {
+      slot = TagSlot{ tag, success, error, true };
+      return;
+    }
+    _grow_slots();
+  }
+}
+
+IMAP::TagSlot&
+IMAP::_slot_of(TagGenerator::Tag tag)
+{
+  if (tag == CONNECT_TAG) {
+    return _conn_cb[0];
+  }
+
+  if (tag == DISCONNECT_TAG) {
+    return _conn_cb[1];
+  }
+
+  return _resp_cb[tag & (_resp_cb.size() - 1)];
+}
+
+void
+IMAP::_grow_slots()
+{
+  // distinct slots modulo n stay distinct modulo 2n.
+  auto slots = std::vector<TagSlot>(_resp_cb.size() * 2);
+  for (auto& slot : _resp_cb) {
+    if (slot.used) {
+      slots[slot.tag & (slots.size() - 1)] = std::move(slot);
+    }
+  }
+  _resp_cb = std::move(slots);
 }
 
 void
@@ -285,9 +1066,12 @@ IMAP::_on_connected()
   }
 
   // * assume that connect message must be sent at once.
-  auto resp = detail::IMAPResponse{ CONNECT_TAG };
+  auto resp = detail::IMAPResponse{ _tags.prefix(), CONNECT_TAG };
+  auto greeting = _sock.readAll();
+  _wire_in.fetch_add(greeting.size(), std::memory_order_relaxed);
+  _data_in.fetch_add(greeting.size(), std::memory_order_relaxed);
 
-  if (!resp.digest(_sock.readAll()) || resp.untagged().size() != 1) {
+  if (!resp.digest(greeting) || resp.untagged().size() != 1) {
     _tag_error(CONNECT_TAG, E_UNEXPECTED, "Unexpected tagged response");
     return;
   }
@@ -301,6 +1085,9 @@ IMAP::_on_connected()
     return;
   }
 
+  // the greeting may carry a CAPABILITY code, its text is not parsed.
+  _caps = _parse_capabilities(resp.untagged()[0].second, true);
+
   connect(&_sock, &QSslSocket::readyRead, this, &IMAP::_on_ready_read);
   connect(&_sock, &QSslSocket::errorOccurred, this, &IMAP::_on_error_occurred);
 
@@ -317,9 +1104,25 @@ IMAP::_on_disconnected()
     &_sock, &QSslSocket::errorOccurred, this, &IMAP::_on_error_occurred);
   disconnect(&_sock, &QSslSocket::readyRead, this, &IMAP::_on_ready_read);
   _status = Status::DISCONNECT;
+  _uidvalidity = 0;
+  _qresync.store(false, std::memory_order_release);
+  _idling = false;
+  _idle_done = false;
+  _idle_timer.stop();
+  _deflate->reset();
+  _compress_pending = false;
+  _caps = 0;
+  _uploads.clear();
 
   qInfo() << "IMAP4 Client: Disconnected.";
 
+  // nobody will answer the rest, do not leave callers (or awaiters) hanging.
+  while (!_resp.empty()) {
+    auto tag = _resp.front().second.tag();
+    _resp.pop_front();
+    _handle_error(tag, E_INTERNAL, "Connection closed");
+  }
+
   _handle_success(DISCONNECT_TAG, {});
   emit disconnected();
 }
@@ -327,14 +1130,15 @@ IMAP::_on_disconnected()
 void
 IMAP::_on_error_occurred(QSslSocket::SocketError /*error*/)
 {
-  QMutexLocker guard{ &_resp_lock };
   if (_resp.empty()) {
     _set_error(E_INTERNAL, _sock.errorString());
     return;
   }
 
-  const auto& tag = _resp.front().second.tag();
-  _tag_error(tag, E_INTERNAL, _sock.errorString());
+  // socket errors are reported even if the command has no handler.
+  auto tag = _resp.front().second.tag();
+  _handle_error(tag, E_INTERNAL, _sock.errorString());
+  _set_error(E_INTERNAL, _sock.errorString());
 
   _resp.pop_front();
 }
@@ -344,25 +1148,542 @@ IMAP::_on_ready_read()
 {
   // read all response immediately.
   auto data = _sock.readAll();
+  _wire_in.fetch_add(data.size(), std::memory_order_relaxed);
+
+  if (!_inflate(data)) {
+    return;
+  }
 
-  // get first parser (there must be at least one response)
-  QMutexLocker guard{ &_resp_lock };
+  // several pipelined completions may arrive in one read, bytes left by one
+  // response are carried over to the next pending one.
+  while (!data.isEmpty()) {
+    // get first parser (there must be at least one response)
+    if (_resp.empty()) {
+      qWarning() << "IMAP4 Client: Unhandled response: " << data;
+      return;
+    }
+
+    auto& front = _resp.front();
+
+    auto continuations = front.second.continuations();
+    auto state = front.second.digest(data);
+    auto error = front.second.error();
+
+    // synchronizing APPEND literals may continue now.
+    if (front.first == Command::APPEND &&
+        front.second.continuations() != continuations) {
+      QMetaObject::invokeMethod(
+        this, [this] { _flush_output(); }, Qt::QueuedConnection);
+    }
+
+    if (front.first == Command::IDLE && !error) {
+      _handle_idle(front.second);
+
+      // signal receivers may have closed the connection.
+      if (_resp.empty()) {
+        return;
+      }
+    }
+
+    // Not a complete response.
+    if (!state && !error) {
+      return;
+    }
+
+    auto resp = std::move(front);
+    _resp.pop_front();
+
+    // stream can not be resynchronized after a parse error.
+    data = error ? QByteArray{} : resp.second.remaining();
+
+    _handle_response(resp);
+
+    // bytes after the COMPRESS completion are already compressed.
+    if (resp.first == Command::COMPRESS && _deflate->active()) {
+      _data_in.fetch_sub(data.size(), std::memory_order_relaxed);
+      if (!_inflate(data)) {
+        return;
+      }
+    }
+
+    if (_resp.empty()) {
+      _enter_idle();
+    }
+  }
+}
+
+void
+IMAP::_enter_idle()
+{
+  if (!_idle.load(std::memory_order_acquire) || _idling ||
+      _status != Status::AUTHENTICATE || !_resp.empty() ||
+      _batch.load(std::memory_order_acquire) != 0 ||
+      _drain_pending.load(std::memory_order_acquire)) {
+    return;
+  }
+
+  auto tag = _tags.generate();
+  _add_handler(
+    tag,
+    [](response::Result&& /*data*/) {},
+    [this](ErrorType error, const QString& estr) {
+      // IDLE mode survives reconnection.
+      if (error == E_INTERNAL) {
+        return;
+      }
+      qWarning() << "IMAP4 Client: IDLE rejected, leave IDLE mode:" << estr;
+      _idle.store(false, std::memory_order_release);
+    });
+
+  _resp.emplace_back(Command::IDLE,
+                     detail::IMAPResponse{ _tags.prefix(), tag });
+
+  TagGenerator::write(_out, _tags.prefix(), tag);
+  _out.append(" IDLE\r\n");
+  _out_tags.append(tag);
+
+  _idling = true;
+  _idle_timer.start();
+  _flush_output();
+}
+
+void
+IMAP::_leave_idle()
+{
+  if (!_idling) {
+    return;
+  }
+
+  _idling = false;
+  _idle_timer.stop();
+
+  // IDLE was dropped by a failed flush.
   if (_resp.empty()) {
-    qWarning() << "IMAP4 Client: Unhandled response: " << data;
     return;
   }
 
-  auto& resp = _resp.front();
+  // DONE is only valid once the server has accepted IDLE.
+  if (_resp.front().second.continued()) {
+    _out.prepend("DONE\r\n");
+  } else {
+    _idle_done = true;
+  }
+}
+
+void
+IMAP::_handle_idle(detail::IMAPResponse& resp)
+{
+  if (_idle_done && resp.continued()) {
+    _idle_done = false;
 
-  auto state = resp.second.digest(data);
-  auto error = resp.second.error();
+    // DONE goes ahead of everything queued meanwhile.
+    auto& head = _uploads.empty() ? _out : _uploads.front().before;
+    head.prepend("DONE\r\n");
+    _flush_output();
+  }
 
-  // Not a complete response.
-  if (!state && !error) {
+  // wait for complete lines, FETCH data may still be half parsed.
+  if (!resp.at_line_start()) {
     return;
   }
 
-  if (state && !error) {
+  auto trailing = resp.untagged_trailing();
+  auto fetch = detail::imap_parse_fetch(resp);
+  resp.clear_untagged();
+
+  for (const auto& item : trailing) {
+    if (item.first == Response::EXISTS) {
+      emit idle_exists(item.second.toULongLong());
+    } else if (item.first == Response::EXPUNGE) {
+      emit idle_expunge(item.second.toULongLong());
+    }
+  }
+
+  for (const auto& item : fetch) {
+    emit idle_fetch(item);
+  }
+}
+
+void
+IMAP::_request_capabilities()
+{
+  auto tag = _tags.generate();
+  _add_handler(
+    tag,
+    [this](response::Result&& /*data*/) { _start_compress(); },
+    [](ErrorType error, const QString& estr) {
+      if (error != E_INTERNAL) {
+        qWarning() << "IMAP4 Client: CAPABILITY rejected:" << estr;
+      }
+    });
+
+  _resp.emplace_back(Command::CAPABILITY,
+                     detail::IMAPResponse{ _tags.prefix(), tag });
+
+  TagGenerator::write(_out, _tags.prefix(), tag);
+  _out.append(" CAPABILITY\r\n");
+  _out_tags.append(tag);
+
+  _flush_output();
+}
+
+void
+IMAP::_start_compress()
+{
+  // uploads queued right after LOGIN would have to be split around the
+  // switch, skip compression for this session instead.
+  if ((_caps & CAP_COMPRESS) == 0 || _deflate->active() || _compress_pending ||
+      !_uploads.empty() || !_compress.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  auto tag = _tags.generate();
+  _add_handler(
+    tag,
+    [this](response::Result&& /*data*/) {
+      _compress_pending = false;
+      if (!_deflate->start()) {
+        _set_error(E_INTERNAL, "Failed to start compression");
+        _sock.abort();
+        return;
+      }
+      qInfo() << "IMAP4 Client: COMPRESS=DEFLATE enabled.";
+      _flush_output();
+    },
+    [this](ErrorType error, const QString& estr) {
+      _compress_pending = false;
+      if (error != E_INTERNAL) {
+        qWarning() << "IMAP4 Client: COMPRESS rejected:" << estr;
+        _flush_output();
+      }
+    });
+
+  _resp.emplace_back(Command::COMPRESS,
+                     detail::IMAPResponse{ _tags.prefix(), tag });
+
+  TagGenerator::write(_out, _tags.prefix(), tag);
+  _out.append(" COMPRESS DEFLATE\r\n");
+  _out_tags.append(tag);
+
+  _flush_output();
+
+  // commands queued behind COMPRESS must be compressed, hold them back.
+  if (!_resp.empty() && _resp.back().second.tag() == tag) {
+    _compress_pending = true;
+  }
+}
+
+bool
+IMAP::_inflate(QByteArray& data)
+{
+  if (!_deflate->active()) {
+    _data_in.fetch_add(data.size(), std::memory_order_relaxed);
+    return true;
+  }
+
+  data = _deflate->inflate(data);
+  if (_deflate->error()) {
+    _set_error(E_INTERNAL, "Corrupted compressed input");
+    _sock.abort();
+    return false;
+  }
+
+  _data_in.fetch_add(data.size(), std::memory_order_relaxed);
+  return true;
+}
+
+uint8_t
+IMAP::_parse_capabilities(const QString& text, bool code)
+{
+  uint8_t caps = 0;
+
+  for (const auto& word : detail::imap_parse_capabilities(text, code)) {
+    if (word.compare(u"COMPRESS=DEFLATE", Qt::CaseInsensitive) == 0) {
+      caps |= CAP_COMPRESS;
+    } else if (word.compare(u"LITERAL+", Qt::CaseInsensitive) == 0) {
+      caps |= CAP_LITERAL_PLUS;
+    } else if (word.compare(u"LITERAL-", Qt::CaseInsensitive) == 0) {
+      caps |= CAP_LITERAL_MINUS;
+    } else if (word.compare(u"MULTIAPPEND", Qt::CaseInsensitive) == 0) {
+      caps |= CAP_MULTIAPPEND;
+    } else if (word.compare(u"OBJECTID", Qt::CaseInsensitive) == 0) {
+      caps |= CAP_OBJECTID;
+    }
+  }
+
+  return caps;
+}
+
+void
+IMAP::_queue_append(TagGenerator::Tag tag,
+                    const QByteArray& cmd,
+                    QList<request::AppendMessage> messages,
+                    const ResultCallback& success,
+                    const ErrorCallback& error)
+{
+  if (messages.isEmpty()) {
+    _tag_error(tag, E_BADCOMMAND, "No message to append");
+    return;
+  }
+
+  // literal sizes are sent ahead of the bodies.
+  for (auto& message : messages) {
+    if (!message.device || !message.device->isReadable() ||
+        (message.size < 0 && message.device->isSequential())) {
+      _tag_error(tag, E_BADCOMMAND, "Message device is not readable");
+      return;
+    }
+
+    if (message.size < 0) {
+      message.size = message.device->size() - message.device->pos();
+    }
+  }
+
+  auto multi = (_caps & CAP_MULTIAPPEND) != 0 || messages.size() == 1;
+
+  // without MULTIAPPEND, each message is a command of its own, the caller
+  // still gets one result or one error.
+  auto batch = std::shared_ptr<AppendBatch>{};
+  auto merge = ResultCallback{};
+  auto fail = ErrorCallback{};
+  if (!multi) {
+    batch = std::make_shared<AppendBatch>();
+    batch->pending = static_cast<std::size_t>(messages.size());
+    batch->success = success;
+    batch->error = error;
+
+    merge = [this, batch](response::Result&& data) {
+      if (batch->failed) {
+        return;
+      }
+
+      if (auto* append = std::get_if<response::Append>(&data)) {
+        if (append->uidvalidity != 0) {
+          batch->result.uidvalidity = append->uidvalidity;
+        }
+        batch->result.uids.insert(append->uids);
+      }
+
+      if (--batch->pending != 0) {
+        return;
+      }
+
+      if (batch->success) {
+        batch->success(std::move(batch->result));
+        return;
+      }
+
+      {
+        QMutexLocker guard{ &_read_lock };
+        _queue.push(std::move(batch->result));
+      }
+      emit ready_read();
+    };
+
+    // the first failure ends the batch, later commands are not reported.
+    fail = [this, batch](ErrorType type, const QString& estr) {
+      if (std::exchange(batch->failed, true)) {
+        return;
+      }
+
+      for (auto tag : batch->tags) {
+        auto& slot = _slot_of(tag);
+        if (slot.used && slot.tag == tag) {
+          slot = TagSlot{};
+        }
+      }
+
+      if (batch->error) {
+        batch->error(type, estr);
+      }
+    };
+  }
+
+  qsizetype index = 0;
+  while (index < messages.size()) {
+    auto count = multi ? messages.size() : 1;
+
+    if (index != 0) {
+      tag = _tags.generate();
+    }
+    if (batch) {
+      batch->tags.append(tag);
+      _add_handler(tag, merge, fail);
+    }
+
+    _resp.emplace_back(Command::APPEND,
+                       detail::IMAPResponse{ _tags.prefix(), tag });
+
+    auto upload = Upload{};
+    upload.tag = tag;
+    upload.before = std::exchange(_out, {});
+    upload.command = cmd;
+    upload.messages = messages.sliced(index, count);
+    _uploads.push_back(std::move(upload));
+
+    _out_tags.clear();
+    index += count;
+  }
+}
+
+void
+IMAP::_pump_uploads()
+{
+  while (!_uploads.empty()) {
+    if (_idle_done || _compress_pending) {
+      return;
+    }
+
+    auto& upload = _uploads.front();
+    if (!upload.before.isEmpty()) {
+      if (!_write(upload.before)) {
+        return;
+      }
+      upload.before.clear();
+    }
+
+    if (!_stream_upload(upload)) {
+      return;
+    }
+    _uploads.pop_front();
+  }
+
+  _flush_output();
+}
+
+bool
+IMAP::_stream_upload(Upload& upload)
+{
+  while (_sock.bytesToWrite() < UPLOAD_BUFFER_SIZE) {
+    switch (upload.stage) {
+      case Upload::HEADER: {
+        if (upload.index == upload.messages.size()) {
+          return _write("\r\n");
+        }
+
+        const auto& message = upload.messages[upload.index];
+        auto sync = (_caps & CAP_LITERAL_PLUS) == 0 &&
+                    ((_caps & CAP_LITERAL_MINUS) == 0 ||
+                     message.size > LITERAL_MINUS_MAX);
+
+        auto header = QByteArray{};
+        if (upload.index == 0) {
+          TagGenerator::write(header, _tags.prefix(), upload.tag);
+          header.append(' ');
+          header.append(upload.command);
+        }
+        header.append(' ');
+        if (auto flags = _flags_command(message.flags); !flags.isEmpty()) {
+          header.append('(');
+          header.append(flags.toUtf8());
+          header.append(") ");
+        }
+        if (message.date.isValid()) {
+          header.append(_date_command(message.date).toLatin1());
+          header.append(' ');
+        }
+        header.append('{');
+        header.append(QByteArray::number(message.size));
+        header.append(sync ? "}\r\n" : "+}\r\n");
+
+        if (!_write(header)) {
+          return false;
+        }
+
+        upload.left = message.size;
+        upload.syncs += sync ? 1 : 0;
+        upload.stage = sync ? Upload::WAIT : Upload::BODY;
+        break;
+      }
+
+      case Upload::WAIT: {
+        auto it = std::find_if(_resp.begin(), _resp.end(), [&](auto& resp) {
+          return resp.second.tag() == upload.tag;
+        });
+        if (it == _resp.end() ||
+            it->second.continuations() < upload.syncs) {
+          return false;
+        }
+        upload.stage = Upload::BODY;
+        break;
+      }
+
+      case Upload::BODY: {
+        if (upload.left > 0) {
+          auto& device = upload.messages[upload.index].device;
+          auto chunk =
+            device->read(std::min<qint64>(upload.left, UPLOAD_CHUNK_SIZE));
+
+          // announced literal can not be completed, the stream is broken.
+          if (chunk.isEmpty()) {
+            _set_error(E_INTERNAL, "Message device ended early");
+            _sock.abort();
+            return false;
+          }
+
+          if (!_write(chunk)) {
+            return false;
+          }
+          upload.left -= chunk.size();
+        }
+
+        if (upload.left == 0) {
+          ++upload.index;
+          upload.stage = Upload::HEADER;
+        }
+        break;
+      }
+    }
+  }
+
+  return false;
+}
+
+QByteArray
+IMAP::_encode_output(const QByteArray& data)
+{
+  auto wire = _deflate->deflate(data);
+  _data_out.fetch_add(data.size(), std::memory_order_relaxed);
+  _wire_out.fetch_add(wire.size(), std::memory_order_relaxed);
+  return wire;
+}
+
+bool
+IMAP::_write(const QByteArray& data)
+{
+  auto wire = _encode_output(data);
+  if (_deflate->error() || _sock.write(wire) != wire.size()) {
+    _set_error(E_INTERNAL, _sock.errorString());
+    _sock.abort();
+    return false;
+  }
+
+  return true;
+}
+
+void
+IMAP::_handle_response(QPair<Command, detail::IMAPResponse>& resp)
+{
+  if (resp.first == Command::IDLE) {
+    _idling = false;
+    _idle_timer.stop();
+
+    // IDLE ended by the server, release commands held for DONE.
+    if (std::exchange(_idle_done, false)) {
+      _flush_output();
+    }
+  }
+
+  // APPEND refused instead of a continuation, the rest is never sent.
+  if (resp.first == Command::APPEND && !_uploads.empty() &&
+      _uploads.front().tag == resp.second.tag() &&
+      _uploads.front().stage == Upload::WAIT) {
+    _uploads.pop_front();
+    QMetaObject::invokeMethod(
+      this, [this] { _flush_output(); }, Qt::QueuedConnection);
+  }
+
+  if (!resp.second.error()) {
     // Response finished with success
     RESPONSE_HANDLER[resp.first](
       resp.second,
@@ -373,27 +1694,78 @@ IMAP::_on_ready_read()
       },
 
       // Parse success
-      [this, &resp](const QVariant& data) {
+      [this, &resp](response::Result&& data) {
+        // servers may advertise capabilities again after LOGIN.
+        auto caps_code = false;
         if (resp.first == Command::LOGIN) {
           _status = Status::AUTHENTICATE;
+
+          const auto& text = resp.second.tagged()[0].second;
+          caps_code = QStringView{ text }.trimmed().startsWith(
+            u"[CAPABILITY ", Qt::CaseInsensitive);
+          if (caps_code) {
+            _caps |= _parse_capabilities(text, true);
+          }
+        }
+        if (resp.first == Command::LOGIN || resp.first == Command::CAPABILITY) {
+          for (const auto& item : resp.second.untagged()) {
+            if (item.first == Response::CAPABILITY) {
+              caps_code = true;
+              _caps |= _parse_capabilities(item.second, false);
+            }
+          }
         }
 
-        _handle_success(resp.second.tag(), data);
+        // UIDs are only meaningful together with the folder UIDVALIDITY.
+        if (auto* select = std::get_if<response::Select>(&data)) {
+          _uidvalidity = select->uidvalidity;
+        } else if (auto* fetch = std::get_if<response::UidFetch>(&data)) {
+          fetch->uidvalidity = _uidvalidity;
+        } else if (auto* search = std::get_if<response::UidSearch>(&data)) {
+          search->uidvalidity = _uidvalidity;
+        } else if (auto* esearch = std::get_if<response::ESearch>(&data);
+                   esearch != nullptr && esearch->uid) {
+          esearch->uidvalidity = _uidvalidity;
+        } else if (auto* envelopes = std::get_if<response::Envelopes>(&data)) {
+          envelopes->set_uidvalidity(_uidvalidity);
+        }
+
+        if (const auto* items = _fetch_items(data); items != nullptr) {
+          _store_bodies(*items);
+        }
 
-        _read_lock.lock();
-        _queue.push(data);
-        _read_lock.unlock();
+        auto queued = _handle_success(resp.second.tag(), std::move(data));
+
+        // without a CAPABILITY code, ask before deciding on COMPRESS.
+        if (resp.first == Command::LOGIN) {
+          if (caps_code) {
+            _start_compress();
+          } else {
+            _request_capabilities();
+          }
+        }
 
-        emit ready_read();
+        // results consumed by a callback never reach `read`.
+        if (queued) {
+          emit ready_read();
+        }
       });
   } else {
-    // Response finished with error.
-    qWarning() << "IMAP4 Client: Failed to parse response for command "
-               << resp.first;
+    // Response finished with error, named as sent on the wire.
+    auto name = detail::COMMAND_KEYWORDS.name(resp.first);
+    qWarning() << "IMAP4 Client: Failed to parse response for command"
+               << QLatin1String{ name.data(),
+                                 static_cast<qsizetype>(name.size()) };
     _tag_error(resp.second.tag(), E_PARSE, "Invalid response");
   }
+}
 
-  _resp.pop_front();
+void
+IMAP::_on_bytes_written(qint64 /*bytes*/)
+{
+  if (!_uploads.empty()) {
+    _flush_output();
+  }
 }
 
 }
@@ -0,0 +1,57 @@
+#include <functional>
+#include <qregularexpression.h>
+#include <qstring.h>
+#include <qvariant.h>
+#include <utility>
+
+#include "temail/client/imap.hpp"
+#include "temail/client/response.hpp"
+#include "temail/client/sequence.hpp"
+#include "temail/private/client/imap/append.hpp"
+#include "temail/private/client/imap/response.hpp"
+
+namespace temail::client::detail {
+
+namespace {
+
+const QRegularExpression APPENDUID_REG{
+  R"REGEX(\[APPENDUID (?P<uidvalidity>\d+) (?P<uids>[\d:,]+)\])REGEX",
+  QRegularExpression::CaseInsensitiveOption
+}; /**< Regex to parse UIDPLUS code such as [APPENDUID 38505 3955:3956] into
+      [APPENDUID <uidvalidity> <uids>] */
+
+}
+
+void
+imap_handle_append(const detail::IMAPResponse& resp,
+                   const IMAP::ErrorCallback& error_handler,
+                   const IMAP::ResultCallback& success_handler)
+{
+  if (resp.tagged().size() != 1) {
+    error_handler(IMAP::E_UNEXPECTED, "Unexpected tagged response");
+    return;
+  }
+
+  // NO [TRYCREATE] if folder does not exist.
+  if (resp.tagged()[0].first == IMAP::Response::NO) {
+    error_handler(IMAP::E_REFERENCE, resp.tagged()[0].second);
+    return;
+  }
+
+  if (resp.tagged()[0].first == IMAP::Response::BAD) {
+    error_handler(IMAP::E_BADCOMMAND, resp.tagged()[0].second);
+    return;
+  }
+
+  auto append_resp = response::Append{};
+
+  if (auto parsed = APPENDUID_REG.match(resp.tagged()[0].second);
+      parsed.hasMatch()) {
+    append_resp.uidvalidity = parsed.captured("uidvalidity").toULongLong();
+    append_resp.uids = SequenceSet::parse(parsed.capturedView("uids"));
+  }
+
+  success_handler(std::move(append_resp));
+}
+
+}
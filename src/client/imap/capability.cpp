@@ -0,0 +1,56 @@
+#include <functional>
+#include <qstring.h>
+#include <qstringlist.h>
+#include <qstringview.h>
+#include <qvariant.h>
+
+#include "temail/client/imap.hpp"
+#include "temail/private/client/imap/capability.hpp"
+#include "temail/private/client/imap/response.hpp"
+
+namespace temail::client::detail {
+
+void
+imap_handle_capability(const detail::IMAPResponse& resp,
+                       const IMAP::ErrorCallback& error_handler,
+                       const IMAP::ResultCallback& success_handler)
+{
+  if (resp.tagged().size() != 1) {
+    error_handler(IMAP::E_UNEXPECTED, "Unexpected tagged response");
+    return;
+  }
+
+  if (resp.tagged()[0].first != IMAP::Response::OK) {
+    error_handler(IMAP::E_BADCOMMAND, resp.tagged()[0].second);
+    return;
+  }
+
+  success_handler({});
+}
+
+QStringList
+imap_parse_capabilities(QStringView text, bool code)
+{
+  text = text.trimmed();
+
+  // response text, such as `[CAPABILITY IMAP4rev1 LITERAL+] Logged in`.
+  if (code) {
+    constexpr auto PREFIX = QStringView{ u"[CAPABILITY " };
+    if (!text.startsWith(PREFIX, Qt::CaseInsensitive)) {
+      return {};
+    }
+
+    auto close = text.indexOf(']');
+    text = text.sliced(PREFIX.size(),
+                       (close < 0 ? text.size() : close) - PREFIX.size());
+  }
+
+  auto names = QStringList{};
+  for (auto word : text.split(' ', Qt::SkipEmptyParts)) {
+    names.append(word.toString());
+  }
+
+  return names;
+}
+
+}
@@ -0,0 +1,127 @@
+#include <qbytearray.h>
+#include <qdebug.h>
+#include <qlogging.h>
+#include <zlib.h>
+
+#include "temail/private/client/imap/deflate.hpp"
+
+namespace temail::client::detail {
+
+namespace {
+
+TEMAIL_INLINE Bytef*
+_bytes(const char* data)
+{
+  // zlib never writes through `next_in`.
+  return reinterpret_cast<Bytef*>(const_cast<char*>(data)); // NOLINT
+}
+
+}
+
+bool
+IMAPDeflate::start()
+{
+  reset();
+
+  // negative window bits select raw deflate without zlib header.
+  _inflater = z_stream{};
+  if (inflateInit2(&_inflater, -MAX_WBITS) != Z_OK) {
+    qWarning() << "IMAP4 Client| Failed to initialize inflate stream.";
+    return false;
+  }
+
+  _deflater = z_stream{};
+  if (deflateInit2(&_deflater,
+                   Z_DEFAULT_COMPRESSION,
+                   Z_DEFLATED,
+                   -MAX_WBITS,
+                   MAX_MEM_LEVEL,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    qWarning() << "IMAP4 Client| Failed to initialize deflate stream.";
+    inflateEnd(&_inflater);
+    return false;
+  }
+
+  _active = true;
+  _error = false;
+  return true;
+}
+
+void
+IMAPDeflate::reset()
+{
+  if (!_active) {
+    return;
+  }
+
+  inflateEnd(&_inflater);
+  deflateEnd(&_deflater);
+  _active = false;
+}
+
+QByteArray
+IMAPDeflate::inflate(const QByteArray& data)
+{
+  if (!_active) {
+    return data;
+  }
+
+  auto out = QByteArray{};
+  _inflater.next_in = _bytes(data.constData());
+  _inflater.avail_in = static_cast<uInt>(data.size());
+
+  // a full output buffer means there may be more to inflate.
+  do {
+    auto used = out.size();
+    out.resize(used + CHUNK_SIZE);
+    _inflater.next_out = _bytes(out.data() + used);
+    _inflater.avail_out = CHUNK_SIZE;
+
+    auto ret = ::inflate(&_inflater, Z_SYNC_FLUSH);
+    out.resize(used + CHUNK_SIZE - _inflater.avail_out);
+
+    if (ret == Z_STREAM_END || ret == Z_BUF_ERROR) {
+      break;
+    }
+
+    if (ret != Z_OK) {
+      qWarning() << "IMAP4 Client| Failed to inflate input:"
+                 << (_inflater.msg != nullptr ? _inflater.msg : "unknown");
+      _error = true;
+      return {};
+    }
+  } while (_inflater.avail_out == 0);
+
+  return out;
+}
+
+QByteArray
+IMAPDeflate::deflate(const QByteArray& data)
+{
+  if (!_active) {
+    return data;
+  }
+
+  auto out = QByteArray{};
+  out.reserve(data.size() / 2 + CHUNK_SIZE);
+  _deflater.next_in = _bytes(data.constData());
+  _deflater.avail_in = static_cast<uInt>(data.size());
+
+  do {
+    auto used = out.size();
+    out.resize(used + CHUNK_SIZE);
+    _deflater.next_out = _bytes(out.data() + used);
+    _deflater.avail_out = CHUNK_SIZE;
+
+    if (::deflate(&_deflater, Z_SYNC_FLUSH) == Z_STREAM_ERROR) {
+      qWarning() << "IMAP4 Client| Failed to deflate output.";
+      _error = true;
+      return {};
+    }
+    out.resize(used + CHUNK_SIZE - _deflater.avail_out);
+  } while (_deflater.avail_out == 0);
+
+  return out;
+}
+
+}
@@ -1,34 +1,164 @@
+#include <cstddef>
 #include <functional>
+#include <qbytearrayview.h>
 #include <qstring.h>
+#include <qstringview.h>
 #include <qvariant.h>
+#include <utility>
 
+#include "temail/client/flags.hpp"
 #include "temail/client/imap.hpp"
+#include "temail/client/response.hpp"
+#include "temail/client/sequence.hpp"
 #include "temail/private/client/imap/fetch.hpp"
 #include "temail/private/client/imap/response.hpp"
 
 namespace temail::client::detail {
 
+namespace {
+
+/**
+ * @brief Store a fetched field into its item, bytes are shared, not decoded.
+ *
+ */
 void
-imap_handle_fetch(const detail::IMAPResponse& resp,
-                  const IMAP::ErrorCallback& error_handler,
-                  const IMAP::CommandCallback& success_handler)
+_store_field(response::FetchItem& item,
+             const QString& key,
+             const QByteArray& value)
+{
+  if (key.startsWith("BODY[HEADER.FIELDS", Qt::CaseInsensitive)) {
+    if (key.contains("CONTENT-TYPE", Qt::CaseInsensitive)) {
+      item.content_type = response::FetchContentType{ value };
+      item.fields |= request::Fetch::MIME;
+    } else {
+      item.envelope = response::FetchEnvelope{ value };
+      item.fields |= request::Fetch::ENVELOPE;
+    }
+  } else if (key.compare("BODY[1.MIME]", Qt::CaseInsensitive) == 0) {
+    item.part_type = response::FetchContentType{ value };
+    item.fields |= request::Fetch::MIME;
+  } else if (key.compare("BODY[1]", Qt::CaseInsensitive) == 0) {
+    item.text = value;
+    item.fields |= request::Fetch::TEXT;
+  } else if (key.compare("UID", Qt::CaseInsensitive) == 0) {
+    item.uid = value.toULongLong();
+  } else if (key.compare("MODSEQ", Qt::CaseInsensitive) == 0 &&
+             value.size() > 2) {
+    // value is a parenthesized list such as `(12345)`.
+    item.modseq = QByteArrayView{ value }.sliced(1).chopped(1).toULongLong();
+  } else if (key.compare("RFC822.SIZE", Qt::CaseInsensitive) == 0) {
+    item.size = value.toULongLong();
+    item.fields |= request::Fetch::SIZE;
+  } else if (key.compare("FLAGS", Qt::CaseInsensitive) == 0) {
+    item.flags = FlagSet::parse(QString::fromLatin1(value));
+    item.fields |= request::Fetch::FLAGS;
+  } else if (key.compare("EMAILID", Qt::CaseInsensitive) == 0 &&
+             value.size() > 2) {
+    // value is a parenthesized objectid such as `(M6d99ac3275bb4e)`.
+    item.emailid = QString::fromLatin1(
+      QByteArrayView{ value }.sliced(1).chopped(1).trimmed());
+    item.fields |= request::Fetch::EMAILID;
+  }
+}
+
+/**
+ * @brief Check tagged status of FETCH-like responses.
+ *
+ */
+bool
+_check_tagged(const detail::IMAPResponse& resp,
+              const IMAP::ErrorCallback& error_handler)
 {
   if (resp.tagged().size() != 1) {
     error_handler(IMAP::E_UNEXPECTED, "Unexpected tagged response");
-    return;
+    return false;
   }
 
   if (resp.tagged()[0].first == IMAP::Response::NO) {
     error_handler(IMAP::E_REFERENCE, resp.tagged()[0].second);
-    return;
+    return false;
   }
 
   if (resp.tagged()[0].first == IMAP::Response::BAD) {
     error_handler(IMAP::E_BADCOMMAND, resp.tagged()[0].second);
+    return false;
+  }
+
+  return true;
+}
+
+}
+
+response::Search
+imap_parse_vanished(const detail::IMAPResponse& resp)
+{
+  auto vanished = response::Search{};
+
+  for (const auto& item : resp.untagged()) {
+    if (item.first != IMAP::Response::VANISHED) {
+      continue;
+    }
+
+    auto set = QStringView{ item.second }.trimmed();
+    if (set.startsWith(u"(EARLIER)", Qt::CaseInsensitive)) {
+      set = set.sliced(9).trimmed();
+    }
+
+    vanished.insert(SequenceSet::parse(set));
+  }
+
+  return vanished;
+}
+
+response::Fetch
+imap_parse_fetch(const detail::IMAPResponse& resp)
+{
+  auto fetch_resp = response::Fetch{};
+  fetch_resp.reserve(resp.raw().size());
+
+  for (auto it = resp.raw().cbegin(); it != resp.raw().cend(); ++it) {
+    auto item = response::FetchItem{};
+    item.id = it.key();
+
+    for (auto field = it->cbegin(); field != it->cend(); ++field) {
+      _store_field(item, field.key(), field.value());
+    }
+
+    fetch_resp.push_back(std::move(item));
+  }
+
+  return fetch_resp;
+}
+
+void
+imap_handle_fetch(const detail::IMAPResponse& resp,
+                  const IMAP::ErrorCallback& error_handler,
+                  const IMAP::ResultCallback& success_handler)
+{
+  if (!_check_tagged(resp, error_handler)) {
+    return;
+  }
+
+  success_handler(imap_parse_fetch(resp));
+}
+
+void
+imap_handle_uid_fetch(detail::IMAPResponse& resp,
+                      const IMAP::ErrorCallback& error_handler,
+                      const IMAP::ResultCallback& success_handler)
+{
+  if (!_check_tagged(resp, error_handler)) {
+    return;
+  }
+
+  // UIDVALIDITY is filled by the client, which tracks the selected folder.
+  if (resp.collects_envelopes()) {
+    success_handler(resp.take_envelopes());
     return;
   }
 
-  success_handler(QVariant::fromValue(1));
+  success_handler(response::UidFetch{
+    0, imap_parse_fetch(resp), imap_parse_vanished(resp) });
 }
 
 }
@@ -1,8 +1,9 @@
 #include <functional>
 #include <qstring.h>
-#include <qstringlist.h>
 #include <qvariant.h>
+#include <utility>
 
+#include "temail/client/flags.hpp"
 #include "temail/client/imap.hpp"
 #include "temail/client/response.hpp"
 #include "temail/private/client/imap/list.hpp"
@@ -17,26 +18,12 @@ const QRegularExpression LIST_REG{
 }; /**< Regex to parse LIST response such as (\XXX \XXX) "XXX" "XXX" into
       (<attrs>) "<parent>" "<name>" */
 
-QStringList
-_parse_attrs(const QString& attrs_str)
-{
-  auto attrs = attrs_str.split(' ', Qt::SkipEmptyParts);
-
-  for (auto& item : attrs) {
-    if (item.front() == '\\') {
-      item.erase(item.begin());
-    }
-  }
-
-  return attrs;
-}
-
 }
 
 void
 imap_handle_list(const detail::IMAPResponse& resp,
                  const IMAP::ErrorCallback& error_handler,
-                 const IMAP::CommandCallback& success_handler)
+                 const IMAP::ResultCallback& success_handler)
 {
   if (resp.tagged().size() != 1) {
     error_handler(IMAP::E_UNEXPECTED, "Unexpected tagged response");
@@ -70,10 +57,10 @@ imap_handle_list(const detail::IMAPResponse& resp,
 
     list_resp.push_back({ parsed.captured("parent"),
                           parsed.captured("name"),
-                          _parse_attrs(parsed.captured("attrs")) });
+                          FlagSet::parse(parsed.captured("attrs")) });
   }
 
-  success_handler(QVariant::fromValue(list_resp));
+  success_handler(std::move(list_resp));
 }
 
 }
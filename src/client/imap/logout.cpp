@@ -11,7 +11,7 @@ namespace temail::client::detail {
 void
 imap_handle_logout(const detail::IMAPResponse& resp,
                    const IMAP::ErrorCallback& error_handler,
-                   const IMAP::CommandCallback& success_handler)
+                   const IMAP::ResultCallback& success_handler)
 {
   if (resp.tagged().size() != 1) {
     error_handler(IMAP::E_UNEXPECTED, "Unexpected tagged response");
@@ -12,7 +12,7 @@ namespace temail::client::detail {
 void
 imap_handle_noop(const detail::IMAPResponse& resp,
                  const IMAP::ErrorCallback& error_handler,
-                 const IMAP::CommandCallback& success_handler)
+                 const IMAP::ResultCallback& success_handler)
 {
   if (resp.tagged().size() != 1) {
     error_handler(IMAP::E_UNEXPECTED, "Unexpected tagged response");
@@ -24,7 +24,7 @@ imap_handle_noop(const detail::IMAPResponse& resp,
     return;
   }
 
-  success_handler(QVariant::fromValue(response::Noop{}));
+  success_handler(response::Noop{});
 }
 
 }
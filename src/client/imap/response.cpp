@@ -1,20 +1,23 @@
 #include <cstddef>
 #include <cstdint>
 #include <qbytearray.h>
-#include <qdatastream.h>
 #include <qdebug.h>
 #include <qlist.h>
 #include <qlogging.h>
 #include <qmap.h>
+#include <qmetaobject.h>
 #include <qpair.h>
-#include <qregularexpression.h>
-#include <qsslsocket.h>
 #include <qstring.h>
-#include <qstringview.h>
+#include <utility>
 
+#include "temail/client/flags.hpp"
 #include "temail/client/imap.hpp"
+#include "temail/client/response.hpp"
 #include "temail/common.hpp"
+#include "temail/private/client/imap/keyword.hpp"
 #include "temail/private/client/imap/response.hpp"
+#include "temail/private/client/imap/tokenizer.hpp"
+#include "temail/tag.hpp"
 
 #define _forward_false(expr)                                                   \
   {                                                                            \
@@ -31,171 +34,345 @@
 
 namespace temail::client::detail {
 
+namespace {
+
+using Token = IMAPTokenizer::Token;
+
+/**
+ * @brief Check if token value is a message number.
+ *
+ */
 bool
-IMAPResponse::digest(const QByteArray& data)
+_is_number(const QByteArray& value)
 {
-  auto stream = QDataStream{ data };
+  for (auto ch : value) {
+    if (ch < '0' || ch > '9') {
+      return false;
+    }
+  }
+  return !value.isEmpty();
+}
 
-  if (_raw_mode) {
-    _forward_false(_handle_raw(stream));
-    _raw_mode = false;
+/**
+ * @brief Append quoted string into list value.
+ *
+ */
+void
+_append_quoted(QByteArray& list, const QByteArray& value)
+{
+  list.append('"');
+  for (auto ch : value) {
+    if (ch == '"' || ch == '\\') {
+      list.append('\\');
+    }
+    list.append(ch);
   }
+  list.append('"');
+}
 
-  return _handle_command(stream);
 }
 
 bool
-IMAPResponse::_handle_tagged(const QString& data)
+IMAPResponse::digest(const QByteArray& data)
 {
-  if (auto parsed = TAGGED_REG.match(data); parsed.hasMatch()) {
-    _tagged.emplace_back(common::enum_value<IMAP::Response>(
-                           parsed.captured("type").toLocal8Bit().constData()),
-                         parsed.captured("data"));
+  if (_state == State::DONE) {
     return true;
   }
 
-  qWarning() << "IMAP4 Client| Unhandled response line: " << data;
-  _emit_error();
-}
+  if (_error) {
+    return false;
+  }
 
-bool
-IMAPResponse::_handle_untagged(const QString& data, const QDataStream& stream)
-{
-  if (auto parsed = UNTAGGED_FETCH_REG.match(data); parsed.hasMatch()) {
-    bool ok = false;
-    _id = parsed.captured("id").toULongLong(&ok);
-    if (!ok) {
-      qWarning() << "IMAP4 Client| Failed to parse FETCH id: Not a number.";
-      _emit_error();
+  _tokens.feed(data);
+
+  while (true) {
+    // only top-level FETCH item literals can be streamed.
+    _tokens.stream_literals(_sink && _state == State::FETCH_VALUE);
+
+    auto token =
+      _state == State::TEXT ? _tokens.next_text() : _tokens.next();
+
+    if (token == Token::NONE) {
+      return false;
     }
 
-    _forward_false(_handle_raw_meta(parsed.captured("data")));
+    if (token == Token::ERROR) {
+      _emit_error();
+    }
 
-    if (_bytes_to_read != 0) {
-      _raw_mode = true;
-      _forward_false(_handle_raw(stream));
-      _raw_mode = false;
+    switch (_state) {
+      case State::LINE:
+        _forward_false(_handle_line(token));
+        break;
+
+      case State::UNTAGGED:
+      case State::UNTAGGED_NUMBER:
+        _forward_false(_handle_untagged(token));
+        break;
+
+      case State::TAGGED:
+        if (token != Token::ATOM) {
+          qWarning() << "IMAP4 Client| Unexpected tagged response status.";
+          _emit_error();
+        }
+        _type = _keyword();
+        _kind = Kind::TAGGED;
+        _state = State::TEXT;
+        break;
+
+      case State::TEXT:
+        if (_handle_text()) {
+          return true;
+        }
+        break;
+
+      default:
+        _forward_false(_handle_fetch(token));
+        break;
     }
+  }
+}
 
+bool
+IMAPResponse::_handle_line(IMAPTokenizer::Token token)
+{
+  if (token == Token::ATOM && _tokens.value() == "*") {
+    _state = State::UNTAGGED;
     return true;
   }
 
-  if (auto parsed = UNTAGGED_REG.match(data); parsed.hasMatch()) {
-    _untagged.emplace_back(common::enum_value<IMAP::Response>(
-                             parsed.captured("type").toLocal8Bit().constData()),
-                           parsed.captured("data"));
+  if (token == Token::ATOM && _tokens.value() == "+") {
+    _kind = Kind::CONTINUATION;
+    _state = State::TEXT;
     return true;
   }
 
-  if (auto parsed = UNTAGGED_TRAILING_REG.match(data); parsed.hasMatch()) {
-    _untagged_trailing.emplace_back(
-      common::enum_value<IMAP::Response>(
-        parsed.captured("type").toLocal8Bit().constData()),
-      parsed.captured("data"));
+  if (token == Token::ATOM &&
+      TagGenerator::parse(_prefix, _tokens.value()) == _tag) {
+    _state = State::TAGGED;
     return true;
   }
 
-  qWarning() << "IMAP4 Client| Unhandled response line: " << data;
+  qWarning() << "IMAP4 Client| Unhandled response line: " << _tokens.value();
   _emit_error();
 }
 
 bool
-IMAPResponse::_handle_command(const QDataStream& stream)
+IMAPResponse::_handle_untagged(IMAPTokenizer::Token token)
 {
-  while (true) {
-    _forward_false(_read_line_to_buffer(stream));
+  if (token != Token::ATOM) {
+    qWarning() << "IMAP4 Client| Unexpected untagged response type.";
+    _emit_error();
+  }
 
-    if (_buffer.startsWith('*')) {
-      _forward_false(_handle_untagged(QString{ _buffer }.trimmed(), stream));
+  if (_state == State::UNTAGGED && _is_number(_tokens.value())) {
+    _number = _tokens.take_value();
+    _state = State::UNTAGGED_NUMBER;
+    return true;
+  }
 
-      // `connect` returns only an untagged response.
-      if (_tag == IMAP::CONNECT_TAG) {
-        return true;
-      }
-    } else if (_buffer.startsWith(_tag.toLocal8Bit())) {
-      // all command should ends with a tagged response.
-      return _handle_tagged(QString{ _buffer }.trimmed());
-    } else {
-      qWarning() << "IMAP4 Client| Unhandled response line: " << _buffer;
-      _emit_error();
-    }
+  if (_state == State::UNTAGGED) {
+    _type = _keyword();
+    _kind = Kind::UNTAGGED;
+    _state = State::TEXT;
+    return true;
   }
+
+  _type = _keyword();
+  if (_type == IMAP::Response::FETCH) {
+    _id = _number.toULongLong();
+    _state = State::FETCH;
+    return true;
+  }
+
+  _kind = Kind::UNTAGGED_TRAILING;
+  _state = State::TEXT;
+  return true;
 }
 
 bool
-IMAPResponse::_handle_raw(const QDataStream& stream)
+IMAPResponse::_handle_text()
 {
-  while (true) {
-    if (_bytes_to_read <= 0) {
-      _forward_false(_read_line_to_buffer(stream));
-
-      if (_buffer.startsWith(')')) {
-        return true;
-      }
+  switch (_kind) {
+    case Kind::TAGGED:
+      _tagged.emplace_back(_type, QString::fromUtf8(_tokens.value()));
+      _state = State::DONE;
+      return true;
 
-      _forward_false(_handle_raw_meta(QString{ _buffer }.trimmed()));
-    }
+    case Kind::UNTAGGED:
+      _untagged.emplace_back(_type, QString::fromUtf8(_tokens.value()));
+      break;
 
-    auto nbuf = stream.device()->read(_bytes_to_read);
+    case Kind::UNTAGGED_TRAILING:
+      _untagged_trailing.emplace_back(_type, QString::fromLatin1(_number));
+      break;
 
-    _bytes_to_read -= nbuf.size();
-    _raw[_id][_field].append(nbuf);
+    case Kind::CONTINUATION:
+      ++_continuations;
+      break;
+  }
 
-    if (_bytes_to_read > 0) {
-      return false;
-    }
+  // `connect` returns only an untagged response.
+  if (_tag == IMAP::CONNECT_TAG) {
+    _state = State::DONE;
+    return true;
   }
+
+  _state = State::LINE;
+  return false;
 }
 
 bool
-IMAPResponse::_handle_raw_meta(const QString& data)
+IMAPResponse::_handle_fetch(IMAPTokenizer::Token token)
 {
-  for (const auto& parsed : PAIRED_FETCH_REG.globalMatch(data)) {
-    // skip NIL
-    if (!parsed.hasCaptured("size")) {
-      continue;
-    }
+  switch (_state) {
+    case State::FETCH:
+      if (token != Token::LIST_BEGIN) {
+        qWarning() << "IMAP4 Client| Failed to parse FETCH: Expect `(`.";
+        _emit_error();
+      }
+      _state = State::FETCH_KEY;
+      return true;
 
-    bool ok = false;
-    auto bsize = parsed.captured("size").toLongLong(&ok);
-    if (!ok) {
-      qWarning() << "IMAP4 Client| Failed to parse FETCH size: Not a number.";
-      _emit_error();
-    }
+    case State::FETCH_KEY:
+      if (token == Token::LIST_END) {
+        _end_fetch();
+        _state = State::FETCH_END;
+        return true;
+      }
+
+      if (token != Token::ATOM) {
+        qWarning() << "IMAP4 Client| Failed to parse FETCH: Expect field.";
+        _emit_error();
+      }
 
-    // multiline data: return to _handle_raw
-    if (!parsed.hasCaptured("data")) {
-      _bytes_to_read = bsize;
-      _field = parsed.captured("field");
+      _field = QString::fromLatin1(_tokens.value());
+      _state = State::FETCH_VALUE;
       return true;
-    }
 
-    // inline data: save
-    _raw[_id][parsed.captured("field")] = parsed.captured("data").toLocal8Bit();
+    case State::FETCH_VALUE:
+      if (token == Token::LIST_BEGIN) {
+        _list = "(";
+        _depth = 1;
+        _state = State::FETCH_LIST;
+        return true;
+      }
+
+      if (token == Token::LITERAL_CHUNK) {
+        _sink(_id, _field, _tokens.value());
+        return true;
+      }
+
+      if (token == Token::LITERAL && _sink) {
+        _sink(_id, _field, _tokens.value());
+      } else if (token == Token::ATOM || token == Token::QUOTED ||
+                 token == Token::LITERAL) {
+        _store_value(_tokens.take_value());
+      } else if (token != Token::NIL) {
+        qWarning() << "IMAP4 Client| Failed to parse FETCH: Expect value.";
+        _emit_error();
+      }
+
+      _state = State::FETCH_KEY;
+      return true;
+
+    case State::FETCH_LIST:
+      if (token == Token::LIST_END) {
+        _list.append(')');
+        if (--_depth == 0) {
+          _store_value(std::move(_list));
+          _state = State::FETCH_KEY;
+        }
+        return true;
+      }
+
+      if (token == Token::CRLF) {
+        qWarning() << "IMAP4 Client| Failed to parse FETCH: Unclosed list.";
+        _emit_error();
+      }
+
+      if (!_list.endsWith('(')) {
+        _list.append(' ');
+      }
+
+      if (token == Token::LIST_BEGIN) {
+        _list.append('(');
+        ++_depth;
+      } else if (token == Token::QUOTED || token == Token::LITERAL) {
+        _append_quoted(_list, _tokens.value());
+      } else {
+        _list.append(_tokens.value());
+      }
+      return true;
+
+    case State::FETCH_END:
+      if (token != Token::CRLF) {
+        qWarning() << "IMAP4 Client| Failed to parse FETCH: Expect CRLF.";
+        _emit_error();
+      }
+      _state = State::LINE;
+      return true;
+
+    default:
+      _emit_error();
   }
+}
 
-  return true;
+void
+IMAPResponse::_store_value(QByteArray value)
+{
+  if (!_columns) {
+    _raw[_id][_field] = std::move(value);
+    return;
+  }
+
+  // field names are the exact ones the server sent.
+  if (_field.startsWith("BODY[HEADER.FIELDS", Qt::CaseInsensitive)) {
+    _row_header = std::move(value);
+  } else if (_field.compare("UID", Qt::CaseInsensitive) == 0) {
+    _row_uid = value.toUInt();
+  } else if (_field.compare("RFC822.SIZE", Qt::CaseInsensitive) == 0) {
+    _row_size = value.toULongLong();
+  } else if (_field.compare("FLAGS", Qt::CaseInsensitive) == 0) {
+    _row_flags = FlagSet::parse(QString::fromLatin1(value)).flags();
+  }
 }
 
-bool
-IMAPResponse::_read_line_to_buffer(const QDataStream& stream)
+void
+IMAPResponse::_end_fetch()
 {
-  if (!_buffer.endsWith("\r\n")) {
-    _buffer.append(stream.device()->readLine());
-  } else {
-    _buffer = stream.device()->readLine();
+  if (!_columns) {
+    return;
   }
 
-  if (_buffer.isEmpty()) {
-    qWarning() << "IMAP4 Client| Failed to parse response: Unexpected EOF.";
-    _emit_error();
+  if (_row_uid != 0) {
+    _envelopes.append(_row_uid,
+                      response::FetchEnvelope{ std::move(_row_header) },
+                      _row_size,
+                      _row_flags);
   }
 
-  if (!_buffer.endsWith("\r\n")) {
-    return false;
+  _row_uid = 0;
+  _row_size = 0;
+  _row_flags = {};
+  _row_header.clear();
+}
+
+IMAP::Response
+IMAPResponse::_keyword()
+{
+  const auto& value = _tokens.value();
+
+  auto type = RESPONSE_KEYWORDS.value(
+    { value.constData(), static_cast<std::size_t>(value.size()) });
+  if (!type) {
+    qCritical("**TEMAIL INTERNAL**: Failed to convert %s to enum %s !",
+              value.constData(),
+              QMetaEnum::fromType<IMAP::Response>().enumName());
+    return IMAP::Response::OK;
   }
 
-  return true;
+  return *type;
 }
 
 }
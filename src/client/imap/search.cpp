@@ -1,52 +1,205 @@
+#include <algorithm>
+#include <cstdint>
 #include <functional>
+#include <optional>
+#include <qdebug.h>
+#include <qlogging.h>
 #include <qstring.h>
+#include <qstringview.h>
 #include <qvariant.h>
 #include <utility>
 
 #include "temail/client/imap.hpp"
+#include "temail/client/response.hpp"
+#include "temail/client/sequence.hpp"
 #include "temail/private/client/imap/response.hpp"
 #include "temail/private/client/imap/search.hpp"
 
 namespace temail::client::detail {
 
-void
-imap_handle_search(const detail::IMAPResponse& resp,
-                   const IMAP::ErrorCallback& error_handler,
-                   const IMAP::CommandCallback& success_handler)
+namespace {
+
+bool
+_check_search(const detail::IMAPResponse& resp,
+              const IMAP::ErrorCallback& error_handler)
 {
   if (resp.tagged().size() != 1) {
     error_handler(IMAP::E_UNEXPECTED, "Unexpected tagged response");
-    return;
+    return false;
   }
 
   if (resp.tagged()[0].first == IMAP::Response::NO) {
     error_handler(IMAP::E_REFERENCE, resp.tagged()[0].second);
-    return;
+    return false;
   }
 
   if (resp.tagged()[0].first == IMAP::Response::BAD) {
     error_handler(IMAP::E_BADCOMMAND, resp.tagged()[0].second);
-    return;
+    return false;
+  }
+
+  return true;
+}
+
+// a parenthesized list is one token, parens are stripped.
+QStringView
+_next_token(QStringView& rest)
+{
+  auto token = QStringView{};
+
+  if (rest.startsWith('(')) {
+    auto close = rest.indexOf(')');
+    if (close < 0) {
+      close = rest.size();
+    }
+    token = rest.sliced(1, close - 1);
+    rest = rest.sliced(std::min(close + 1, rest.size())).trimmed();
+    return token;
+  }
+
+  auto space = rest.indexOf(' ');
+  token = space < 0 ? rest : rest.first(space);
+  rest = space < 0 ? QStringView{} : rest.sliced(space + 1).trimmed();
+  return token;
+}
+
+// such as `(TAG "A1") UID COUNT 3 PARTIAL (1:100 2,10:11)`.
+response::ESearch
+_parse_esearch(QStringView data)
+{
+  auto esearch = response::ESearch{};
+  auto rest = data.trimmed();
+
+  // search correlator is ignored, commands complete in order.
+  if (rest.startsWith('(')) {
+    _next_token(rest);
+  }
+
+  while (!rest.isEmpty()) {
+    auto key = _next_token(rest);
+    if (key.compare(u"UID", Qt::CaseInsensitive) == 0) {
+      esearch.uid = true;
+      continue;
+    }
+
+    auto value = _next_token(rest);
+    if (key.compare(u"MIN", Qt::CaseInsensitive) == 0) {
+      esearch.min = value.toULongLong();
+    } else if (key.compare(u"MAX", Qt::CaseInsensitive) == 0) {
+      esearch.max = value.toULongLong();
+    } else if (key.compare(u"COUNT", Qt::CaseInsensitive) == 0) {
+      esearch.count = value.toULongLong();
+    } else if (key.compare(u"ALL", Qt::CaseInsensitive) == 0) {
+      esearch.ids = SequenceSet::parse(value);
+    } else if (key.compare(u"PARTIAL", Qt::CaseInsensitive) == 0) {
+      // `(<window> <ids>)`, ids are NIL if the window is beyond the end.
+      auto space = value.indexOf(' ');
+      if (space >= 0) {
+        esearch.ids = SequenceSet::parse(value.sliced(space + 1).trimmed());
+      }
+    }
   }
 
+  return esearch;
+}
+
+std::optional<response::Search>
+_parse_search(const detail::IMAPResponse& resp,
+              const IMAP::ErrorCallback& error_handler)
+{
   if (resp.untagged().size() != 1) {
     error_handler(IMAP::E_UNEXPECTED, "Unexpected untagged response");
-    return;
+    return std::nullopt;
   }
 
-  auto search_resp = QList<std::size_t>{};
-  for (const auto& item :
-       resp.untagged()[0].second.split(' ', Qt::SkipEmptyParts)) {
-    bool ok = false;
-    auto index = item.toULongLong(&ok);
-    if (!ok) {
-      qWarning() << "Failed to parse SEARCH response: Not a number.";
+  // ids are ascending on every known server, so runs merge while parsing.
+  auto search_resp = response::Search{};
+  auto line = QStringView{ resp.untagged()[0].second };
+  auto id = uint64_t{ 0 };
+  auto valid = true;
+
+  for (qsizetype i = 0; i <= line.size(); ++i) {
+    auto ch = i < line.size() ? line[i] : QChar{ ' ' };
+    if (ch != ' ') {
+      valid = valid && ch.isDigit();
+      id = std::min(id * 10 + ch.digitValue(), uint64_t{ SequenceSet::LAST });
       continue;
     }
-    search_resp.push_back(index);
+
+    // `LAST` is reserved for `*`.
+    if (id != 0 && id < SequenceSet::LAST && valid) {
+      search_resp.insert(static_cast<SequenceSet::Id>(id));
+    } else if (!valid) {
+      qWarning() << "Failed to parse SEARCH response: Not a number.";
+    }
+    id = 0;
+    valid = true;
+  }
+
+  return search_resp;
+}
+
+// commands with RETURN options get ESEARCH instead of SEARCH data.
+bool
+_handle_esearch(const detail::IMAPResponse& resp,
+                bool uid,
+                const IMAP::ResultCallback& success_handler)
+{
+  auto esearch = std::optional<response::ESearch>{};
+
+  for (const auto& item : resp.untagged()) {
+    if (item.first == IMAP::Response::ESEARCH) {
+      esearch = _parse_esearch(item.second);
+      break;
+    }
+  }
+
+  if (!esearch) {
+    return false;
+  }
+
+  esearch->uid = esearch->uid || uid;
+  success_handler(std::move(*esearch));
+  return true;
+}
+
+}
+
+void
+imap_handle_search(const detail::IMAPResponse& resp,
+                   const IMAP::ErrorCallback& error_handler,
+                   const IMAP::ResultCallback& success_handler)
+{
+  if (!_check_search(resp, error_handler) ||
+      _handle_esearch(resp, false, success_handler)) {
+    return;
+  }
+
+  auto search_resp = _parse_search(resp, error_handler);
+  if (!search_resp) {
+    return;
+  }
+
+  success_handler(std::move(*search_resp));
+}
+
+void
+imap_handle_uid_search(const detail::IMAPResponse& resp,
+                       const IMAP::ErrorCallback& error_handler,
+                       const IMAP::ResultCallback& success_handler)
+{
+  if (!_check_search(resp, error_handler) ||
+      _handle_esearch(resp, true, success_handler)) {
+    return;
+  }
+
+  auto search_resp = _parse_search(resp, error_handler);
+  if (!search_resp) {
+    return;
   }
 
-  success_handler(QVariant::fromValue(std::move(search_resp)));
+  // UIDVALIDITY is filled by the client, which tracks the selected folder.
+  success_handler(response::UidSearch{ 0, std::move(*search_resp) });
 }
 
 }
@@ -1,11 +1,12 @@
 #include <functional>
 #include <qstring.h>
-#include <qstringlist.h>
 #include <qvariant.h>
 #include <utility>
 
+#include "temail/client/flags.hpp"
 #include "temail/client/imap.hpp"
 #include "temail/client/response.hpp"
+#include "temail/private/client/imap/fetch.hpp"
 #include "temail/private/client/imap/response.hpp"
 #include "temail/private/client/imap/select.hpp"
 
@@ -23,28 +24,13 @@ const QRegularExpression SELECT_BRACKET_REG{
       [XXX (\XXX \XXX)] XXX into [<type> <data>] XXX, [<type>] XXX or [<type>
       (<data>)] XXX */
 
-// TODO: Duplicate.
-QStringList
-_parse_attrs(const QString& attrs_str)
-{
-  auto attrs = attrs_str.split(' ', Qt::SkipEmptyParts);
-
-  for (auto& item : attrs) {
-    if (item.front() == '\\') {
-      item.erase(item.begin());
-    }
-  }
-
-  return attrs;
-}
-
 }
 
 // TODO: complexity
 void
 imap_handle_select(const detail::IMAPResponse& resp,
                    const IMAP::ErrorCallback& error_handler,
-                   const IMAP::CommandCallback& success_handler)
+                   const IMAP::ResultCallback& success_handler)
 {
   if (resp.tagged().size() != 1) {
     error_handler(IMAP::E_UNEXPECTED, "Unexpected tagged response");
@@ -99,7 +85,7 @@ imap_handle_select(const detail::IMAPResponse& resp,
   for (const auto& item : resp.untagged()) {
     if (auto parsed = ATTRS_REG.match(item.second);
         item.first == IMAP::Response::FLAGS && parsed.hasMatch()) {
-      select_resp.flags = _parse_attrs(parsed.captured("attrs"));
+      select_resp.flags = FlagSet::parse(parsed.captured("attrs"));
     }
 
     if (auto parsed = SELECT_BRACKET_REG.match(item.second);
@@ -128,14 +114,31 @@ imap_handle_select(const detail::IMAPResponse& resp,
         continue;
       }
 
+      if (parsed.captured("type") == "HIGHESTMODSEQ" &&
+          parsed.hasCaptured("data")) {
+        bool ok = false;
+        auto modseq = parsed.captured("data").toULongLong(&ok);
+        if (!ok) {
+          qWarning()
+            << "Failed to parse SELECT HIGHESTMODSEQ response: Not a number.";
+          continue;
+        }
+        select_resp.highestmodseq = modseq;
+        continue;
+      }
+
       if (parsed.captured("type") == "PERMANENTFLAGS" &&
           parsed.hasCaptured("data")) {
-        select_resp.permanent_flags = _parse_attrs(parsed.captured("data"));
+        select_resp.permanent_flags = FlagSet::parse(parsed.captured("data"));
       }
     }
   }
 
-  success_handler(QVariant::fromValue(std::move(select_resp)));
+  // only sent when resynchronizing with QRESYNC.
+  select_resp.vanished = imap_parse_vanished(resp);
+  select_resp.changed = imap_parse_fetch(resp);
+
+  success_handler(std::move(select_resp));
 }
 
 }
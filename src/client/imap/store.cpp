@@ -0,0 +1,37 @@
+#include <functional>
+#include <qstring.h>
+#include <qvariant.h>
+
+#include "temail/client/imap.hpp"
+#include "temail/client/response.hpp"
+#include "temail/private/client/imap/fetch.hpp"
+#include "temail/private/client/imap/response.hpp"
+#include "temail/private/client/imap/store.hpp"
+
+namespace temail::client::detail {
+
+void
+imap_handle_uid_store(const detail::IMAPResponse& resp,
+                      const IMAP::ErrorCallback& error_handler,
+                      const IMAP::ResultCallback& success_handler)
+{
+  if (resp.tagged().size() != 1) {
+    error_handler(IMAP::E_UNEXPECTED, "Unexpected tagged response");
+    return;
+  }
+
+  if (resp.tagged()[0].first == IMAP::Response::NO) {
+    error_handler(IMAP::E_REFERENCE, resp.tagged()[0].second);
+    return;
+  }
+
+  if (resp.tagged()[0].first == IMAP::Response::BAD) {
+    error_handler(IMAP::E_BADCOMMAND, resp.tagged()[0].second);
+    return;
+  }
+
+  // updated flags are sent back as untagged FETCH.
+  success_handler(response::UidFetch{ 0, imap_parse_fetch(resp) });
+}
+
+}
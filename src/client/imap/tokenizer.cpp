@@ -0,0 +1,330 @@
+#include <algorithm>
+#include <limits>
+#include <qbytearray.h>
+#include <qdebug.h>
+#include <qlogging.h>
+#include <qtypes.h>
+
+#include "temail/private/client/imap/scanner.hpp"
+#include "temail/private/client/imap/tokenizer.hpp"
+
+namespace temail::client::detail {
+
+namespace {
+
+constexpr qint64 MAX_LITERAL_SIZE =
+  std::numeric_limits<qint64>::max() / 10; /**< Literal size guard. */
+
+TEMAIL_INLINE bool
+_is_digit(char ch)
+{
+  return ch >= '0' && ch <= '9';
+}
+
+}
+
+void
+IMAPTokenizer::feed(const QByteArray& data)
+{
+  if (_pos == _input.size()) {
+    _input = data;
+  } else {
+    _input.remove(0, _pos);
+    _input.append(data);
+  }
+  _pos = 0;
+}
+
+IMAPTokenizer::Token
+IMAPTokenizer::next()
+{
+  if (_state == State::ERROR) {
+    return Token::ERROR;
+  }
+
+  const auto* data = _input.constData();
+  const auto size = _input.size();
+
+  while (_pos < size) {
+    const auto ch = data[_pos];
+
+    switch (_state) {
+      case State::START:
+        if (ch == ' ') {
+          ++_pos;
+          break;
+        }
+
+        _value.clear();
+        if (ch == '\r') {
+          ++_pos;
+          _state = State::CR;
+        } else if (ch == '(') {
+          ++_pos;
+          return Token::LIST_BEGIN;
+        } else if (ch == ')') {
+          ++_pos;
+          return Token::LIST_END;
+        } else if (ch == '"') {
+          ++_pos;
+          _state = State::QUOTED;
+        } else if (ch == '{') {
+          ++_pos;
+          _literal_size = 0;
+          _state = State::LITERAL_SIZE;
+        } else {
+          _bracket = 0;
+          _state = State::ATOM;
+        }
+        break;
+
+      case State::CR:
+        if (ch != '\n') {
+          return _fail();
+        }
+        ++_pos;
+        _state = State::START;
+        return Token::CRLF;
+
+      case State::ATOM: {
+        auto begin = _pos;
+        while (_pos < size) {
+          // bracket sections such as `BODY[HEADER.FIELDS (DATE)]` may
+          // contain spaces and parens.
+          const auto* hit =
+            _bracket > 0
+              ? scan_any<']', '\r', '\n'>(data + _pos, data + size)
+              : scan_any<' ', '(', ')', '"', '{', '[', '\r', '\n'>(
+                  data + _pos, data + size);
+          _pos = hit - data;
+
+          if (_pos == size || (*hit != '[' && *hit != ']')) {
+            break;
+          }
+
+          _bracket += *hit == '[' ? 1 : -1;
+          ++_pos;
+        }
+        _value.append(data + begin, _pos - begin);
+
+        if (_pos == size) {
+          return Token::NONE;
+        }
+
+        if (_value.isEmpty()) {
+          return _fail();
+        }
+
+        _state = State::START;
+        return _value.compare("NIL", Qt::CaseInsensitive) == 0 ? Token::NIL
+                                                                : Token::ATOM;
+      }
+
+      case State::QUOTED: {
+        auto begin = _pos;
+        _pos = scan_any<'"', '\\', '\r'>(data + _pos, data + size) - data;
+        _value.append(data + begin, _pos - begin);
+
+        if (_pos == size) {
+          return Token::NONE;
+        }
+
+        const auto end = data[_pos++];
+        if (end == '"') {
+          _state = State::START;
+          return Token::QUOTED;
+        }
+
+        if (end == '\\') {
+          _state = State::QUOTED_ESCAPE;
+          break;
+        }
+
+        return _fail();
+      }
+
+      case State::QUOTED_ESCAPE:
+        _value.append(ch);
+        ++_pos;
+        _state = State::QUOTED;
+        break;
+
+      case State::LITERAL_SIZE:
+        ++_pos;
+        if (_is_digit(ch) && _literal_size < MAX_LITERAL_SIZE) {
+          _literal_size = _literal_size * 10 + (ch - '0');
+        } else if (ch == '}') {
+          _state = State::LITERAL_CR;
+        } else if (ch != '+' && ch != '-') {
+          return _fail();
+        }
+        break;
+
+      case State::LITERAL_CR:
+        if (ch != '\r') {
+          return _fail();
+        }
+        ++_pos;
+        _state = State::LITERAL_LF;
+        break;
+
+      case State::LITERAL_LF:
+        if (ch != '\n') {
+          return _fail();
+        }
+        ++_pos;
+
+        if (_literal_size == 0) {
+          _state = State::START;
+          return Token::LITERAL;
+        }
+
+        _state = State::LITERAL_DATA;
+        break;
+
+      case State::LITERAL_DATA: {
+        auto nbytes = std::min<qint64>(size - _pos, _literal_size);
+        if (_stream_literals) {
+          _value.clear();
+        }
+        _value.append(data + _pos, nbytes);
+        _pos += nbytes;
+        _literal_size -= nbytes;
+
+        if (_literal_size == 0) {
+          _state = State::START;
+          return Token::LITERAL;
+        }
+
+        if (_stream_literals) {
+          return Token::LITERAL_CHUNK;
+        }
+        break;
+      }
+
+      default:
+        return _fail();
+    }
+  }
+
+  return Token::NONE;
+}
+
+IMAPTokenizer::Token
+IMAPTokenizer::next_text()
+{
+  if (_state == State::ERROR) {
+    return Token::ERROR;
+  }
+
+  const auto* data = _input.constData();
+  const auto size = _input.size();
+
+  if (_state == State::START) {
+    _value.clear();
+    _state = State::TEXT;
+  }
+
+  while (_pos < size) {
+    switch (_state) {
+      case State::TEXT: {
+        if (_value.isEmpty()) {
+          while (_pos < size && data[_pos] == ' ') {
+            ++_pos;
+          }
+        }
+
+        auto begin = _pos;
+        _pos = scan_any<'\r'>(data + _pos, data + size) - data;
+        _value.append(data + begin, _pos - begin);
+
+        if (_pos == size) {
+          return Token::NONE;
+        }
+
+        ++_pos;
+        _state = State::TEXT_LF;
+        break;
+      }
+
+      case State::TEXT_LF:
+        if (data[_pos] != '\n') {
+          return _fail();
+        }
+        ++_pos;
+
+        if (_take_text_literal()) {
+          _value.append('"');
+          _state = State::TEXT_LITERAL;
+          break;
+        }
+
+        while (_value.endsWith(' ')) {
+          _value.chop(1);
+        }
+
+        _state = State::START;
+        return Token::TEXT;
+
+      case State::TEXT_LITERAL: {
+        while (_pos < size && _literal_size > 0) {
+          const auto ch = data[_pos++];
+          if (ch == '"' || ch == '\\') {
+            _value.append('\\');
+          }
+          _value.append(ch);
+          --_literal_size;
+        }
+
+        if (_literal_size == 0) {
+          _value.append('"');
+          _state = State::TEXT;
+        }
+        break;
+      }
+
+      default:
+        return _fail();
+    }
+  }
+
+  return Token::NONE;
+}
+
+IMAPTokenizer::Token
+IMAPTokenizer::_fail()
+{
+  qWarning() << "IMAP4 Client| Failed to tokenize response near:"
+             << _input.sliced(_pos);
+
+  _state = State::ERROR;
+  return Token::ERROR;
+}
+
+bool
+IMAPTokenizer::_take_text_literal()
+{
+  if (!_value.endsWith('}')) {
+    return false;
+  }
+
+  auto open = _value.lastIndexOf('{');
+  if (open < 0 || open + 2 >= _value.size()) {
+    return false;
+  }
+
+  qint64 literal_size = 0;
+  for (auto i = open + 1; i < _value.size() - 1; ++i) {
+    const auto ch = _value.at(i);
+    if (!_is_digit(ch) || literal_size >= MAX_LITERAL_SIZE) {
+      return false;
+    }
+    literal_size = literal_size * 10 + (ch - '0');
+  }
+
+  _value.truncate(open);
+  _literal_size = literal_size;
+  return true;
+}
+
+}
@@ -0,0 +1,293 @@
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <qdebug.h>
+#include <qlogging.h>
+#include <qstring.h>
+#include <qvariant.h>
+#include <utility>
+
+#include "temail/client/imap.hpp"
+#include "temail/client/pool.hpp"
+#include "temail/client/response.hpp"
+
+namespace temail::client {
+
+IMAPPool::IMAPPool(Account account,
+                   std::size_t max_connections,
+                   QObject* parent)
+  : QObject{ parent }
+  , _account{ std::move(account) }
+  , _max_connections{ std::max<std::size_t>(max_connections, 1) }
+{
+  // connections are referenced by index from callbacks, never reallocate.
+  _conns.reserve(_max_connections);
+}
+
+IMAPPool::~IMAPPool()
+{
+  // clients logout on destruction, keep their signals off the pool.
+  for (auto& conn : _conns) {
+    disconnect(conn.client, nullptr, this, nullptr);
+    delete conn.client;
+  }
+}
+
+void
+IMAPPool::submit(const QString& mailbox,
+                 const Job& job,
+                 const ErrorCallback& error)
+{
+  _pending.push_back(Pending{ mailbox, job, error });
+  _dispatch();
+}
+
+void
+IMAPPool::fetch(const QStringList& mailboxes,
+                request::Fetch::FieldFlags field,
+                const Callback<MailboxFetch>& callback,
+                const ErrorCallback& error)
+{
+  if (mailboxes.isEmpty()) {
+    callback({});
+    return;
+  }
+
+  struct State
+  {
+    MailboxFetch results;
+    qsizetype left;
+  };
+
+  auto state = std::make_shared<State>(State{ {}, mailboxes.size() });
+  auto finish = [state, callback] {
+    if (--state->left == 0) {
+      callback(std::move(state->results));
+    }
+  };
+
+  for (const auto& mailbox : mailboxes) {
+    submit(
+      mailbox,
+      [state, mailbox, field, finish](IMAP& client, const Release& release) {
+        client.uid_fetch(
+          1,
+          field,
+          0,
+          [state, mailbox, release, finish](response::UidFetch&& data) {
+            state->results.insert(mailbox, std::move(data));
+            release();
+            finish();
+          });
+      },
+      [mailbox, error, finish](ErrorType type, const QString& estr) {
+        if (error) {
+          error(type, QString{ "%1: %2" }.arg(mailbox).arg(estr));
+        }
+        finish();
+      });
+  }
+}
+
+void
+IMAPPool::_dispatch()
+{
+  for (std::size_t i = 0; i < _conns.size() && !_pending.empty(); ++i) {
+    auto& conn = _conns[i];
+    if (conn.busy || !conn.ready) {
+      continue;
+    }
+
+    // prefer a job for the selected mailbox, it saves a SELECT.
+    auto it = std::find_if(
+      _pending.begin(), _pending.end(), [&conn](const Pending& pending) {
+        return pending.mailbox == conn.mailbox;
+      });
+    if (it == _pending.end()) {
+      it = _pending.begin();
+    }
+
+    auto pending = std::move(*it);
+    _pending.erase(it);
+    _run(i, std::move(pending));
+  }
+
+  // busy connections will free up, but more connections mean parallelism.
+  auto opening = static_cast<std::size_t>(
+    std::count_if(_conns.begin(), _conns.end(), [](const Connection& conn) {
+      return conn.busy && !conn.ready;
+    }));
+
+  for (std::size_t i = 0; i < _conns.size() && _pending.size() > opening;
+       ++i) {
+    if (!_conns[i].busy && !_conns[i].ready) {
+      _open(i);
+      ++opening;
+    }
+  }
+
+  while (_pending.size() > opening && _conns.size() < _max_connections) {
+    _conns.emplace_back();
+    _open(_conns.size() - 1);
+    ++opening;
+  }
+}
+
+void
+IMAPPool::_open(std::size_t index)
+{
+  auto& conn = _conns[index];
+  conn.busy = true;
+  conn.ready = false;
+  conn.mailbox.clear();
+
+  if (conn.client == nullptr) {
+    conn.client = new IMAP{ this };
+
+    connect(conn.client,
+            &Base::error_occurred,
+            this,
+            [this, index](ErrorType error, const QString& estr) {
+              _on_error(index, error, estr);
+            });
+
+    // pending commands are failed without `error_occurred` on close.
+    connect(conn.client, &Base::disconnected, this, [this, index] {
+      if (_conns[index].busy) {
+        _on_error(index, Base::E_INTERNAL, "Connection closed");
+      }
+      _conns[index].ready = false;
+      _conns[index].mailbox.clear();
+    });
+  }
+
+  auto login = [this, index] {
+    _conns[index].client->login(
+      _account.username,
+      _account.password,
+      [this, index](response::Login&& /*data*/) {
+        _conns[index].ready = true;
+        _conns[index].busy = false;
+        _dispatch();
+      });
+  };
+
+  if (conn.client->is_connected()) {
+    login();
+    return;
+  }
+
+  conn.client->connect_to_host(_account.url,
+                               _account.port,
+                               _account.ssl,
+                               [login](const QVariant& /*data*/) { login(); });
+}
+
+void
+IMAPPool::_run(std::size_t index, Pending&& pending)
+{
+  auto& conn = _conns[index];
+  conn.busy = true;
+  conn.error = std::move(pending.error);
+
+  auto generation = conn.generation;
+  auto* client = conn.client;
+  auto release = [this, index, generation] { _release(index, generation); };
+
+  if (pending.mailbox.isEmpty() || pending.mailbox == conn.mailbox) {
+    pending.job(*client, release);
+    return;
+  }
+
+  client->select(pending.mailbox,
+                 [this,
+                  index,
+                  generation,
+                  client,
+                  release,
+                  mailbox = pending.mailbox,
+                  job = std::move(pending.job)](response::Select&& /*data*/) {
+                   if (_conns[index].generation != generation) {
+                     return;
+                   }
+                   _conns[index].mailbox = mailbox;
+                   job(*client, release);
+                 });
+}
+
+void
+IMAPPool::_release(std::size_t index, std::size_t generation)
+{
+  auto& conn = _conns[index];
+  if (!conn.busy || conn.generation != generation) {
+    return;
+  }
+
+  ++conn.generation;
+  conn.busy = false;
+  conn.error = {};
+
+  _dispatch();
+}
+
+void
+IMAPPool::_on_error(std::size_t index, ErrorType error, const QString& estr)
+{
+  auto& conn = _conns[index];
+  auto opening = conn.busy && !conn.ready;
+
+  // transport errors always mean the connection is unavailable.
+  if (error == Base::E_INTERNAL) {
+    conn.ready = false;
+  }
+
+  if (!conn.busy) {
+    conn.mailbox.clear();
+    return;
+  }
+
+  if (opening) {
+    qWarning() << "IMAP4 Pool: Failed to open connection:" << estr;
+    conn.busy = false;
+
+    // nothing else is left to serve the queue.
+    if (std::none_of(_conns.begin(), _conns.end(), [](const Connection& c) {
+          return c.ready || c.busy;
+        })) {
+      _fail_pending(error, estr);
+    }
+    return;
+  }
+
+  // selected mailbox is unknown after a failed job.
+  auto callback = std::move(conn.error);
+  conn.error = {};
+  conn.mailbox.clear();
+  conn.busy = false;
+  ++conn.generation;
+
+  if (callback) {
+    callback(error, estr);
+  } else {
+    qWarning() << "IMAP4 Pool: Job failed:" << estr;
+  }
+
+  _dispatch();
+}
+
+void
+IMAPPool::_fail_pending(ErrorType error, const QString& estr)
+{
+  auto pending = std::move(_pending);
+  _pending.clear();
+
+  for (const auto& item : pending) {
+    if (item.error) {
+      item.error(error, estr);
+    } else {
+      qWarning() << "IMAP4 Pool: Job dropped:" << estr;
+    }
+  }
+}
+
+}
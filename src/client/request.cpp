@@ -0,0 +1,455 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <qdatetime.h>
+#include <qstring.h>
+#include <utility>
+
+#include "temail/client/request.hpp"
+#include "temail/client/sequence.hpp"
+#include "temail/common.hpp"
+
+namespace temail::client::request {
+
+/**
+ * @brief Search query node, leaves keep their key and its serialized form.
+ *
+ */
+struct SearchQuery::Node
+{
+  enum Kind : uint8_t
+  {
+    KEY, /**< Search key such as `SINCE 1-Jan-2025`. */
+    AND, /**< Both operands. */
+    OR,  /**< Any operand. */
+    NOT, /**< Negated `lhs`. */
+  };
+
+  Kind kind{ KEY };
+  Key key;
+  QString str;
+  bool utf8{ false };    /**< Any string in the subtree is not ASCII. */
+  bool literal{ false }; /**< Any string in the subtree is a literal. */
+  std::shared_ptr<const Node> lhs;
+  std::shared_ptr<const Node> rhs;
+};
+
+namespace {
+
+// indexed by `SearchQuery::Key::Type`, criteria and ids have no keyword.
+constexpr std::array<const char*, 17> KEY_NAMES{
+  "",       "SINCE",  "BEFORE",  "ON",     "SENTSINCE", "SENTBEFORE",
+  "SENTON", "LARGER", "SMALLER", "HEADER", "FROM",      "TO",
+  "SUBJECT", "BODY",  "TEXT",    "UID",    "",
+};
+
+static_assert(KEY_NAMES.size() == SearchQuery::Key::IDS + 1);
+
+bool
+_ascii(const QString& value)
+{
+  return std::all_of(value.cbegin(), value.cend(), [](QChar ch) {
+    return ch.unicode() < 0x80;
+  });
+}
+
+/**
+ * @brief Check if a string can not be quoted, quoted strings are 7-bit and
+ * cannot span lines (RFC 3501).
+ *
+ */
+bool
+_needs_literal(const QString& value)
+{
+  return std::any_of(value.cbegin(), value.cend(), [](QChar ch) {
+    return ch.unicode() >= 0x80 || ch == '\r' || ch == '\n' ||
+           ch.unicode() == 0;
+  });
+}
+
+// strings which cannot be quoted are sent as non-synchronizing literals,
+// sized in UTF-8 bytes as the command is encoded.
+void
+_append_string(QString& out, const QString& value)
+{
+  if (_needs_literal(value)) {
+    out.append(QString{ "{%1+}\r\n" }.arg(value.toUtf8().size()));
+    out.append(value);
+    return;
+  }
+
+  out.append('"');
+  for (auto ch : value) {
+    if (ch == '"' || ch == '\\') {
+      out.append('\\');
+    }
+    out.append(ch);
+  }
+  out.append('"');
+}
+
+SearchQuery::Key
+_date_key(SearchQuery::Key::Type type, const QDate& date)
+{
+  auto key = SearchQuery::Key{ type };
+  key.date = date;
+  return key;
+}
+
+SearchQuery::Key
+_size_key(SearchQuery::Key::Type type, qint64 size)
+{
+  auto key = SearchQuery::Key{ type };
+  key.size = size;
+  return key;
+}
+
+SearchQuery::Key
+_string_key(SearchQuery::Key::Type type, const QString& value)
+{
+  auto key = SearchQuery::Key{ type };
+  key.value = value;
+  return key;
+}
+
+SearchQuery::Key
+_set_key(SearchQuery::Key::Type type, const SequenceSet& ids)
+{
+  auto key = SearchQuery::Key{ type };
+  key.ids = ids;
+  return key;
+}
+
+}
+
+SearchQuery::SearchQuery(Search::Criteria criteria)
+  : SearchQuery{ _leaf(Key{ Key::CRITERIA, criteria }) }
+{
+}
+
+SearchQuery::SearchQuery(std::shared_ptr<const Node> node)
+  : _node{ std::move(node) }
+{
+}
+
+SearchQuery
+SearchQuery::since(const QDate& date)
+{
+  return _leaf(_date_key(Key::SINCE, date));
+}
+
+SearchQuery
+SearchQuery::before(const QDate& date)
+{
+  return _leaf(_date_key(Key::BEFORE, date));
+}
+
+SearchQuery
+SearchQuery::on(const QDate& date)
+{
+  return _leaf(_date_key(Key::ON, date));
+}
+
+SearchQuery
+SearchQuery::sent_since(const QDate& date)
+{
+  return _leaf(_date_key(Key::SENT_SINCE, date));
+}
+
+SearchQuery
+SearchQuery::sent_before(const QDate& date)
+{
+  return _leaf(_date_key(Key::SENT_BEFORE, date));
+}
+
+SearchQuery
+SearchQuery::sent_on(const QDate& date)
+{
+  return _leaf(_date_key(Key::SENT_ON, date));
+}
+
+SearchQuery
+SearchQuery::larger(qint64 size)
+{
+  return _leaf(_size_key(Key::LARGER, size));
+}
+
+SearchQuery
+SearchQuery::smaller(qint64 size)
+{
+  return _leaf(_size_key(Key::SMALLER, size));
+}
+
+SearchQuery
+SearchQuery::header(const QString& field, const QString& value)
+{
+  auto key = _string_key(Key::HEADER, value);
+  key.field = field;
+  return _leaf(std::move(key));
+}
+
+SearchQuery
+SearchQuery::from(const QString& value)
+{
+  return _leaf(_string_key(Key::FROM, value));
+}
+
+SearchQuery
+SearchQuery::to(const QString& value)
+{
+  return _leaf(_string_key(Key::TO, value));
+}
+
+SearchQuery
+SearchQuery::subject(const QString& value)
+{
+  return _leaf(_string_key(Key::SUBJECT, value));
+}
+
+SearchQuery
+SearchQuery::body(const QString& value)
+{
+  return _leaf(_string_key(Key::BODY, value));
+}
+
+SearchQuery
+SearchQuery::text(const QString& value)
+{
+  return _leaf(_string_key(Key::TEXT, value));
+}
+
+SearchQuery
+SearchQuery::uid(const SequenceSet& uids)
+{
+  return _leaf(_set_key(Key::UID, uids));
+}
+
+SearchQuery
+SearchQuery::ids(const SequenceSet& ids)
+{
+  return _leaf(_set_key(Key::IDS, ids));
+}
+
+SearchQuery
+SearchQuery::operator&&(const SearchQuery& other) const
+{
+  // ALL matches everything, it only lengthens the command.
+  if (_all()) {
+    return other;
+  }
+
+  if (other._all()) {
+    return *this;
+  }
+
+  return _branch(Node::AND, _node, other._node);
+}
+
+SearchQuery
+SearchQuery::operator||(const SearchQuery& other) const
+{
+  return _branch(Node::OR, _node, other._node);
+}
+
+SearchQuery
+SearchQuery::operator!() const
+{
+  return _branch(Node::NOT, _node, nullptr);
+}
+
+bool
+SearchQuery::utf8() const
+{
+  return _node->utf8;
+}
+
+bool
+SearchQuery::literal() const
+{
+  return _node->literal;
+}
+
+void
+SearchQuery::write(QString& out) const
+{
+  _write(out, *_node, false);
+}
+
+QString
+SearchQuery::to_string() const
+{
+  auto out = QString{};
+  write(out);
+  return out;
+}
+
+bool
+SearchQuery::evaluate(const KeyPredicate& match) const
+{
+  return _evaluate(*_node, match);
+}
+
+bool
+SearchQuery::all_of(const KeyPredicate& pred) const
+{
+  return _all_of(*_node, pred);
+}
+
+SearchQuery
+SearchQuery::_leaf(Key key)
+{
+  auto str = QString{};
+  auto utf8 = false;
+  auto literal = false;
+
+  switch (key.type) {
+    case Key::CRITERIA:
+      str = common::enum_name(key.criteria);
+      break;
+
+    // month names of format strings are always English.
+    case Key::SINCE:
+    case Key::BEFORE:
+    case Key::ON:
+    case Key::SENT_SINCE:
+    case Key::SENT_BEFORE:
+    case Key::SENT_ON:
+      str = QString{ "%1 %2" }
+              .arg(KEY_NAMES[key.type])
+              .arg(key.date.toString("d-MMM-yyyy"));
+      break;
+
+    case Key::LARGER:
+    case Key::SMALLER:
+      str = QString{ "%1 %2" }.arg(KEY_NAMES[key.type]).arg(key.size);
+      break;
+
+    case Key::HEADER:
+      str = KEY_NAMES[key.type];
+      str.append(' ');
+      _append_string(str, key.field);
+      str.append(' ');
+      _append_string(str, key.value);
+      utf8 = !_ascii(key.field) || !_ascii(key.value);
+      literal = _needs_literal(key.field) || _needs_literal(key.value);
+      break;
+
+    case Key::FROM:
+    case Key::TO:
+    case Key::SUBJECT:
+    case Key::BODY:
+    case Key::TEXT:
+      str = KEY_NAMES[key.type];
+      str.append(' ');
+      _append_string(str, key.value);
+      utf8 = !_ascii(key.value);
+      literal = _needs_literal(key.value);
+      break;
+
+    case Key::UID:
+      str = QString{ "UID %1" }.arg(key.ids.to_string());
+      break;
+
+    case Key::IDS:
+      str = key.ids.to_string();
+      break;
+  }
+
+  return SearchQuery{ std::make_shared<const Node>(Node{ Node::KEY,
+                                                        std::move(key),
+                                                        std::move(str),
+                                                        utf8,
+                                                        literal,
+                                                        nullptr,
+                                                        nullptr }) };
+}
+
+SearchQuery
+SearchQuery::_branch(uint8_t kind,
+                     std::shared_ptr<const Node> lhs,
+                     std::shared_ptr<const Node> rhs)
+{
+  auto utf8 = lhs->utf8 || (rhs != nullptr && rhs->utf8);
+  auto literal = lhs->literal || (rhs != nullptr && rhs->literal);
+  return SearchQuery{ std::make_shared<const Node>(
+    Node{ static_cast<Node::Kind>(kind),
+          {},
+          {},
+          utf8,
+          literal,
+          std::move(lhs),
+          std::move(rhs) }) };
+}
+
+bool
+SearchQuery::_all() const
+{
+  return _node->kind == Node::KEY && _node->key.type == Key::CRITERIA &&
+         _node->key.criteria == Search::ALL;
+}
+
+void
+SearchQuery::_write(QString& out, const Node& node, bool nested)
+{
+  switch (node.kind) {
+    case Node::KEY:
+      out.append(node.str);
+      break;
+
+    // keys are ANDed by juxtaposition, parens group them as an operand.
+    case Node::AND:
+      if (nested) {
+        out.append('(');
+      }
+      _write(out, *node.lhs, false);
+      out.append(' ');
+      _write(out, *node.rhs, false);
+      if (nested) {
+        out.append(')');
+      }
+      break;
+
+    case Node::OR:
+      out.append("OR ");
+      _write(out, *node.lhs, true);
+      out.append(' ');
+      _write(out, *node.rhs, true);
+      break;
+
+    case Node::NOT:
+      out.append("NOT ");
+      _write(out, *node.lhs, true);
+      break;
+  }
+}
+
+bool
+SearchQuery::_evaluate(const Node& node, const KeyPredicate& match)
+{
+  switch (node.kind) {
+    case Node::KEY:
+      return match(node.key);
+    case Node::AND:
+      return _evaluate(*node.lhs, match) && _evaluate(*node.rhs, match);
+    case Node::OR:
+      return _evaluate(*node.lhs, match) || _evaluate(*node.rhs, match);
+    case Node::NOT:
+      return !_evaluate(*node.lhs, match);
+  }
+
+  return false;
+}
+
+bool
+SearchQuery::_all_of(const Node& node, const KeyPredicate& pred)
+{
+  if (node.kind == Node::KEY) {
+    return pred(node.key);
+  }
+
+  return _all_of(*node.lhs, pred) &&
+         (node.rhs == nullptr || _all_of(*node.rhs, pred));
+}
+
+}
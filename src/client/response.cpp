@@ -0,0 +1,328 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <qbytearray.h>
+#include <qbytearrayview.h>
+#include <qdatetime.h>
+#include <qstring.h>
+#include <qstringconverter.h>
+#include <qtimezone.h>
+
+#include "temail/client/response.hpp"
+
+namespace temail::client::response {
+
+namespace {
+
+/**
+ * @brief Decoded RFC 2047 encoded word.
+ *
+ */
+struct EncodedWord
+{
+  qsizetype end{ 0 }; /**< Position after `?=`. */
+  QString text;
+};
+
+QByteArray
+_decode_q(QByteArrayView text)
+{
+  auto bytes = QByteArray{};
+  bytes.reserve(text.size());
+
+  for (qsizetype i = 0; i < text.size(); ++i) {
+    auto ch = text.at(i);
+    if (ch == '_') {
+      bytes.append(' ');
+    } else if (ch == '=' && i + 2 < text.size()) {
+      auto ok = false;
+      auto byte = text.sliced(i + 1, 2).toByteArray().toUInt(&ok, 16);
+      if (ok) {
+        bytes.append(static_cast<char>(byte));
+        i += 2;
+      } else {
+        bytes.append(ch);
+      }
+    } else {
+      bytes.append(ch);
+    }
+  }
+
+  return bytes;
+}
+
+/**
+ * @brief Parse `=?charset?encoding?text?=` starting at `begin`.
+ *
+ */
+std::optional<EncodedWord>
+_decode_word(QByteArrayView value, qsizetype begin)
+{
+  auto charset_end = value.indexOf('?', begin + 2);
+  if (charset_end < 0) {
+    return std::nullopt;
+  }
+
+  auto encoding_end = value.indexOf('?', charset_end + 1);
+  if (encoding_end != charset_end + 2) {
+    return std::nullopt;
+  }
+
+  auto end = value.indexOf("?=", encoding_end + 1);
+  if (end < 0) {
+    return std::nullopt;
+  }
+
+  // RFC 2231 allows a language suffix such as `utf-8*en`.
+  auto charset =
+    value.sliced(begin + 2, charset_end - begin - 2).toByteArray();
+  if (auto star = charset.indexOf('*'); star >= 0) {
+    charset.truncate(star);
+  }
+
+  auto text = value.sliced(encoding_end + 1, end - encoding_end - 1);
+  auto bytes = QByteArray{};
+  switch (value.at(charset_end + 1)) {
+    case 'B':
+    case 'b':
+      bytes = QByteArray::fromBase64(text.toByteArray());
+      break;
+    case 'Q':
+    case 'q':
+      bytes = _decode_q(text);
+      break;
+    default:
+      return std::nullopt;
+  }
+
+  auto decoder = QStringDecoder{ charset.constData() };
+  if (!decoder.isValid()) {
+    return EncodedWord{ end + 2, QString::fromLatin1(bytes) };
+  }
+
+  return EncodedWord{ end + 2, decoder.decode(bytes) };
+}
+
+/**
+ * @brief Find parameter such as `charset=utf-8` of a structured field.
+ *
+ */
+QByteArray
+_parameter(QByteArrayView value, QByteArrayView name)
+{
+  qsizetype pos = value.indexOf(';');
+  while (pos >= 0) {
+    auto next = value.indexOf(';', pos + 1);
+    auto end = next < 0 ? value.size() : next;
+    auto param = value.sliced(pos + 1, end - pos - 1).trimmed();
+    pos = next;
+
+    auto eq = param.indexOf('=');
+    if (eq < 0 ||
+        param.first(eq).trimmed().compare(name, Qt::CaseInsensitive) != 0) {
+      continue;
+    }
+
+    auto result = param.sliced(eq + 1).trimmed();
+    if (result.size() >= 2 && result.front() == '"' && result.back() == '"') {
+      result = result.sliced(1, result.size() - 2);
+    }
+    return result.toByteArray();
+  }
+
+  return {};
+}
+
+}
+
+QByteArray
+FetchHeader::field(QByteArrayView name) const
+{
+  auto raw = QByteArrayView{ _raw };
+
+  // yields the next line without CRLF.
+  qsizetype pos = 0;
+  auto next_line = [&raw, &pos] {
+    auto eol = raw.indexOf('\n', pos);
+    if (eol < 0) {
+      eol = raw.size();
+    }
+    auto line = raw.sliced(pos, eol - pos);
+    pos = eol + 1;
+    if (line.endsWith('\r')) {
+      line.chop(1);
+    }
+    return line;
+  };
+
+  while (pos < raw.size()) {
+    auto line = next_line();
+
+    auto colon = line.indexOf(':');
+    if (colon < 0 ||
+        line.first(colon).trimmed().compare(name, Qt::CaseInsensitive) != 0) {
+      continue;
+    }
+
+    auto value = line.sliced(colon + 1).trimmed().toByteArray();
+
+    // folded lines start with white space.
+    while (pos < raw.size() && (raw.at(pos) == ' ' || raw.at(pos) == '\t')) {
+      value.append(' ');
+      value.append(next_line().trimmed());
+    }
+
+    return value;
+  }
+
+  return {};
+}
+
+QString
+FetchHeader::decode(QByteArrayView value)
+{
+  auto result = QString{};
+  auto encoded = false;
+
+  qsizetype pos = 0;
+  while (pos < value.size()) {
+    auto begin = value.indexOf("=?", pos);
+    if (begin < 0) {
+      result.append(QString::fromUtf8(value.sliced(pos)));
+      break;
+    }
+
+    auto word = _decode_word(value, begin);
+    if (!word) {
+      result.append(QString::fromUtf8(value.sliced(pos, begin + 2 - pos)));
+      pos = begin + 2;
+      encoded = false;
+      continue;
+    }
+
+    // white space between adjacent encoded words is not displayed.
+    auto gap = value.sliced(pos, begin - pos);
+    if (!encoded || !gap.trimmed().isEmpty()) {
+      result.append(QString::fromUtf8(gap));
+    }
+
+    result.append(word->text);
+    pos = word->end;
+    encoded = true;
+  }
+
+  return result;
+}
+
+QDateTime
+FetchEnvelope::date() const
+{
+  auto value = QString::fromLatin1(field("Date"));
+
+  // trailing comments such as `(UTC)` are not accepted by Qt.
+  if (auto comment = value.indexOf('('); comment >= 0) {
+    value.truncate(comment);
+  }
+
+  return QDateTime::fromString(value.trimmed(), Qt::RFC2822Date);
+}
+
+QString
+FetchEnvelope::from() const
+{
+  return decode(field("From"));
+}
+
+QString
+FetchEnvelope::to() const
+{
+  return decode(field("To"));
+}
+
+QString
+FetchEnvelope::subject() const
+{
+  return decode(field("Subject"));
+}
+
+QString
+FetchContentType::content_type() const
+{
+  auto value = field("Content-Type");
+  if (auto semi = value.indexOf(';'); semi >= 0) {
+    value.truncate(semi);
+  }
+
+  return QString::fromLatin1(value.trimmed()).toLower();
+}
+
+QString
+FetchContentType::charset() const
+{
+  return QString::fromLatin1(_parameter(field("Content-Type"), "charset"))
+    .toLower();
+}
+
+void
+Envelopes::reserve(std::size_t count)
+{
+  _uids.reserve(count);
+  _dates.reserve(count);
+  _from.reserve(count);
+  _to.reserve(count);
+  _subjects.reserve(count + 1);
+  _sizes.reserve(count);
+  _flags.reserve(count);
+}
+
+void
+Envelopes::append(uint32_t uid,
+                  const FetchEnvelope& envelope,
+                  std::size_t size,
+                  FlagSet::Flags flags)
+{
+  auto date = envelope.date();
+
+  _uids.push_back(uid);
+  _dates.push_back(date.isValid() ? date.toMSecsSinceEpoch() : NO_DATE);
+  _from.push_back(_intern(envelope.from()));
+  _to.push_back(_intern(envelope.to()));
+  _arena.append(envelope.subject());
+  _subjects.push_back(static_cast<uint32_t>(_arena.size()));
+  _sizes.push_back(static_cast<uint32_t>(
+    std::min<std::size_t>(size, std::numeric_limits<uint32_t>::max())));
+  _flags.push_back(
+    static_cast<uint8_t>((flags & FlagSet::SYSTEM_FLAGS).toInt()));
+}
+
+QDateTime
+Envelopes::date(std::size_t index) const
+{
+  if (_dates[index] == NO_DATE) {
+    return {};
+  }
+
+  return QDateTime::fromMSecsSinceEpoch(_dates[index], QTimeZone::UTC);
+}
+
+uint32_t
+Envelopes::_intern(const QString& value)
+{
+  if (value.isEmpty()) {
+    return 0;
+  }
+
+  auto it = _interned.constFind(value);
+  if (it != _interned.cend()) {
+    return *it;
+  }
+
+  auto index = static_cast<uint32_t>(_strings.size());
+  _strings.append(value);
+  _interned.insert(value, index);
+  return index;
+}
+
+}
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <qstring.h>
+#include <qstringview.h>
+#include <utility>
+
+#include "temail/client/sequence.hpp"
+
+namespace temail::client {
+
+namespace {
+
+TEMAIL_INLINE uint64_t
+_next(SequenceSet::Id id)
+{
+  // `LAST + 1` must not wrap to 0.
+  return static_cast<uint64_t>(id) + 1;
+}
+
+TEMAIL_INLINE void
+_append_id(QString& str, SequenceSet::Id id)
+{
+  if (id == SequenceSet::LAST) {
+    str.append('*');
+  } else {
+    str.append(QString::number(id));
+  }
+}
+
+bool
+_parse_id(QStringView str, SequenceSet::Id& id)
+{
+  if (str == u"*") {
+    id = SequenceSet::LAST;
+    return true;
+  }
+
+  auto ok = false;
+  id = str.toUInt(&ok);
+  return ok && id != 0;
+}
+
+}
+
+SequenceSet::SequenceSet(Id first, Id last)
+{
+  insert(first, last);
+}
+
+void
+SequenceSet::insert(Id first, Id last)
+{
+  if (first > last) {
+    std::swap(first, last);
+  }
+
+  // search results and fetch responses arrive in ascending order.
+  if (_ranges.isEmpty() || first > _next(_ranges.last().last)) {
+    _ranges.append(Range{ first, last });
+    return;
+  }
+
+  if (auto& back = _ranges.last(); first >= back.first) {
+    back.last = std::max(back.last, last);
+    return;
+  }
+
+  // ranges in [lo, hi) overlap or touch the new range.
+  auto lo = std::lower_bound(
+    _ranges.cbegin(), _ranges.cend(), first, [](const Range& range, Id id) {
+      return _next(range.last) < id;
+    });
+  auto hi = std::upper_bound(
+    lo, _ranges.cend(), last, [](Id id, const Range& range) {
+      return _next(id) < range.first;
+    });
+
+  auto index = lo - _ranges.cbegin();
+  auto count = hi - lo;
+
+  if (count == 0) {
+    _ranges.insert(index, Range{ first, last });
+    return;
+  }
+
+  auto& merged = _ranges[index];
+  merged.first = std::min(merged.first, first);
+  merged.last = std::max(_ranges[index + count - 1].last, last);
+  _ranges.remove(index + 1, count - 1);
+}
+
+void
+SequenceSet::insert(const SequenceSet& other)
+{
+  if (other.empty()) {
+    return;
+  }
+
+  if (empty()) {
+    _ranges = other._ranges;
+    return;
+  }
+
+  if (other.front() > _next(back())) {
+    _ranges.append(other._ranges);
+    return;
+  }
+
+  for (const auto& range : other._ranges) {
+    insert(range.first, range.last);
+  }
+}
+
+void
+SequenceSet::remove(Id first, Id last)
+{
+  if (first > last) {
+    std::swap(first, last);
+  }
+
+  // ranges in [lo, hi) overlap the removed range.
+  auto lo = std::lower_bound(
+    _ranges.cbegin(), _ranges.cend(), first, [](const Range& range, Id id) {
+      return range.last < id;
+    });
+  auto hi = std::upper_bound(
+    lo, _ranges.cend(), last, [](Id id, const Range& range) {
+      return id < range.first;
+    });
+
+  auto index = lo - _ranges.cbegin();
+  auto count = hi - lo;
+  if (count == 0) {
+    return;
+  }
+
+  auto head = _ranges[index];
+  auto tail = _ranges[index + count - 1];
+  _ranges.remove(index, count);
+
+  // ends of the outer ranges survive.
+  if (tail.last > last) {
+    _ranges.insert(index, Range{ last + 1, tail.last });
+  }
+
+  if (head.first < first) {
+    _ranges.insert(index, Range{ head.first, first - 1 });
+  }
+}
+
+void
+SequenceSet::remove(const SequenceSet& other)
+{
+  for (const auto& range : other._ranges) {
+    if (empty()) {
+      return;
+    }
+    remove(range.first, range.last);
+  }
+}
+
+bool
+SequenceSet::contains(Id id) const
+{
+  auto it = std::upper_bound(
+    _ranges.cbegin(), _ranges.cend(), id, [](Id value, const Range& range) {
+      return value < range.first;
+    });
+
+  return it != _ranges.cbegin() && std::prev(it)->last >= id;
+}
+
+std::size_t
+SequenceSet::size() const
+{
+  auto count = std::size_t{ 0 };
+  for (const auto& range : _ranges) {
+    count += range.size();
+  }
+  return count;
+}
+
+QString
+SequenceSet::to_string() const
+{
+  auto str = QString{};
+  str.reserve(_ranges.size() * 12);
+
+  for (const auto& range : _ranges) {
+    if (!str.isEmpty()) {
+      str.append(',');
+    }
+
+    _append_id(str, range.first);
+    if (range.last != range.first) {
+      str.append(':');
+      _append_id(str, range.last);
+    }
+  }
+
+  return str;
+}
+
+SequenceSet
+SequenceSet::parse(QStringView set)
+{
+  auto parsed = SequenceSet{};
+
+  for (auto item : set.split(',', Qt::SkipEmptyParts)) {
+    auto colon = item.indexOf(':');
+    auto first = Id{ 0 };
+    auto last = Id{ 0 };
+
+    if (!_parse_id(item.first(colon < 0 ? item.size() : colon), first)) {
+      continue;
+    }
+
+    if (colon < 0) {
+      last = first;
+    } else if (!_parse_id(item.sliced(colon + 1), last)) {
+      continue;
+    }
+
+    parsed.insert(first, last);
+  }
+
+  return parsed;
+}
+
+}
@@ -1,27 +1,52 @@
+#include <array>
+#include <charconv>
+#include <optional>
+#include <qbytearray.h>
 #include <qstring.h>
 #include <random>
+#include <system_error>
 
 #include "temail/tag.hpp"
 
 namespace temail {
 
 QString
-TagGenerator::generate()
+TagGenerator::label() const
 {
-  auto index = _idx;
-  ++_idx;
+  return QString{ "%1XXX" }.arg(_tag);
+}
 
-  if (_idx > MAX_TAG_INDEX) {
-    _idx = 0;
+void
+TagGenerator::write(QByteArray& out, char prefix, Tag tag)
+{
+  auto buffer = std::array<char, MAX_TAG_LENGTH>{};
+  buffer[0] = prefix;
+
+  auto [end, ec] = std::to_chars(
+    buffer.data() + 1, buffer.data() + buffer.size(), tag, TAG_BASE);
+  if (ec != std::errc{}) {
+    return;
   }
 
-  return QString{ "%1%2" }.arg(_tag).arg(index, 3, TAG_BASE, '0');
+  out.append(buffer.data(), end - buffer.data());
 }
 
-QString
-TagGenerator::label() const
+std::optional<TagGenerator::Tag>
+TagGenerator::parse(char prefix, const QByteArray& data)
 {
-  return QString{ "%1XXX" }.arg(_tag);
+  if (data.size() < 2 || data.front() != prefix) {
+    return std::nullopt;
+  }
+
+  const auto* end = data.constData() + data.size();
+
+  Tag tag = 0;
+  auto [ptr, ec] = std::from_chars(data.constData() + 1, end, tag, TAG_BASE);
+  if (ec != std::errc{} || ptr != end) {
+    return std::nullopt;
+  }
+
+  return tag;
 }
 
 }
@@ -0,0 +1,128 @@
+#include <cstddef>
+#include <qbytearray.h>
+#include <qelapsedtimer.h>
+#include <qstring.h>
+#include <qtest.h>
+#include <qtestcase.h>
+#include <temail/client/imap.hpp>
+#include <temail/common.hpp>
+
+#include "bench_imap.hpp"
+#include "temail/private/client/imap/keyword.hpp"
+#include "temail/private/client/imap/response.hpp"
+#include "temail/private/client/imap/scanner.hpp"
+
+void
+IMAPBench::initTestCase() // NOLINT
+{
+  const auto header = QByteArray{ "Date: Sat, 02 Aug 2025 10:00:00 +0800\r\n"
+                                  "Subject: Benchmark mail\r\n"
+                                  "From: sender@example.com\r\n"
+                                  "To: receiver@example.com\r\n\r\n" };
+
+  for (int i = 1; i <= FETCH_COUNT; ++i) {
+    _transcript.append(QString{ "* %1 FETCH (BODY[HEADER.FIELDS (DATE SUBJECT "
+                                "FROM TO)] {%2}\r\n" }
+                         .arg(i)
+                         .arg(header.size())
+                         .toLatin1());
+    _transcript.append(header);
+    _transcript.append(")\r\n");
+    _keywords.append("FETCH");
+  }
+
+  _transcript.append("A0 OK FETCH completed\r\n");
+  _keywords.append("OK");
+}
+
+void
+IMAPBench::bench_keyword_metaenum() // NOLINT
+{
+  QBENCHMARK
+  {
+    for (const auto& keyword : _keywords) {
+      auto type = common::enum_value<client::IMAP::Response>(
+        QString::fromLatin1(keyword).toLocal8Bit().constData());
+      QVERIFY(type != client::IMAP::Response::NO);
+    }
+  }
+}
+
+void
+IMAPBench::bench_keyword_table() // NOLINT
+{
+  QBENCHMARK
+  {
+    for (const auto& keyword : _keywords) {
+      auto type = client::detail::RESPONSE_KEYWORDS.value(
+        { keyword.constData(), static_cast<std::size_t>(keyword.size()) });
+      QVERIFY(type != client::IMAP::Response::NO);
+    }
+  }
+}
+
+void
+IMAPBench::bench_scan_scalar() // NOLINT
+{
+  const auto* end = _transcript.constEnd();
+
+  QBENCHMARK
+  {
+    int lines = 0;
+    for (const auto* pos = _transcript.constBegin(); pos != end; ++pos) {
+      pos = client::detail::scan_any_scalar<'\r', '{'>(pos, end);
+      lines += pos != end && *pos == '\r' ? 1 : 0;
+      if (pos == end) {
+        break;
+      }
+    }
+    QCOMPARE(lines, FETCH_COUNT * 7 + 1);
+  }
+}
+
+void
+IMAPBench::bench_scan_simd() // NOLINT
+{
+#ifdef TEMAIL_SCALAR_SCAN
+  QSKIP("Vector scanner is disabled in the baseline build.");
+#endif
+
+  const auto* end = _transcript.constEnd();
+
+  QBENCHMARK
+  {
+    int lines = 0;
+    for (const auto* pos = _transcript.constBegin(); pos != end; ++pos) {
+      pos = client::detail::scan_any<'\r', '{'>(pos, end);
+      lines += pos != end && *pos == '\r' ? 1 : 0;
+      if (pos == end) {
+        break;
+      }
+    }
+    QCOMPARE(lines, FETCH_COUNT * 7 + 1);
+  }
+}
+
+void
+IMAPBench::bench_digest() // NOLINT
+{
+  constexpr int ROUNDS = 20;
+
+  auto timer = QElapsedTimer{};
+  timer.start();
+
+  for (int i = 0; i < ROUNDS; ++i) {
+    auto resp = client::detail::IMAPResponse{ 'A', 0 };
+    QVERIFY(resp.digest(_transcript));
+    QCOMPARE(resp.raw().size(), qsizetype{ FETCH_COUNT });
+  }
+
+  auto nsecs = static_cast<qreal>(timer.nsecsElapsed());
+  auto bytes = static_cast<qreal>(_transcript.size()) * ROUNDS;
+
+  // reported as bytes per second, divide by 1e6 for MB/s, `bench_imap_scalar`
+  // reports the same transcript parsed with the scalar scanner.
+  QTest::setBenchmarkResult(bytes * 1e9 / nsecs, QTest::BytesPerSecond);
+}
+
+QTEST_MAIN(IMAPBench)
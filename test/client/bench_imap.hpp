@@ -0,0 +1,29 @@
+#pragma once
+
+#include <qbytearray.h>
+#include <qlist.h>
+#include <qobject.h>
+#include <qtest.h>
+#include <temail/common.hpp>
+
+using namespace temail;
+
+class IMAPBench : public QObject
+{
+  Q_OBJECT
+
+public:
+  constexpr static int FETCH_COUNT = 10000; /**< FETCH lines in transcript. */
+
+private:
+  QByteArray _transcript;
+  QList<QByteArray> _keywords;
+
+private slots: // NOLINT
+  void initTestCase();
+  void bench_keyword_metaenum();
+  void bench_keyword_table();
+  void bench_scan_scalar();
+  void bench_scan_simd();
+  void bench_digest();
+};
@@ -0,0 +1,256 @@
+#include <future>
+#include <memory>
+#include <optional>
+#include <qbuffer.h>
+#include <qbytearray.h>
+#include <qhostaddress.h>
+#include <qlist.h>
+#include <qregularexpression.h>
+#include <qsignalspy.h>
+#include <qstring.h>
+#include <qtcpserver.h>
+#include <qtcpsocket.h>
+#include <qtest.h>
+#include <qtestcase.h>
+#include <qthread.h>
+#include <temail/client/base.hpp>
+#include <temail/client/imap.hpp>
+#include <temail/client/request.hpp>
+#include <temail/client/response.hpp>
+#include <utility>
+
+#include "test_append.hpp"
+
+using client::Base;
+using client::IMAP;
+using client::request::AppendMessage;
+using client::response::Append;
+
+namespace {
+
+constexpr int TIMEOUT_MSECS = 5000;
+
+/**
+ * @brief Scripted IMAP4 server with LITERAL+ but without MULTIAPPEND, served
+ * from its own thread since the client blocks on the greeting.
+ *
+ */
+class FakeServer
+{
+private:
+  QByteArray _fail; /**< APPEND of a body containing it is refused. */
+  std::promise<quint16> _port;
+  std::unique_ptr<QThread> _thread;
+
+public:
+  explicit FakeServer(QByteArray fail = {})
+    : _fail{ std::move(fail) }
+    , _thread{ QThread::create([this] { _run(); }) }
+  {
+  }
+
+  ~FakeServer() { _thread->wait(); }
+
+  FakeServer(const FakeServer&) = delete;
+  FakeServer& operator=(const FakeServer&) = delete;
+  FakeServer(FakeServer&&) = delete;
+  FakeServer& operator=(FakeServer&&) = delete;
+
+  quint16 start()
+  {
+    auto port = _port.get_future();
+    _thread->start();
+    return port.get();
+  }
+
+private:
+  void _run()
+  {
+    auto server = QTcpServer{};
+    server.listen(QHostAddress::LocalHost);
+    _port.set_value(server.serverPort());
+
+    if (!server.waitForNewConnection(TIMEOUT_MSECS)) {
+      return;
+    }
+    auto sock = std::unique_ptr<QTcpSocket>{ server.nextPendingConnection() };
+
+    auto reply = [&sock](const QByteArray& data) {
+      sock->write(data);
+      sock->waitForBytesWritten(TIMEOUT_MSECS);
+    };
+
+    reply("* OK [CAPABILITY IMAP4rev1 LITERAL+] Ready\r\n");
+
+    auto uid = 11;
+    while (auto command = _read_command(*sock)) {
+      auto words = command->split(' ');
+      auto tag = words.value(0);
+      auto name = words.value(1).trimmed().toUpper();
+
+      if (name == "LOGIN") {
+        reply(tag + " OK [CAPABILITY IMAP4rev1 LITERAL+] Logged in\r\n");
+      } else if (name == "APPEND" && !_fail.isEmpty() &&
+                 command->sliced(command->indexOf('\n') + 1).contains(_fail)) {
+        reply(tag + " NO [TRYCREATE] Refused\r\n");
+      } else if (name == "APPEND") {
+        reply(tag + " OK [APPENDUID 7 " + QByteArray::number(uid++) +
+              "] Appended\r\n");
+      } else if (name == "NOOP") {
+        reply(tag + " OK Noop\r\n");
+      } else if (name == "LOGOUT") {
+        reply("* BYE Bye\r\n" + tag + " OK Logout\r\n");
+        break;
+      } else {
+        reply(tag + " BAD Unknown command\r\n");
+      }
+    }
+
+    sock->disconnectFromHost();
+    if (sock->state() != QAbstractSocket::UnconnectedState) {
+      sock->waitForDisconnected(TIMEOUT_MSECS);
+    }
+  }
+
+  // a command line, followed by the bytes of its `{n+}` literals.
+  static std::optional<QByteArray> _read_command(QTcpSocket& sock)
+  {
+    static const auto LITERAL = QRegularExpression{ R"(\{(\d+)\+\}\r\n$)" };
+
+    auto command = QByteArray{};
+    while (true) {
+      while (!sock.canReadLine()) {
+        if (!sock.waitForReadyRead(TIMEOUT_MSECS)) {
+          return std::nullopt;
+        }
+      }
+
+      auto line = sock.readLine();
+      command.append(line);
+
+      auto literal = LITERAL.match(QString::fromLatin1(line));
+      if (!literal.hasMatch()) {
+        return command;
+      }
+
+      auto size = literal.captured(1).toLongLong();
+      while (sock.bytesAvailable() < size) {
+        if (!sock.waitForReadyRead(TIMEOUT_MSECS)) {
+          return std::nullopt;
+        }
+      }
+      command.append(sock.read(size));
+    }
+  }
+};
+
+AppendMessage
+_message(const QByteArray& body)
+{
+  auto buffer = std::make_shared<QBuffer>();
+  buffer->setData(body);
+  buffer->open(QIODevice::ReadOnly);
+  return { std::move(buffer), -1, {}, {} };
+}
+
+void
+_login(IMAP& imap, quint16 port)
+{
+  imap.connect_to_host("127.0.0.1", port, Base::NO_SSL);
+  QVERIFY(imap.wait_for_connected());
+
+  imap.login("user", "password");
+  QVERIFY(imap.wait_for_ready_read());
+  QVERIFY(imap.read<client::response::Login>().has_value());
+}
+
+void
+_logout(IMAP& imap)
+{
+  imap.logout();
+  QVERIFY(imap.wait_for_disconnected());
+}
+
+}
+
+void
+AppendTest::test_merge() // NOLINT
+{
+  auto server = FakeServer{};
+  auto imap = IMAP{};
+  _login(imap, server.start());
+
+  // one command per message, one result for the caller.
+  auto calls = 0;
+  auto result = Append{};
+  imap.append("INBOX",
+              { _message("one"), _message("two"), _message("three") },
+              [&](Append&& data) {
+                ++calls;
+                result = std::move(data);
+              });
+
+  QTRY_COMPARE_WITH_TIMEOUT(calls, 1, TIMEOUT_MSECS);
+  QCOMPARE(result.uidvalidity, std::size_t{ 7 });
+  QCOMPARE(result.uids.to_string(), QString{ "11:13" });
+
+  // later responses must not reach the callback again.
+  imap.noop();
+  QVERIFY(imap.wait_for_ready_read());
+  QVERIFY(imap.read<client::response::Noop>().has_value());
+  QCOMPARE(calls, 1);
+
+  _logout(imap);
+}
+
+void
+AppendTest::test_queue() // NOLINT
+{
+  auto server = FakeServer{};
+  auto imap = IMAP{};
+  _login(imap, server.start());
+
+  auto spy = QSignalSpy{ &imap, &Base::ready_read };
+  imap.append("INBOX", { _message("one"), _message("two") });
+  imap.noop();
+
+  // the merged result is queued once, ahead of the NOOP.
+  QTRY_COMPARE_WITH_TIMEOUT(spy.count(), 2, TIMEOUT_MSECS);
+
+  auto result = imap.read<Append>();
+  QVERIFY(result.has_value());
+  QCOMPARE(result->uids.to_string(), QString{ "11:12" });
+  QVERIFY(imap.read<client::response::Noop>().has_value());
+
+  _logout(imap);
+}
+
+void
+AppendTest::test_failure() // NOLINT
+{
+  // both "two" and "three" are refused.
+  auto server = FakeServer{ "t" };
+  auto imap = IMAP{};
+  _login(imap, server.start());
+
+  auto calls = 0;
+  auto errors = QSignalSpy{ &imap, &Base::error_occurred };
+  auto ready = QSignalSpy{ &imap, &Base::ready_read };
+  imap.append("INBOX",
+              { _message("one"), _message("two"), _message("three") },
+              [&calls](Append&& /*data*/) { ++calls; });
+  imap.noop();
+
+  // responses arrive in order, so the batch is over once NOOP completes.
+  QTRY_COMPARE_WITH_TIMEOUT(ready.count(), 1, TIMEOUT_MSECS);
+  QVERIFY(imap.read<client::response::Noop>().has_value());
+
+  QCOMPARE(calls, 0);
+  QCOMPARE(errors.count(), 1);
+  QCOMPARE(errors.at(0).at(0).value<Base::ErrorType>(), Base::E_REFERENCE);
+
+  imap.reset_error();
+  _logout(imap);
+}
+
+QTEST_MAIN(AppendTest)
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <qobject.h>
+#include <qtest.h>
+#include <temail/common.hpp>
+
+using namespace temail;
+
+class AppendTest : public QObject
+{
+  Q_OBJECT
+
+private slots: // NOLINT
+  void test_merge();
+  void test_queue();
+  void test_failure();
+};
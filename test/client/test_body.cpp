@@ -0,0 +1,170 @@
+#include <cstddef>
+#include <optional>
+#include <qbytearray.h>
+#include <qdir.h>
+#include <qfile.h>
+#include <qstring.h>
+#include <qtest.h>
+#include <qtestcase.h>
+#include <temail/client/body.hpp>
+
+#include "test_body.hpp"
+
+using client::BodyStore;
+
+namespace {
+
+const auto BODY_A = QByteArray{ "Subject: A\r\n\r\n" }.append(1000, 'a');
+const auto BODY_B = QByteArray{ "Subject: B\r\n\r\n" }.append(1000, 'b');
+
+QString
+_pack(const QString& directory)
+{
+  return QDir{ directory }.filePath("pack-000000.pack");
+}
+
+}
+
+void
+BodyTest::test_dedup() // NOLINT
+{
+  auto store = BodyStore{ _dir.filePath("dedup") };
+
+  auto hash = store.put(BODY_A);
+  QCOMPARE(hash, BodyStore::hash(BODY_A));
+  QCOMPARE(hash.size(), qsizetype{ 32 });
+  QVERIFY(store.contains(hash));
+
+  // a stored body is not written again.
+  auto size = QFile{ _pack(_dir.filePath("dedup")) }.size();
+  QCOMPARE(store.put(BODY_A), hash);
+  QCOMPARE(QFile{ _pack(_dir.filePath("dedup")) }.size(), size);
+
+  QVERIFY(store.put(BODY_B) != hash);
+
+  auto stats = store.stats();
+  QCOMPARE(stats.bodies, std::size_t{ 2 });
+  QCOMPARE(stats.emailids, std::size_t{ 0 });
+  QCOMPARE(stats.raw_bytes,
+           static_cast<std::size_t>(BODY_A.size() + BODY_B.size()));
+  QVERIFY(stats.packed_bytes < stats.raw_bytes);
+
+  QCOMPARE(store.get(hash), std::optional<QByteArray>{ BODY_A });
+  QVERIFY(!store.get(BodyStore::hash("missing")).has_value());
+}
+
+void
+BodyTest::test_emailid() // NOLINT
+{
+  auto store = BodyStore{ _dir.filePath("emailid") };
+
+  auto hash = store.put(BODY_A, "M1");
+  QCOMPARE(store.find("M1"), std::optional<QByteArray>{ BODY_A });
+
+  // the same body under another EMAILID only records the id.
+  auto size = QFile{ _pack(_dir.filePath("emailid")) }.size();
+  QCOMPARE(store.put(BODY_A, "M2"), hash);
+  QCOMPARE(store.find("M2"), std::optional<QByteArray>{ BODY_A });
+  QVERIFY(QFile{ _pack(_dir.filePath("emailid")) }.size() - size <
+          BODY_A.size());
+
+  QCOMPARE(store.stats().bodies, std::size_t{ 1 });
+  QCOMPARE(store.stats().emailids, std::size_t{ 2 });
+  QVERIFY(!store.find("M3").has_value());
+}
+
+void
+BodyTest::test_reload() // NOLINT
+{
+  auto directory = _dir.filePath("reload");
+  auto hash_a = BodyStore::hash(BODY_A);
+  auto hash_b = BodyStore::hash(BODY_B);
+
+  auto stats = BodyStore::Stats{};
+  {
+    auto store = BodyStore{ directory };
+    store.put(BODY_A, "M1");
+    store.put(BODY_B);
+    store.put(BODY_B, "M2");
+    stats = store.stats();
+  }
+
+  auto body = QByteArray{ "Subject: C\r\n\r\nc" };
+  {
+    auto store = BodyStore{ directory };
+    QCOMPARE(store.stats().bodies, stats.bodies);
+    QCOMPARE(store.stats().emailids, stats.emailids);
+    QCOMPARE(store.stats().raw_bytes, stats.raw_bytes);
+    QCOMPARE(store.stats().packed_bytes, stats.packed_bytes);
+
+    QCOMPARE(store.get(hash_a), std::optional<QByteArray>{ BODY_A });
+    QCOMPARE(store.get(hash_b), std::optional<QByteArray>{ BODY_B });
+    QCOMPARE(store.find("M1"), std::optional<QByteArray>{ BODY_A });
+    QCOMPARE(store.find("M2"), std::optional<QByteArray>{ BODY_B });
+
+    store.put(body);
+  }
+
+  // appending to a reloaded pack keeps earlier records readable.
+  auto store = BodyStore{ directory };
+  QCOMPARE(store.stats().bodies, stats.bodies + 1);
+  QCOMPARE(store.get(BodyStore::hash(body)), std::optional<QByteArray>{ body });
+  QCOMPARE(store.get(hash_a), std::optional<QByteArray>{ BODY_A });
+}
+
+void
+BodyTest::test_truncated() // NOLINT
+{
+  auto directory = _dir.filePath("truncated");
+  auto hash_a = BodyStore::hash(BODY_A);
+  auto hash_b = BodyStore::hash(BODY_B);
+
+  auto end_a = qint64{ 0 };
+  {
+    auto store = BodyStore{ directory };
+    store.put(BODY_A);
+    end_a = QFile{ _pack(directory) }.size();
+    store.put(BODY_B, "M2");
+  }
+
+  // a crash while appending leaves a partial record behind.
+  auto file = QFile{ _pack(directory) };
+  QVERIFY(file.resize(file.size() - 1));
+
+  {
+    auto store = BodyStore{ directory };
+    QVERIFY(store.contains(hash_a));
+    QVERIFY(!store.contains(hash_b));
+    QVERIFY(!store.find("M2").has_value());
+    QCOMPARE(file.size(), end_a);
+
+    QCOMPARE(store.put(BODY_B, "M2"), hash_b);
+  }
+
+  auto store = BodyStore{ directory };
+  QCOMPARE(store.get(hash_a), std::optional<QByteArray>{ BODY_A });
+  QCOMPARE(store.find("M2"), std::optional<QByteArray>{ BODY_B });
+}
+
+void
+BodyTest::test_corrupted() // NOLINT
+{
+  auto directory = _dir.filePath("corrupted");
+  auto hash = BodyStore{ directory }.put(BODY_A);
+
+  // damage the end of the compressed body.
+  auto file = QFile{ _pack(directory) };
+  QVERIFY(file.open(QIODevice::ReadWrite));
+  QVERIFY(file.seek(file.size() - 1));
+  auto last = file.read(1);
+  last[0] = static_cast<char>(last[0] ^ 0xff);
+  QVERIFY(file.seek(file.size() - 1));
+  QCOMPARE(file.write(last), qint64{ 1 });
+  file.close();
+
+  auto store = BodyStore{ directory };
+  QVERIFY(store.contains(hash));
+  QVERIFY(!store.get(hash).has_value());
+}
+
+QTEST_MAIN(BodyTest)
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <qobject.h>
+#include <qtemporarydir.h>
+#include <qtest.h>
+#include <temail/common.hpp>
+
+using namespace temail;
+
+class BodyTest : public QObject
+{
+  Q_OBJECT
+
+private:
+  QTemporaryDir _dir;
+
+private slots: // NOLINT
+  void test_dedup();
+  void test_emailid();
+  void test_reload();
+  void test_truncated();
+  void test_corrupted();
+};
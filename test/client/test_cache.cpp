@@ -0,0 +1,276 @@
+#include <cstddef>
+#include <cstdint>
+#include <qbytearray.h>
+#include <qdatetime.h>
+#include <qdir.h>
+#include <qfile.h>
+#include <qstring.h>
+#include <qstringview.h>
+#include <qtest.h>
+#include <qtestcase.h>
+#include <temail/client/cache.hpp>
+#include <temail/client/flags.hpp>
+#include <temail/client/request.hpp>
+#include <temail/client/response.hpp>
+#include <temail/client/sequence.hpp>
+
+#include "test_cache.hpp"
+
+using client::FlagSet;
+using client::IMAPCache;
+using client::SequenceSet;
+using client::request::Fetch;
+using client::response::FetchEnvelope;
+using client::response::FetchItem;
+
+namespace {
+
+const auto ENVELOPE = QByteArray{ "Date: Mon, 6 Jan 2025 10:00:00 +0000\r\n"
+                                  "Subject: Hello\r\n"
+                                  "From: Alice <alice@example.com>\r\n"
+                                  "To: bob@example.com\r\n\r\n" };
+
+FetchItem
+_item(std::size_t uid, QStringView flags, std::size_t size)
+{
+  auto item = FetchItem{};
+  item.uid = uid;
+  item.modseq = uid * 10;
+  item.size = size;
+  item.fields = Fetch::SIZE | Fetch::FLAGS | Fetch::ENVELOPE;
+  item.flags = FlagSet::parse(flags);
+  item.envelope = FetchEnvelope{ ENVELOPE };
+  return item;
+}
+
+// fills `mailbox` with mails 1 to 3 and flushes it.
+void
+_populate(const QString& directory, const QString& mailbox)
+{
+  auto cache = IMAPCache{ directory };
+  cache.open(mailbox, 7);
+  cache.update(_item(1, u"(\\Seen $Work)", 100));
+  cache.update(_item(2, u"(\\Flagged)", 2000));
+  cache.update(_item(3, u"()", 30));
+  cache.set_highestmodseq(42);
+}
+
+QString
+_path(const QString& directory, const QString& mailbox)
+{
+  return QDir{ directory }.filePath(mailbox + ".cache");
+}
+
+}
+
+void
+CacheTest::test_reopen() // NOLINT
+{
+  _populate(_dir.path(), "reopen");
+
+  auto cache = IMAPCache{ _dir.path() };
+  cache.open("reopen");
+
+  QCOMPARE(cache.uidvalidity(), std::size_t{ 7 });
+  QCOMPARE(cache.highestmodseq(), std::size_t{ 42 });
+  QCOMPARE(cache.uids().to_string(), QString{ "1:3" });
+  QCOMPARE(cache.missing(SequenceSet{ 1, 5 }).to_string(), QString{ "4:5" });
+
+  auto record = cache.find(1);
+  QVERIFY(record.has_value());
+  QCOMPARE(record->size, std::size_t{ 100 });
+  QCOMPARE(record->modseq, std::size_t{ 10 });
+  QCOMPARE(record->fields, Fetch::SIZE | Fetch::FLAGS | Fetch::ENVELOPE);
+  QCOMPARE(record->flags, FlagSet::parse(u"\\Seen $Work"));
+  QCOMPARE(record->envelope.raw(), ENVELOPE);
+  QCOMPARE(record->envelope.subject(), QString{ "Hello" });
+
+  // updates merge into mapped records and survive another flush.
+  auto item = FetchItem{};
+  item.uid = 2;
+  item.fields = Fetch::FLAGS;
+  item.flags = FlagSet::parse(u"(\\Answered $Later)");
+  cache.update(item);
+  QVERIFY(cache.flush());
+
+  cache.close();
+  cache.open("reopen");
+
+  record = cache.find(2);
+  QVERIFY(record.has_value());
+  QCOMPARE(record->size, std::size_t{ 2000 });
+  QCOMPARE(record->flags, FlagSet::parse(u"\\Answered $Later"));
+  QCOMPARE(record->envelope.raw(), ENVELOPE);
+  QCOMPARE(cache.find(SequenceSet{ 1, 3 }).size(), qsizetype{ 3 });
+}
+
+void
+CacheTest::test_remove() // NOLINT
+{
+  _populate(_dir.path(), "remove");
+
+  {
+    auto cache = IMAPCache{ _dir.path() };
+    cache.open("remove");
+    cache.remove(SequenceSet{ 2, 2 });
+    QVERIFY(!cache.find(2).has_value());
+  }
+
+  auto cache = IMAPCache{ _dir.path() };
+  cache.open("remove");
+  QCOMPARE(cache.uids().to_string(), QString{ "1,3" });
+}
+
+void
+CacheTest::test_uidvalidity() // NOLINT
+{
+  _populate(_dir.path(), "uidvalidity");
+
+  auto cache = IMAPCache{ _dir.path() };
+  cache.open("uidvalidity", 7);
+  QCOMPARE(cache.uids().to_string(), QString{ "1:3" });
+
+  // a new UIDVALIDITY drops all records.
+  cache.close();
+  cache.open("uidvalidity", 8);
+  QCOMPARE(cache.uidvalidity(), std::size_t{ 8 });
+  QCOMPARE(cache.highestmodseq(), std::size_t{ 0 });
+  QVERIFY(cache.uids().empty());
+  QVERIFY(!cache.find(1).has_value());
+}
+
+void
+CacheTest::test_version() // NOLINT
+{
+  _populate(_dir.path(), "version");
+
+  // version follows the 4 magic bytes.
+  auto file = QFile{ _path(_dir.path(), "version") };
+  QVERIFY(file.open(QIODevice::ReadWrite));
+  auto version = uint32_t{ 2 };
+  QVERIFY(file.seek(4));
+  QCOMPARE(file.write(reinterpret_cast<const char*>(&version), sizeof(version)),
+           qint64{ sizeof(version) });
+  file.close();
+
+  auto cache = IMAPCache{ _dir.path() };
+  cache.open("version");
+  QCOMPARE(cache.uidvalidity(), std::size_t{ 0 });
+  QVERIFY(cache.uids().empty());
+}
+
+void
+CacheTest::test_truncated() // NOLINT
+{
+  _populate(_dir.path(), "truncated");
+
+  auto file = QFile{ _path(_dir.path(), "truncated") };
+  auto size = file.size();
+
+  // a heap cut short and an entry table cut short are both rejected.
+  for (auto cut : { size - 1, qint64{ 40 } }) {
+    QVERIFY(file.resize(cut));
+
+    auto cache = IMAPCache{ _dir.path() };
+    cache.open("truncated");
+    QVERIFY(cache.uids().empty());
+    QVERIFY(!cache.find(1).has_value());
+  }
+
+  // the invalid file is replaced on the next flush.
+  {
+    auto cache = IMAPCache{ _dir.path() };
+    cache.open("truncated", 9);
+    cache.update(_item(5, u"(\\Seen)", 10));
+  }
+
+  auto cache = IMAPCache{ _dir.path() };
+  cache.open("truncated");
+  QCOMPARE(cache.uidvalidity(), std::size_t{ 9 });
+  QCOMPARE(cache.uids().to_string(), QString{ "5" });
+}
+
+void
+CacheTest::test_search() // NOLINT
+{
+  using client::request::Search;
+  using client::request::SearchQuery;
+
+  _populate(_dir.path(), "search");
+
+  auto cache = IMAPCache{ _dir.path() };
+  cache.open("search");
+
+  auto uids = [&cache](const SearchQuery& query) {
+    auto result = cache.search(query);
+    return result ? result->to_string() : QString{ "server" };
+  };
+
+  // mapped entries.
+  QCOMPARE(uids(SearchQuery{ Search::SEEN }), QString{ "1" });
+  QCOMPARE(uids(SearchQuery{ Search::UNFLAGGED }), QString{ "1,3" });
+  QCOMPARE(uids(SearchQuery::larger(50)), QString{ "1:2" });
+  QCOMPARE(uids(SearchQuery::from("ALICE") && SearchQuery::smaller(1000)),
+           QString{ "1,3" });
+  QCOMPARE(uids(SearchQuery::subject("hell")), QString{ "1:3" });
+  QCOMPARE(uids(SearchQuery::header("to", "")), QString{ "1:3" });
+  QCOMPARE(uids(SearchQuery::sent_on(QDate{ 2025, 1, 6 })), QString{ "1:3" });
+  QCOMPARE(uids(SearchQuery::sent_before(QDate{ 2025, 1, 6 })), QString{});
+  QCOMPARE(uids(SearchQuery::uid(SequenceSet{ 2, 3 }) || Search::SEEN),
+           QString{ "1:3" });
+
+  // dirty records replace mapped ones, removed ones are skipped.
+  auto item = FetchItem{};
+  item.uid = 1;
+  item.fields = Fetch::FLAGS;
+  cache.update(item);
+  cache.update(_item(4, u"(\\Seen)", 10));
+  cache.remove(SequenceSet{ 2, 2 });
+
+  QCOMPARE(uids(SearchQuery{ Search::SEEN }), QString{ "4" });
+  QCOMPARE(uids(SearchQuery{ Search::FLAGGED }), QString{});
+  QCOMPARE(uids(SearchQuery{}), QString{ "1,3:4" });
+
+  // same answers once flushed back into the mapping.
+  QVERIFY(cache.flush());
+  QCOMPARE(uids(SearchQuery{ Search::SEEN }), QString{ "4" });
+  QCOMPARE(uids(SearchQuery{}), QString{ "1,3:4" });
+
+  cache.clear();
+  QCOMPARE(uids(SearchQuery{}), QString{});
+}
+
+void
+CacheTest::test_search_server() // NOLINT
+{
+  using client::request::Search;
+  using client::request::SearchQuery;
+
+  _populate(_dir.path(), "server");
+
+  auto cache = IMAPCache{ _dir.path() };
+  cache.open("server");
+
+  // keys on data the cache does not keep.
+  QVERIFY(!cache.search(SearchQuery::body("x")).has_value());
+  QVERIFY(!cache.search(SearchQuery{ Search::RECENT }).has_value());
+  QVERIFY(!cache.search(SearchQuery::since(QDate{ 2025, 1, 1 })).has_value());
+  QVERIFY(!cache.search(SearchQuery::header("Cc", "x")).has_value());
+  QVERIFY(!cache
+             .search(SearchQuery::uid(SequenceSet{ SequenceSet::LAST,
+                                                   SequenceSet::LAST }))
+             .has_value());
+
+  // a mail whose size was never fetched.
+  auto item = FetchItem{};
+  item.uid = 5;
+  item.fields = Fetch::FLAGS;
+  item.flags = FlagSet::parse(u"(\\Seen)");
+  cache.update(item);
+
+  QVERIFY(!cache.search(SearchQuery::larger(1)).has_value());
+  QCOMPARE(cache.search(SearchQuery{ Search::SEEN })->to_string(),
+           QString{ "1,5" });
+}
+
+QTEST_MAIN(CacheTest)
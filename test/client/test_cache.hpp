@@ -0,0 +1,25 @@
+#pragma once
+
+#include <qobject.h>
+#include <qtemporarydir.h>
+#include <qtest.h>
+#include <temail/common.hpp>
+
+using namespace temail;
+
+class CacheTest : public QObject
+{
+  Q_OBJECT
+
+private:
+  QTemporaryDir _dir;
+
+private slots: // NOLINT
+  void test_reopen();
+  void test_remove();
+  void test_uidvalidity();
+  void test_version();
+  void test_truncated();
+  void test_search();
+  void test_search_server();
+};
@@ -0,0 +1,109 @@
+#include <qbytearray.h>
+#include <qstring.h>
+#include <qstringlist.h>
+#include <qtest.h>
+#include <qtestcase.h>
+#include <temail/common.hpp>
+
+#include "temail/private/client/imap/capability.hpp"
+#include "temail/private/client/imap/deflate.hpp"
+#include "test_compress.hpp"
+
+using client::detail::IMAPDeflate;
+using client::detail::imap_parse_capabilities;
+
+namespace {
+
+/**
+ * @brief Inflate input fed in chunks of `step` bytes.
+ *
+ */
+QByteArray
+_inflate(IMAPDeflate& deflate, const QByteArray& input, qsizetype step)
+{
+  auto out = QByteArray{};
+  for (qsizetype offset = 0; offset < input.size(); offset += step) {
+    out.append(
+      deflate.inflate(input.sliced(offset, qMin(step, input.size() - offset))));
+  }
+  return out;
+}
+
+}
+
+void
+CompressTest::test_passthrough() // NOLINT
+{
+  auto deflate = IMAPDeflate{};
+  QVERIFY(!deflate.active());
+  QCOMPARE(deflate.deflate("A1 NOOP\r\n"), QByteArray{ "A1 NOOP\r\n" });
+  QCOMPARE(deflate.inflate("A1 OK\r\n"), QByteArray{ "A1 OK\r\n" });
+}
+
+void
+CompressTest::test_round_trip() // NOLINT
+{
+  auto client = IMAPDeflate{};
+  auto server = IMAPDeflate{};
+  QVERIFY(client.start());
+  QVERIFY(server.start());
+
+  // larger than the output buffer, in both directions.
+  auto command = QByteArray{ "A1 NOOP\r\n" };
+  auto literal = QByteArray{};
+  for (int i = 0; i < 8192; ++i) {
+    literal.append(QByteArray::number(i * 7919)).append(' ');
+  }
+  QVERIFY(literal.size() > 16384 * 2);
+
+  auto packed = client.deflate(command);
+  QVERIFY(!packed.isEmpty());
+  QCOMPARE(server.inflate(packed), command);
+
+  // sync flushed output inflates at any split, one byte at a time too.
+  packed = server.deflate(literal);
+  QCOMPARE(_inflate(client, packed, packed.size()), literal);
+
+  packed = server.deflate(literal);
+  QCOMPARE(_inflate(client, packed, 1), literal);
+
+  packed = server.deflate(literal);
+  QCOMPARE(_inflate(client, packed, 4093), literal);
+  QVERIFY(!client.error());
+}
+
+void
+CompressTest::test_corrupted() // NOLINT
+{
+  auto deflate = IMAPDeflate{};
+  QVERIFY(deflate.start());
+
+  // a final block with the reserved block type.
+  QVERIFY(deflate.inflate(QByteArray{ "\xff\xff\xff\xff", 4 }).isEmpty());
+  QVERIFY(deflate.error());
+
+  // restarting clears the error.
+  QVERIFY(deflate.start());
+  QVERIFY(!deflate.error());
+}
+
+void
+CompressTest::test_capabilities() // NOLINT
+{
+  QCOMPARE(imap_parse_capabilities(u"IMAP4rev1 LITERAL+ MULTIAPPEND", false),
+           (QStringList{ "IMAP4rev1", "LITERAL+", "MULTIAPPEND" }));
+
+  // codes end at the bracket, the text after it is not parsed.
+  QCOMPARE(imap_parse_capabilities(
+             u" [CAPABILITY IMAP4rev1 COMPRESS=DEFLATE] OBJECTID ready", true),
+           (QStringList{ "IMAP4rev1", "COMPRESS=DEFLATE" }));
+  QCOMPARE(imap_parse_capabilities(u"[capability LITERAL-]", true),
+           QStringList{ "LITERAL-" });
+
+  // a greeting without the code advertises nothing.
+  QVERIFY(imap_parse_capabilities(u"IMAP4rev1 LITERAL+ ready", true).isEmpty());
+  QVERIFY(imap_parse_capabilities(u"[ALERT] LITERAL+", true).isEmpty());
+  QVERIFY(imap_parse_capabilities(u"", false).isEmpty());
+}
+
+QTEST_MAIN(CompressTest)
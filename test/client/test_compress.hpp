@@ -0,0 +1,18 @@
+#pragma once
+
+#include <qobject.h>
+#include <qtest.h>
+#include <temail/common.hpp>
+
+using namespace temail;
+
+class CompressTest : public QObject
+{
+  Q_OBJECT
+
+private slots: // NOLINT
+  void test_passthrough();
+  void test_round_trip();
+  void test_corrupted();
+  void test_capabilities();
+};
@@ -0,0 +1,163 @@
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <qbytearray.h>
+#include <qdatetime.h>
+#include <qstring.h>
+#include <qtest.h>
+#include <qtestcase.h>
+#include <qtimezone.h>
+#include <temail/client/flags.hpp>
+#include <temail/client/response.hpp>
+#include <temail/common.hpp>
+
+#include "temail/private/client/imap/response.hpp"
+#include "test_envelopes.hpp"
+
+using client::FlagSet;
+using client::response::Envelopes;
+using client::response::FetchEnvelope;
+
+namespace {
+
+FetchEnvelope
+_envelope(const char* date, const char* from, const char* subject)
+{
+  auto raw = QByteArray{};
+  if (date != nullptr) {
+    raw.append("Date: ").append(date).append("\r\n");
+  }
+  if (from != nullptr) {
+    raw.append("From: ").append(from).append("\r\n");
+  }
+  if (subject != nullptr) {
+    raw.append("Subject: ").append(subject).append("\r\n");
+  }
+  raw.append("To: bob@example.com\r\n\r\n");
+  return FetchEnvelope{ raw };
+}
+
+constexpr auto DATE = "Mon, 6 Jan 2025 10:00:00 +0100";
+
+}
+
+void
+EnvelopesTest::test_intern() // NOLINT
+{
+  auto envelopes = Envelopes{};
+  envelopes.append(1, _envelope(DATE, "alice@example.com", "a"), 0, {});
+  envelopes.append(2, _envelope(DATE, "carol@example.com", "b"), 0, {});
+  envelopes.append(3, _envelope(DATE, "alice@example.com", "c"), 0, {});
+  envelopes.append(4, _envelope(DATE, nullptr, "d"), 0, {});
+
+  // the empty string, two senders and one recipient.
+  QCOMPARE(envelopes.addresses().size(), qsizetype{ 4 });
+  QCOMPARE(envelopes.from(0), QString{ "alice@example.com" });
+  QCOMPARE(&envelopes.from(0), &envelopes.from(2));
+  QCOMPARE(&envelopes.to(0), &envelopes.to(3));
+  QVERIFY(envelopes.from(3).isEmpty());
+  QCOMPARE(envelopes.to(1), QString{ "bob@example.com" });
+}
+
+void
+EnvelopesTest::test_subjects() // NOLINT
+{
+  auto envelopes = Envelopes{};
+  envelopes.reserve(3);
+  envelopes.append(7, _envelope(DATE, nullptr, "Hello"), 0, {});
+  envelopes.append(8, _envelope(DATE, nullptr, nullptr), 0, {});
+  envelopes.append(9, _envelope(DATE, nullptr, "=?UTF-8?B?5L2g5aW9?="), 0, {});
+
+  QCOMPARE(envelopes.size(), std::size_t{ 3 });
+  QCOMPARE(envelopes.uid(2), uint32_t{ 9 });
+  QCOMPARE(envelopes.subject(0).toString(), QString{ "Hello" });
+  QVERIFY(envelopes.subject(1).isEmpty());
+  QCOMPARE(envelopes.subject(2).toString(),
+           QString::fromUtf8("\xe4\xbd\xa0\xe5\xa5\xbd"));
+}
+
+void
+EnvelopesTest::test_no_date() // NOLINT
+{
+  auto envelopes = Envelopes{};
+  envelopes.append(1, _envelope(DATE, nullptr, nullptr), 0, {});
+  envelopes.append(2, _envelope(nullptr, nullptr, nullptr), 0, {});
+  envelopes.append(3, _envelope("yesterday", nullptr, nullptr), 0, {});
+  envelopes.append(
+    4, _envelope("Mon, 6 Jan 2025 09:00:00 +0000 (UTC)", nullptr, nullptr),
+    0,
+    {});
+
+  // dates are packed in UTC.
+  auto utc = QDateTime{ QDate{ 2025, 1, 6 }, QTime{ 9, 0 }, QTimeZone::UTC };
+  QCOMPARE(envelopes.date_msecs(0), utc.toMSecsSinceEpoch());
+  QCOMPARE(envelopes.date(0), utc);
+  QCOMPARE(envelopes.date_msecs(3), utc.toMSecsSinceEpoch());
+
+  QCOMPARE(envelopes.date_msecs(1), Envelopes::NO_DATE);
+  QCOMPARE(envelopes.date_msecs(2), Envelopes::NO_DATE);
+  QVERIFY(!envelopes.date(1).isValid());
+
+  // missing dates sort first.
+  QVERIFY(envelopes.date_msecs(1) < envelopes.date_msecs(0));
+}
+
+void
+EnvelopesTest::test_clamp() // NOLINT
+{
+  auto envelopes = Envelopes{};
+  envelopes.append(
+    1, {}, std::size_t{ 5 } << 32U, FlagSet::SEEN | FlagSet::JUNK);
+  envelopes.append(2, {}, 1234, FlagSet::DRAFT | FlagSet::RECENT);
+
+  QCOMPARE(envelopes.mail_size(0), std::numeric_limits<uint32_t>::max());
+  QCOMPARE(envelopes.mail_size(1), uint32_t{ 1234 });
+
+  // only system flags fit the column.
+  QCOMPARE(envelopes.flags(0), FlagSet::Flags{ FlagSet::SEEN });
+  QCOMPARE(envelopes.flags(1), FlagSet::DRAFT | FlagSet::RECENT);
+}
+
+void
+EnvelopesTest::test_parse() // NOLINT
+{
+  const auto header = QByteArray{ "Date: Mon, 6 Jan 2025 10:00:00 +0100\r\n"
+                                  "Subject: Parsed\r\n"
+                                  "From: alice@example.com\r\n\r\n" };
+
+  auto transcript = QByteArray{};
+  transcript.append(QString{ "* 1 FETCH (UID 10 RFC822.SIZE 120 FLAGS (\\Seen "
+                             "$Work) BODY[HEADER.FIELDS (DATE SUBJECT FROM "
+                             "TO)] {%1}\r\n" }
+                      .arg(header.size())
+                      .toLatin1());
+  transcript.append(header);
+  transcript.append(")\r\n");
+
+  // mails without UID are skipped, fields are collected in any order.
+  transcript.append("* 2 FETCH (FLAGS (\\Flagged))\r\n");
+  transcript.append("* 3 FETCH (FLAGS () UID 12 RFC822.SIZE 7)\r\n");
+  transcript.append("A0 OK FETCH completed\r\n");
+
+  auto resp = client::detail::IMAPResponse{ 'A', 0, {}, true };
+  QVERIFY(resp.collects_envelopes());
+  QVERIFY(resp.digest(transcript));
+  QVERIFY(resp.raw().isEmpty());
+
+  const auto& envelopes = resp.envelopes();
+  QCOMPARE(envelopes.size(), std::size_t{ 2 });
+
+  QCOMPARE(envelopes.uid(0), uint32_t{ 10 });
+  QCOMPARE(envelopes.mail_size(0), uint32_t{ 120 });
+  QCOMPARE(envelopes.flags(0), FlagSet::Flags{ FlagSet::SEEN });
+  QCOMPARE(envelopes.subject(0).toString(), QString{ "Parsed" });
+  QCOMPARE(envelopes.from(0), QString{ "alice@example.com" });
+  QVERIFY(envelopes.date_msecs(0) != Envelopes::NO_DATE);
+
+  QCOMPARE(envelopes.uid(1), uint32_t{ 12 });
+  QCOMPARE(envelopes.mail_size(1), uint32_t{ 7 });
+  QVERIFY(!envelopes.flags(1));
+  QCOMPARE(envelopes.date_msecs(1), Envelopes::NO_DATE);
+}
+
+QTEST_MAIN(EnvelopesTest)
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <qobject.h>
+#include <qtest.h>
+#include <temail/common.hpp>
+
+using namespace temail;
+
+class EnvelopesTest : public QObject
+{
+  Q_OBJECT
+
+private slots: // NOLINT
+  void test_intern();
+  void test_subjects();
+  void test_no_date();
+  void test_clamp();
+  void test_parse();
+};
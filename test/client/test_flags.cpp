@@ -0,0 +1,95 @@
+#include <qlist.h>
+#include <qstring.h>
+#include <qstringlist.h>
+#include <qtest.h>
+#include <qtestcase.h>
+#include <temail/client/flags.hpp>
+
+#include "test_flags.hpp"
+
+using client::FlagSet;
+
+void
+FlagsTest::test_parse() // NOLINT
+{
+  auto set = FlagSet::parse(u" (\\Seen \\FLAGGED  $Forwarded \\Unknown) ");
+
+  QCOMPARE(set.flags(), FlagSet::Flags{ FlagSet::SEEN | FlagSet::FLAGGED });
+  QCOMPARE(set.keywords().size(), qsizetype{ 2 });
+  QVERIFY(set.contains(u"$forwarded"));
+  QVERIFY(set.contains(u"\\unknown"));
+  QVERIFY(!set.test(FlagSet::DELETED));
+
+  // parentheses are optional, an empty list is an empty set.
+  QCOMPARE(FlagSet::parse(u"\\Seen \\Flagged $Forwarded \\Unknown"), set);
+  QVERIFY(FlagSet::parse(u"()").empty());
+  QVERIFY(FlagSet::parse(u"").empty());
+}
+
+void
+FlagsTest::test_round_trip() // NOLINT
+{
+  auto set = FlagSet::parse(u"($Junk \\Draft \\Seen \\HasChildren)");
+
+  // bits in bit order, then keywords.
+  QCOMPARE(set.to_list(),
+           (QStringList{ "\\Seen", "\\Draft", "\\HasChildren", "$Junk" }));
+  QCOMPARE(set.to_string(), QString{ "\\Seen \\Draft \\HasChildren $Junk" });
+  QCOMPARE(FlagSet::parse(set.to_string()), set);
+  QCOMPARE(FlagSet{}.to_string(), QString{});
+}
+
+void
+FlagsTest::test_intern() // NOLINT
+{
+  auto atom = FlagSet::intern(u"$TestIntern");
+
+  // keywords are case-insensitive, the first spelling is kept.
+  QCOMPARE(FlagSet::intern(u"$testintern"), atom);
+  QCOMPARE(FlagSet::intern(u"$TESTINTERN"), atom);
+  QCOMPARE(FlagSet::name(atom), QString{ "$TestIntern" });
+  QVERIFY(FlagSet::intern(u"$TestOther") != atom);
+
+  auto lower = FlagSet::parse(u"$testintern");
+  QCOMPARE(lower.keywords(), QList<FlagSet::Atom>{ atom });
+  QCOMPARE(lower, FlagSet::parse(u"$TestIntern"));
+  QCOMPARE(lower.to_string(), QString{ "$TestIntern" });
+
+  // flags with a bit are never interned.
+  QCOMPARE(FlagSet::parse(u"\\seen").keywords().size(), qsizetype{ 0 });
+}
+
+void
+FlagsTest::test_contains() // NOLINT
+{
+  auto set = FlagSet::parse(u"(\\Seen \\Answered $A $B)");
+
+  QVERIFY(set.contains(FlagSet::parse(u"\\Seen $b")));
+  QVERIFY(set.contains(FlagSet{}));
+  QVERIFY(!set.contains(FlagSet::parse(u"\\Seen \\Flagged")));
+  QVERIFY(!set.contains(FlagSet::parse(u"$A $C")));
+
+  QVERIFY(set.contains(u"\\ANSWERED"));
+  QVERIFY(!set.contains(u"$NeverInterned"));
+}
+
+void
+FlagsTest::test_remove() // NOLINT
+{
+  auto set = FlagSet::parse(u"(\\Seen \\Deleted $A $B)");
+
+  set.remove(u"\\deleted");
+  set.remove(u"$a");
+  set.remove(u"$Missing");
+  set.remove(FlagSet::SEEN);
+  QCOMPARE(set.to_string(), QString{ "$B" });
+
+  set.insert(FlagSet::DRAFT);
+  set.insert(u"$B");
+  QCOMPARE(set.to_string(), QString{ "\\Draft $B" });
+
+  set.clear();
+  QVERIFY(set.empty());
+}
+
+QTEST_MAIN(FlagsTest)
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <qobject.h>
+#include <qtest.h>
+#include <temail/common.hpp>
+
+using namespace temail;
+
+class FlagsTest : public QObject
+{
+  Q_OBJECT
+
+private slots: // NOLINT
+  void test_parse();
+  void test_round_trip();
+  void test_intern();
+  void test_contains();
+  void test_remove();
+};
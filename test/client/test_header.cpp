@@ -0,0 +1,107 @@
+#include <qbytearray.h>
+#include <qdatetime.h>
+#include <qstring.h>
+#include <qtest.h>
+#include <qtestcase.h>
+#include <qtimezone.h>
+#include <temail/client/response.hpp>
+
+#include "test_header.hpp"
+
+using client::response::FetchEnvelope;
+using client::response::FetchHeader;
+
+void
+HeaderTest::test_field() // NOLINT
+{
+  const auto header = FetchHeader{ QByteArray{ "X-Subject: other\r\n"
+                                               "subject: Hello\r\n"
+                                               " world\r\n"
+                                               "\tagain  \r\n"
+                                               "From: alice@example.com\n"
+                                               "\r\n" } };
+
+  // names are case-insensitive, folded lines are joined by one space.
+  QCOMPARE(header.field("Subject"), QByteArray{ "Hello world again" });
+  QCOMPARE(header.field("X-SUBJECT"), QByteArray{ "other" });
+  QCOMPARE(header.field("From"), QByteArray{ "alice@example.com" });
+  QVERIFY(header.field("To").isEmpty());
+  QVERIFY(FetchHeader{}.field("Subject").isEmpty());
+}
+
+void
+HeaderTest::test_decode_b() // NOLINT
+{
+  QCOMPARE(FetchHeader::decode("=?UTF-8?B?5L2g5aW9?="),
+           QString::fromUtf8("\xe4\xbd\xa0\xe5\xa5\xbd"));
+  QCOMPARE(FetchHeader::decode("=?utf-8?b?SGVsbG8=?="), QString{ "Hello" });
+
+  // RFC 2231 language suffix of the charset.
+  QCOMPARE(FetchHeader::decode("=?UTF-8*en?B?SGk=?="), QString{ "Hi" });
+}
+
+void
+HeaderTest::test_decode_q() // NOLINT
+{
+  QCOMPARE(FetchHeader::decode("=?ISO-8859-1?Q?caf=E9_au_lait?="),
+           QString::fromUtf8("caf\xc3\xa9 au lait"));
+  QCOMPARE(FetchHeader::decode("=?UTF-8?q?=C3=A9t=C3=A9?="),
+           QString::fromUtf8("\xc3\xa9t\xc3\xa9"));
+
+  // broken escapes are kept as they are.
+  QCOMPARE(FetchHeader::decode("=?UTF-8?Q?a=ZZb=4?="), QString{ "a=ZZb=4" });
+}
+
+void
+HeaderTest::test_decode_gap() // NOLINT
+{
+  // white space between adjacent encoded words is dropped.
+  QCOMPARE(FetchHeader::decode("=?UTF-8?Q?a?= =?UTF-8?Q?b?="),
+           QString{ "ab" });
+  QCOMPARE(FetchHeader::decode("=?UTF-8?Q?a?=\t =?UTF-8?B?Yg==?="),
+           QString{ "ab" });
+
+  // other text keeps its white space.
+  QCOMPARE(FetchHeader::decode("=?UTF-8?Q?a?= x =?UTF-8?Q?b?="),
+           QString{ "a x b" });
+  QCOMPARE(FetchHeader::decode("Re: =?UTF-8?Q?a?= done"),
+           QString{ "Re: a done" });
+  QCOMPARE(FetchHeader::decode("=?UTF-8?Q?a_?= =?UTF-8?Q?_b?="),
+           QString{ "a  b" });
+}
+
+void
+HeaderTest::test_decode_malformed() // NOLINT
+{
+  QCOMPARE(FetchHeader::decode("plain text"), QString{ "plain text" });
+  QCOMPARE(FetchHeader::decode("=?broken"), QString{ "=?broken" });
+  QCOMPARE(FetchHeader::decode("=?UTF-8?X?abc?="),
+           QString{ "=?UTF-8?X?abc?=" });
+
+  // a malformed word is not adjacent, the gap before the next one is kept.
+  QCOMPARE(FetchHeader::decode("=?UTF-8?Q?a?= =?x =?UTF-8?Q?b?="),
+           QString{ "a =?x b" });
+}
+
+void
+HeaderTest::test_date() // NOLINT
+{
+  const auto expected =
+    QDateTime{ QDate{ 2025, 1, 6 }, QTime{ 10, 0 }, QTimeZone::UTC };
+
+  // trailing comments are stripped, folded values are joined.
+  auto envelope = FetchEnvelope{ QByteArray{
+    "Date: Mon, 6 Jan 2025 10:00:00 +0000 (UTC)\r\n"
+    "Subject: =?UTF-8?Q?Caf=C3=A9?=\r\n\r\n" } };
+  QCOMPARE(envelope.date(), expected);
+  QCOMPARE(envelope.subject(), QString::fromUtf8("Caf\xc3\xa9"));
+
+  envelope = FetchEnvelope{ QByteArray{ "Date: Mon, 6 Jan 2025\r\n"
+                                        " 11:00:00 +0100\r\n\r\n" } };
+  QCOMPARE(envelope.date(), expected);
+
+  envelope = FetchEnvelope{ QByteArray{ "Subject: no date\r\n\r\n" } };
+  QVERIFY(!envelope.date().isValid());
+}
+
+QTEST_MAIN(HeaderTest)
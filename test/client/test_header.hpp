@@ -0,0 +1,20 @@
+#pragma once
+
+#include <qobject.h>
+#include <qtest.h>
+#include <temail/common.hpp>
+
+using namespace temail;
+
+class HeaderTest : public QObject
+{
+  Q_OBJECT
+
+private slots: // NOLINT
+  void test_field();
+  void test_decode_b();
+  void test_decode_q();
+  void test_decode_gap();
+  void test_decode_malformed();
+  void test_date();
+};
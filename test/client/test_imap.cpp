@@ -1,7 +1,9 @@
+#include <qdatetime.h>
 #include <qtest.h>
 #include <qtestcase.h>
 #include <temail/client/base.hpp>
 #include <temail/client/response.hpp>
+#include <temail/client/sequence.hpp>
 
 #include "temail/client/request.hpp"
 #include "test_imap.hpp"
@@ -17,27 +19,47 @@ IMAPTest::test_interface() // NOLINT
 
   _client->login(TEMAIL_TEST_IMAP_USERNAME, TEMAIL_TEST_IMAP_PASSWORD);
   QVERIFY(_client->wait_for_ready_read());
-  QVERIFY(_client->read().canConvert<client::response::Login>());
+  QVERIFY(_client->read<client::response::Login>().has_value());
 
   _client->list("\"\"", "*");
   QVERIFY(_client->wait_for_ready_read());
-  QVERIFY(_client->read().canConvert<client::response::List>());
+  QVERIFY(_client->read<client::response::List>().has_value());
 
   _client->select("INBOX");
   QVERIFY(_client->wait_for_ready_read());
-  QVERIFY(_client->read().canConvert<client::response::Select>());
+  QVERIFY(_client->read<client::response::Select>().has_value());
 
   _client->noop();
   QVERIFY(_client->wait_for_ready_read());
-  QVERIFY(_client->read().canConvert<client::response::Noop>());
+  QVERIFY(_client->read<client::response::Noop>().has_value());
 
   _client->search(client::request::Search::ALL);
   QVERIFY(_client->wait_for_ready_read());
-  QVERIFY(_client->read().canConvert<client::response::Search>());
+  QVERIFY(_client->read<client::response::Search>().has_value());
+
+  _client->search(
+    client::request::SearchQuery::since(QDate::currentDate().addYears(-1)) &&
+    !client::request::SearchQuery{ client::request::Search::DELETED });
+  QVERIFY(_client->wait_for_ready_read());
+  QVERIFY(_client->read<client::response::Search>().has_value());
 
   _client->fetch(1,
                  client::request::Fetch::TEXT | client::request::Fetch::MIME);
   QVERIFY(_client->wait_for_ready_read());
+  QVERIFY(_client->read<client::response::Fetch>().has_value());
+
+  _client->uid_search(client::request::Search::ALL);
+  QVERIFY(_client->wait_for_ready_read());
+  QVERIFY(_client->read<client::response::UidSearch>().has_value());
+
+  _client->uid_fetch(1, client::request::Fetch::ENVELOPE, 0);
+  QVERIFY(_client->wait_for_ready_read());
+  QVERIFY(_client->read<client::response::UidFetch>().has_value());
+
+  _client->uid_fetch(client::SequenceSet{ 1, client::SequenceSet::LAST },
+                     client::request::Fetch::ENVELOPE);
+  QVERIFY(_client->wait_for_ready_read());
+  QVERIFY(_client->read<client::response::UidFetch>().has_value());
 
   _client->logout();
   QVERIFY(_client->wait_for_disconnected());
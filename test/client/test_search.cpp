@@ -0,0 +1,250 @@
+#include <qbytearray.h>
+#include <qdatetime.h>
+#include <qstring.h>
+#include <qtest.h>
+#include <qtestcase.h>
+#include <temail/client/imap.hpp>
+#include <temail/client/request.hpp>
+#include <temail/client/response.hpp>
+#include <temail/client/sequence.hpp>
+#include <variant>
+
+#include "temail/private/client/imap/response.hpp"
+#include "temail/private/client/imap/search.hpp"
+#include "test_search.hpp"
+
+using client::SequenceSet;
+using client::request::Search;
+using client::request::SearchQuery;
+using client::response::ESearch;
+
+namespace {
+
+/**
+ * @brief Parse a SEARCH transcript tagged `A0`, as the client would.
+ *
+ */
+client::response::Result
+_parse(const QByteArray& transcript, bool uid = false)
+{
+  auto resp = client::detail::IMAPResponse{ 'A', 0 };
+  auto result = client::response::Result{};
+  if (!resp.digest(transcript)) {
+    return result;
+  }
+
+  auto handle = uid ? client::detail::imap_handle_uid_search
+                    : client::detail::imap_handle_search;
+  handle(
+    resp,
+    [](client::IMAP::ErrorType, const QString&) {},
+    [&result](client::response::Result&& data) { result = std::move(data); });
+  return result;
+}
+
+}
+
+void
+SearchTest::test_keys() // NOLINT
+{
+  QCOMPARE(SearchQuery{ Search::SEEN }.to_string(), QString{ "SEEN" });
+  QCOMPARE(SearchQuery::larger(1024).to_string(), QString{ "LARGER 1024" });
+  QCOMPARE(SearchQuery::smaller(10).to_string(), QString{ "SMALLER 10" });
+  QCOMPARE(SearchQuery::from("alice").to_string(),
+           QString{ "FROM \"alice\"" });
+  QCOMPARE(SearchQuery::header("X-Tag", "v").to_string(),
+           QString{ "HEADER \"X-Tag\" \"v\"" });
+  QCOMPARE(SearchQuery::uid(SequenceSet{ 1, SequenceSet::LAST }).to_string(),
+           QString{ "UID 1:*" });
+  QCOMPARE(SearchQuery::ids(SequenceSet::parse(u"2,4")).to_string(),
+           QString{ "2,4" });
+}
+
+void
+SearchTest::test_dates() // NOLINT
+{
+  // month names are English whatever the locale, days are not padded.
+  QCOMPARE(SearchQuery::since(QDate{ 2025, 1, 5 }).to_string(),
+           QString{ "SINCE 5-Jan-2025" });
+  QCOMPARE(SearchQuery::before(QDate{ 2025, 3, 10 }).to_string(),
+           QString{ "BEFORE 10-Mar-2025" });
+  QCOMPARE(SearchQuery::on(QDate{ 2025, 12, 31 }).to_string(),
+           QString{ "ON 31-Dec-2025" });
+  QCOMPARE(SearchQuery::sent_since(QDate{ 2024, 2, 9 }).to_string(),
+           QString{ "SENTSINCE 9-Feb-2024" });
+  QCOMPARE(SearchQuery::sent_before(QDate{ 2024, 6, 1 }).to_string(),
+           QString{ "SENTBEFORE 1-Jun-2024" });
+  QCOMPARE(SearchQuery::sent_on(QDate{ 2024, 11, 30 }).to_string(),
+           QString{ "SENTON 30-Nov-2024" });
+}
+
+void
+SearchTest::test_parens() // NOLINT
+{
+  auto seen = SearchQuery{ Search::SEEN };
+  auto flagged = SearchQuery{ Search::FLAGGED };
+
+  QCOMPARE((SearchQuery::from("a") && !seen).to_string(),
+           QString{ "FROM \"a\" NOT SEEN" });
+
+  // AND operands of OR and NOT are grouped, keys and OR are not.
+  QCOMPARE(
+    (SearchQuery::from("a") || (SearchQuery::to("b") && flagged)).to_string(),
+    QString{ "OR FROM \"a\" (TO \"b\" FLAGGED)" });
+  QCOMPARE((!(SearchQuery::from("a") && seen)).to_string(),
+           QString{ "NOT (FROM \"a\" SEEN)" });
+  QCOMPARE((!(seen || flagged)).to_string(), QString{ "NOT OR SEEN FLAGGED" });
+  QCOMPARE(((seen || flagged) && SearchQuery::larger(1)).to_string(),
+           QString{ "OR SEEN FLAGGED LARGER 1" });
+  QCOMPARE((seen || (flagged || SearchQuery::larger(1))).to_string(),
+           QString{ "OR SEEN OR FLAGGED LARGER 1" });
+}
+
+void
+SearchTest::test_all() // NOLINT
+{
+  auto from = SearchQuery::from("a");
+
+  QCOMPARE(SearchQuery{}.to_string(), QString{ "ALL" });
+  QCOMPARE((SearchQuery{} && from).to_string(), QString{ "FROM \"a\"" });
+  QCOMPARE((from && Search::ALL).to_string(), QString{ "FROM \"a\"" });
+  QCOMPARE((SearchQuery{} && SearchQuery{}).to_string(), QString{ "ALL" });
+
+  // ALL is only dropped from AND.
+  QCOMPARE((SearchQuery{} || from).to_string(), QString{ "OR ALL FROM \"a\"" });
+}
+
+void
+SearchTest::test_quoting() // NOLINT
+{
+  QCOMPARE(SearchQuery::subject("a\"b\\c").to_string(),
+           QString{ "SUBJECT \"a\\\"b\\\\c\"" });
+
+  // quoted strings cannot span lines, CR and LF make a literal.
+  QCOMPARE(SearchQuery::subject("x\r\ny\n").to_string(),
+           QString{ "SUBJECT {5+}\r\nx\r\ny\n" });
+  QVERIFY(SearchQuery::subject("x\ny").literal());
+  QVERIFY(!SearchQuery::subject("a\"b").literal());
+  QCOMPARE(SearchQuery::header("X-\"Tag\"", "").to_string(),
+           QString{ "HEADER \"X-\\\"Tag\\\"\" \"\"" });
+}
+
+void
+SearchTest::test_utf8() // NOLINT
+{
+  const auto hello = QString::fromUtf8("h\xc3\xa9llo");
+
+  QVERIFY(!SearchQuery::from("alice").utf8());
+  QVERIFY(SearchQuery::subject(hello).utf8());
+  QVERIFY(SearchQuery::header(hello, "v").utf8());
+
+  // any non-ASCII string in the tree needs `CHARSET UTF-8`.
+  QVERIFY((SearchQuery::from("a") && !SearchQuery::body(hello)).utf8());
+  QVERIFY((SearchQuery::text(hello) || SearchQuery{ Search::SEEN }).utf8());
+  QVERIFY(!(SearchQuery::from("a") || SearchQuery::to("b")).utf8());
+
+  // non-ASCII strings are literals sized in UTF-8 bytes.
+  QCOMPARE(SearchQuery::subject(hello).to_string(),
+           QString{ "SUBJECT {6+}\r\n" } + hello);
+  QCOMPARE(SearchQuery::header(hello, "v").to_string(),
+           QString{ "HEADER {6+}\r\n" } + hello + QString{ " \"v\"" });
+  QVERIFY((SearchQuery::from("a") && !SearchQuery::body(hello)).literal());
+  QVERIFY(!SearchQuery::from("alice").literal());
+}
+
+void
+SearchTest::test_write() // NOLINT
+{
+  auto out = QString{ "UID SEARCH " };
+  (SearchQuery{ Search::UNSEEN } && SearchQuery::larger(5)).write(out);
+
+  QCOMPARE(out, QString{ "UID SEARCH UNSEEN LARGER 5" });
+}
+
+void
+SearchTest::test_evaluate() // NOLINT
+{
+  auto query = (SearchQuery{ Search::SEEN } || SearchQuery::larger(10)) &&
+               !SearchQuery::from("a");
+
+  auto match = [](bool seen, qint64 size, bool from) {
+    return [=](const SearchQuery::Key& key) {
+      switch (key.type) {
+        case SearchQuery::Key::CRITERIA:
+          return seen;
+        case SearchQuery::Key::LARGER:
+          return size > key.size;
+        case SearchQuery::Key::FROM:
+          return from;
+        default:
+          return false;
+      }
+    };
+  };
+
+  QVERIFY(query.evaluate(match(true, 0, false)));
+  QVERIFY(query.evaluate(match(false, 11, false)));
+  QVERIFY(!query.evaluate(match(false, 10, false)));
+  QVERIFY(!query.evaluate(match(true, 11, true)));
+
+  QVERIFY(query.all_of([](const SearchQuery::Key& key) {
+    return key.type != SearchQuery::Key::BODY;
+  }));
+  QVERIFY(!query.all_of([](const SearchQuery::Key& key) {
+    return key.type != SearchQuery::Key::FROM;
+  }));
+}
+
+void
+SearchTest::test_esearch() // NOLINT
+{
+  // the correlator is skipped, keys are case-insensitive.
+  auto result = _parse("* ESEARCH (TAG \"A0\") MIN 2 max 9 COUNT 3 "
+                       "ALL 2,5:6,9\r\n"
+                       "A0 OK SEARCH completed\r\n");
+  QVERIFY(std::holds_alternative<ESearch>(result));
+
+  auto esearch = std::get<ESearch>(result);
+  QVERIFY(!esearch.uid);
+  QCOMPARE(esearch.min, std::size_t{ 2 });
+  QCOMPARE(esearch.max, std::size_t{ 9 });
+  QCOMPARE(esearch.count, std::size_t{ 3 });
+  QCOMPARE(esearch.ids.to_string(), QString{ "2,5:6,9" });
+
+  // UID in the data or a UID command marks the ids as UIDs.
+  esearch = std::get<ESearch>(_parse("* ESEARCH (TAG \"A0\") UID COUNT 0\r\n"
+                                     "A0 OK SEARCH completed\r\n"));
+  QVERIFY(esearch.uid);
+  QCOMPARE(esearch.count, std::size_t{ 0 });
+  QVERIFY(esearch.ids.empty());
+
+  esearch = std::get<ESearch>(
+    _parse("* ESEARCH COUNT 1\r\nA0 OK SEARCH completed\r\n", true));
+  QVERIFY(esearch.uid);
+  QCOMPARE(esearch.count, std::size_t{ 1 });
+
+  // plain SEARCH data is not ESEARCH.
+  QVERIFY(!std::holds_alternative<ESearch>(
+    _parse("* SEARCH 1 2\r\nA0 OK SEARCH completed\r\n")));
+}
+
+void
+SearchTest::test_esearch_partial() // NOLINT
+{
+  auto esearch =
+    std::get<ESearch>(_parse("* ESEARCH (TAG \"A0\") UID PARTIAL "
+                             "(1:100 2,10:11) COUNT 3\r\n"
+                             "A0 OK SEARCH completed\r\n"));
+  QVERIFY(esearch.uid);
+  QCOMPARE(esearch.ids.to_string(), QString{ "2,10:11" });
+  QCOMPARE(esearch.count, std::size_t{ 3 });
+
+  // a window beyond the end has no ids.
+  esearch = std::get<ESearch>(_parse("* ESEARCH (TAG \"A0\") PARTIAL "
+                                     "(-1:-100 NIL)\r\n"
+                                     "A0 OK SEARCH completed\r\n"));
+  QVERIFY(esearch.ids.empty());
+  QCOMPARE(esearch.count, std::size_t{ 0 });
+}
+
+QTEST_MAIN(SearchTest)
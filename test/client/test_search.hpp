@@ -0,0 +1,24 @@
+#pragma once
+
+#include <qobject.h>
+#include <qtest.h>
+#include <temail/common.hpp>
+
+using namespace temail;
+
+class SearchTest : public QObject
+{
+  Q_OBJECT
+
+private slots: // NOLINT
+  void test_keys();
+  void test_dates();
+  void test_parens();
+  void test_all();
+  void test_quoting();
+  void test_utf8();
+  void test_write();
+  void test_evaluate();
+  void test_esearch();
+  void test_esearch_partial();
+};
@@ -0,0 +1,124 @@
+#include <qlist.h>
+#include <qstring.h>
+#include <qtest.h>
+#include <qtestcase.h>
+#include <temail/client/sequence.hpp>
+
+#include "test_sequence.hpp"
+
+using client::SequenceSet;
+
+void
+SequenceTest::test_parse() // NOLINT
+{
+  auto set = SequenceSet::parse(u"1:3,5,7:*");
+
+  QCOMPARE(set.ranges(),
+           (QList<SequenceSet::Range>{
+             { 1, 3 }, { 5, 5 }, { 7, SequenceSet::LAST } }));
+  QVERIFY(set.contains(1));
+  QVERIFY(set.contains(5));
+  QVERIFY(set.contains(SequenceSet::LAST));
+  QVERIFY(!set.contains(4));
+  QVERIFY(!set.contains(6));
+}
+
+void
+SequenceTest::test_parse_invalid() // NOLINT
+{
+  // 0 is not a valid id, invalid items are skipped.
+  QCOMPARE(SequenceSet::parse(u"0,a,3:x,,4").to_string(), QString{ "4" });
+  QCOMPARE(SequenceSet::parse(u"5:2").to_string(), QString{ "2:5" });
+  QVERIFY(SequenceSet::parse(u"").empty());
+}
+
+void
+SequenceTest::test_merge() // NOLINT
+{
+  auto overlapping = SequenceSet{};
+  overlapping.insert(1, 5);
+  overlapping.insert(3, 8);
+  QCOMPARE(overlapping.to_string(), QString{ "1:8" });
+
+  auto adjacent = SequenceSet{ 1, 3 };
+  adjacent.insert(4);
+  QCOMPARE(adjacent.to_string(), QString{ "1:4" });
+  QCOMPARE(adjacent.ranges().size(), qsizetype{ 1 });
+
+  // out of order inserts bridge the gaps between ranges.
+  auto bridged = SequenceSet{};
+  bridged.insert(10);
+  bridged.insert(1);
+  bridged.insert(5, 6);
+  QCOMPARE(bridged.to_string(), QString{ "1,5:6,10" });
+  bridged.insert(2, 4);
+  QCOMPARE(bridged.to_string(), QString{ "1:6,10" });
+  bridged.insert(7, 9);
+  QCOMPARE(bridged, (SequenceSet{ 1, 10 }));
+
+  auto merged = SequenceSet::parse(u"2,4");
+  merged.insert(SequenceSet::parse(u"3,5:6"));
+  QCOMPARE(merged.to_string(), QString{ "2:6" });
+
+  auto appended = SequenceSet::parse(u"1:3");
+  appended.insert(SequenceSet::parse(u"4:5"));
+  QCOMPARE(appended.ranges().size(), qsizetype{ 1 });
+}
+
+void
+SequenceTest::test_star() // NOLINT
+{
+  QCOMPARE(SequenceSet::parse(u"*").ranges(),
+           (QList<SequenceSet::Range>{
+             { SequenceSet::LAST, SequenceSet::LAST } }));
+  QCOMPARE(SequenceSet::parse(u"*:5").to_string(), QString{ "5:*" });
+  QCOMPARE((SequenceSet{ 5, SequenceSet::LAST }).to_string(), QString{ "5:*" });
+
+  // `LAST + 1` must not wrap around to a new range.
+  auto all = SequenceSet{ 1, SequenceSet::LAST };
+  all.insert(SequenceSet::LAST);
+  QCOMPARE(all.to_string(), QString{ "1:*" });
+  QCOMPARE(all.ranges().size(), qsizetype{ 1 });
+}
+
+void
+SequenceTest::test_remove() // NOLINT
+{
+  auto set = SequenceSet{ 1, 10 };
+  set.remove(3, 5);
+  QCOMPARE(set.to_string(), QString{ "1:2,6:10" });
+
+  set.remove(SequenceSet::parse(u"1,10"));
+  QCOMPARE(set.to_string(), QString{ "2,6:9" });
+
+  set.remove(1, SequenceSet::LAST);
+  QVERIFY(set.empty());
+}
+
+void
+SequenceTest::test_round_trip() // NOLINT
+{
+  const auto sets = QList<QString>{
+    "1", "1:3,5,7:*", "2,4,6", "*", "1:4294967294",
+  };
+
+  for (const auto& str : sets) {
+    QCOMPARE(SequenceSet::parse(str).to_string(), str);
+  }
+}
+
+void
+SequenceTest::test_iterate() // NOLINT
+{
+  auto set = SequenceSet::parse(u"1:3,7");
+
+  auto ids = QList<SequenceSet::Id>{};
+  for (auto id : set) {
+    ids.append(id);
+  }
+
+  QCOMPARE(ids, (QList<SequenceSet::Id>{ 1, 2, 3, 7 }));
+  QCOMPARE(set.size(), std::size_t{ 4 });
+}
+
+QTEST_MAIN(SequenceTest)
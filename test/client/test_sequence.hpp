@@ -0,0 +1,21 @@
+#pragma once
+
+#include <qobject.h>
+#include <qtest.h>
+#include <temail/common.hpp>
+
+using namespace temail;
+
+class SequenceTest : public QObject
+{
+  Q_OBJECT
+
+private slots: // NOLINT
+  void test_parse();
+  void test_parse_invalid();
+  void test_merge();
+  void test_star();
+  void test_remove();
+  void test_round_trip();
+  void test_iterate();
+};
@@ -0,0 +1,241 @@
+#include <array>
+#include <cstddef>
+#include <qbytearray.h>
+#include <qlist.h>
+#include <qmap.h>
+#include <qstring.h>
+#include <qtest.h>
+#include <qtestcase.h>
+#include <qtypes.h>
+#include <temail/common.hpp>
+
+#include "temail/private/client/imap/response.hpp"
+#include "temail/private/client/imap/tokenizer.hpp"
+#include "test_tokenizer.hpp"
+
+namespace {
+
+using Tokenizer = client::detail::IMAPTokenizer;
+using Token = Tokenizer::Token;
+
+const std::array<const char*, 11> TOKEN_NAMES{
+  "NONE",          "ERROR",      "ATOM",     "NIL",  "QUOTED", "LITERAL",
+  "LITERAL_CHUNK", "LIST_BEGIN", "LIST_END", "TEXT", "CRLF",
+}; /**< Token names, in enum order. */
+
+/**
+ * @brief Describe a token as `NAME:value`, errors have no value.
+ *
+ */
+QByteArray
+_describe(Token token, const QByteArray& value)
+{
+  auto name = QByteArray{ TOKEN_NAMES[static_cast<std::size_t>(token)] };
+  return token == Token::ERROR ? name : name + ':' + value;
+}
+
+/**
+ * @brief Tokenize input fed in chunks of `step` bytes, up to the first error.
+ *
+ */
+QList<QByteArray>
+_tokenize(const QByteArray& input, qsizetype step, bool stream = false)
+{
+  auto tokens = QList<QByteArray>{};
+  auto tokenizer = Tokenizer{};
+  tokenizer.stream_literals(stream);
+
+  qsizetype offset = 0;
+  while (true) {
+    auto token = tokenizer.next();
+    if (token == Token::NONE) {
+      if (offset >= input.size()) {
+        break;
+      }
+      tokenizer.feed(input.sliced(offset, qMin(step, input.size() - offset)));
+      offset += step;
+      continue;
+    }
+
+    tokens.append(_describe(token, tokenizer.value()));
+    if (token == Token::ERROR) {
+      break;
+    }
+  }
+
+  return tokens;
+}
+
+}
+
+void
+TokenizerTest::test_split() // NOLINT
+{
+  const auto input =
+    QByteArray{ "* 1 FETCH (UID 5 FLAGS (\\Seen) BODY[HEADER.FIELDS (DATE "
+                "SUBJECT)] {5}\r\nab\"cd NIL)\r\n" };
+  const auto expected = QList<QByteArray>{
+    "ATOM:*",
+    "ATOM:1",
+    "ATOM:FETCH",
+    "LIST_BEGIN:",
+    "ATOM:UID",
+    "ATOM:5",
+    "ATOM:FLAGS",
+    "LIST_BEGIN:",
+    "ATOM:\\Seen",
+    "LIST_END:",
+    "ATOM:BODY[HEADER.FIELDS (DATE SUBJECT)]",
+    "LITERAL:ab\"cd",
+    "NIL:NIL",
+    "LIST_END:",
+    "CRLF:",
+  };
+
+  // every split point, inside brackets, literal headers and data included.
+  QCOMPARE(_tokenize(input, input.size()), expected);
+  QCOMPARE(_tokenize(input, 1), expected);
+  QCOMPARE(_tokenize(input, 3), expected);
+}
+
+void
+TokenizerTest::test_literal() // NOLINT
+{
+  const auto input = QByteArray{ "{0}\r\n {3+}\r\nabc {5}\r\n(a)\r\n\r\n" };
+  const auto expected = QList<QByteArray>{
+    "LITERAL:",
+    "LITERAL:abc",
+    "LITERAL:(a)\r\n",
+    "CRLF:",
+  };
+
+  QCOMPARE(_tokenize(input, input.size()), expected);
+  QCOMPARE(_tokenize(input, 1), expected);
+}
+
+void
+TokenizerTest::test_literal_stream() // NOLINT
+{
+  const auto input = QByteArray{ "{10}\r\nhelloworld)\r\n" };
+
+  auto tokens = _tokenize(input, 3, true);
+  QCOMPARE(tokens.size(), qsizetype{ 6 });
+  QCOMPARE(tokens.mid(3),
+           (QList<QByteArray>{ "LITERAL:d", "LIST_END:", "CRLF:" }));
+
+  auto data = QByteArray{};
+  for (const auto& token : tokens.first(3)) {
+    QVERIFY(token.startsWith("LITERAL_CHUNK:"));
+    data.append(token.sliced(14));
+  }
+  QCOMPARE(data + 'd', QByteArray{ "helloworld" });
+}
+
+void
+TokenizerTest::test_digest_stream() // NOLINT
+{
+  const auto text = QByteArray{ "Hello, this body is streamed.\r\n" };
+  const auto header = QByteArray{ "Hi!\r\n" };
+
+  auto transcript = QByteArray{};
+  transcript.append(QString{ "* 3 FETCH (UID 9 BODY[TEXT] {%1}\r\n" }
+                      .arg(text.size())
+                      .toLatin1());
+  transcript.append(text);
+  transcript.append(QString{ " BODY[HEADER] {%1}\r\n" }
+                      .arg(header.size())
+                      .toLatin1());
+  transcript.append(header);
+  transcript.append(")\r\nA0 OK FETCH completed\r\n");
+
+  auto chunks = QMap<QString, QList<QByteArray>>{};
+  auto ids = QList<std::size_t>{};
+  auto resp = client::detail::IMAPResponse{
+    'A',
+    0,
+    [&](std::size_t id, const QString& field, const QByteArray& chunk) {
+      ids.append(id);
+      chunks[field].append(chunk);
+    }
+  };
+
+  // literals arrive across several reads.
+  auto done = false;
+  for (qsizetype offset = 0; offset < transcript.size(); offset += 7) {
+    QVERIFY(!done);
+    done = resp.digest(transcript.sliced(
+      offset, qMin(qsizetype{ 7 }, transcript.size() - offset)));
+  }
+  QVERIFY(done);
+  QVERIFY(!resp.error());
+  QCOMPARE(resp.tagged().size(), qsizetype{ 1 });
+
+  QVERIFY(chunks.value("BODY[TEXT]").size() > 1);
+  QCOMPARE(chunks.value("BODY[TEXT]").join(), text);
+  QCOMPARE(chunks.value("BODY[HEADER]").join(), header);
+  QCOMPARE(ids, QList<std::size_t>(ids.size(), 3));
+
+  // streamed literals are not buffered, other items still are.
+  QVERIFY(!resp.raw().value(3).contains("BODY[TEXT]"));
+  QVERIFY(!resp.raw().value(3).contains("BODY[HEADER]"));
+  QCOMPARE(resp.raw().value(3).value("UID"), QByteArray{ "9" });
+}
+
+void
+TokenizerTest::test_quoted() // NOLINT
+{
+  const auto input = QByteArray{ "\"a\\\"b\\\\c\" \"\" \"(x)\"\r\n" };
+  const auto expected = QList<QByteArray>{
+    "QUOTED:a\"b\\c",
+    "QUOTED:",
+    "QUOTED:(x)",
+    "CRLF:",
+  };
+
+  QCOMPARE(_tokenize(input, input.size()), expected);
+  QCOMPARE(_tokenize(input, 1), expected);
+}
+
+void
+TokenizerTest::test_text() // NOLINT
+{
+  auto tokenizer = Tokenizer{};
+  tokenizer.feed("A1 OK [READ-WRITE] done {3}\r\nab");
+
+  QCOMPARE(tokenizer.next(), Token::ATOM);
+  QCOMPARE(tokenizer.value(), QByteArray{ "A1" });
+  QCOMPARE(tokenizer.next(), Token::ATOM);
+  QCOMPARE(tokenizer.value(), QByteArray{ "OK" });
+
+  // literals in text are quoted, trailing spaces are dropped.
+  QCOMPARE(tokenizer.next_text(), Token::NONE);
+  tokenizer.feed("\"  \r\nB2");
+  QCOMPARE(tokenizer.next_text(), Token::TEXT);
+  QCOMPARE(tokenizer.value(), QByteArray{ "[READ-WRITE] done \"ab\\\"\"" });
+  QCOMPARE(tokenizer.remaining(), QByteArray{ "B2" });
+}
+
+void
+TokenizerTest::test_malformed() // NOLINT
+{
+  const auto inputs = QList<QByteArray>{
+    "\"abc\r\n", // CR in quoted string
+    "{1x}\r\n",  // literal size
+    "{3}x",      // literal size without CRLF
+    "\rX",       // CR without LF
+  };
+
+  for (const auto& input : inputs) {
+    QCOMPARE(_tokenize(input, input.size()).last(), QByteArray{ "ERROR" });
+    QCOMPARE(_tokenize(input, 1).last(), QByteArray{ "ERROR" });
+  }
+
+  // the tokenizer stops at the error, later input is never parsed.
+  auto tokenizer = Tokenizer{};
+  tokenizer.feed("\rX");
+  QCOMPARE(tokenizer.next(), Token::ERROR);
+  tokenizer.feed("A1 OK\r\n");
+  QCOMPARE(tokenizer.next(), Token::ERROR);
+}
+
+QTEST_MAIN(TokenizerTest)
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <qobject.h>
+#include <qtest.h>
+#include <temail/common.hpp>
+
+using namespace temail;
+
+class TokenizerTest : public QObject
+{
+  Q_OBJECT
+
+private slots: // NOLINT
+  void test_split();
+  void test_literal();
+  void test_literal_stream();
+  void test_digest_stream();
+  void test_quoted();
+  void test_text();
+  void test_malformed();
+};